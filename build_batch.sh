@@ -0,0 +1,7 @@
+#!/bin/sh
+
+echo "cd libgambatte && scons"
+(cd libgambatte && scons) || exit
+
+echo "cd gambatte_batch && scons"
+(cd gambatte_batch && scons)
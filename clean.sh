@@ -6,6 +6,9 @@ echo "cd gambatte_qt && make distclean"
 echo "cd gambatte_sdl && scons -c"
 (cd gambatte_sdl && scons -c)
 
+echo "cd gambatte_batch && scons -c"
+(cd gambatte_batch && scons -c)
+
 echo "cd libgambatte && scons -c"
 (cd libgambatte && scons -c)
 
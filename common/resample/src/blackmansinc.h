@@ -58,17 +58,15 @@ public:
 	};
 
 	BlackmanSinc(unsigned div, unsigned phaseLen, double fc)
-	: kernel_(phaseLen * phases)
+	: kernel_(phases, phaseLen, fc, blackmanWin, 1.0)
 	, polyfir_(kernel_, phaseLen, div)
 	{
-		makeSincKernel(kernel_, phases, phaseLen, fc, blackmanWin, 1.0);
 	}
 
 	BlackmanSinc(unsigned div, RollOff ro, double gain)
-	: kernel_(ro.taps * phases)
+	: kernel_(phases, ro.taps, ro.fc, blackmanWin, gain)
 	, polyfir_(kernel_, ro.taps, div)
 	{
-		makeSincKernel(kernel_, phases, ro.taps, ro.fc, blackmanWin, gain);
 	}
 
 	virtual std::size_t resample(short *out, short const *in, std::size_t inlen) {
@@ -80,7 +78,7 @@ public:
 	virtual unsigned div() const { return polyfir_.div(); }
 
 private:
-	Array<short> const kernel_;
+	SharedSincKernel const kernel_;
 	PolyphaseFir<channels, phases> polyfir_;
 
 	static double blackmanWin(long i, long M) {
@@ -19,6 +19,8 @@
 #include "makesinckernel.h"
 #include "array.h"
 #include <cmath>
+#include <list>
+#include <mutex>
 
 void makeSincKernel(short *const kernel, int const phases, int const phaseLen, double fc,
                     double (*const win)(long m, long M), double const maxAllowedGain)
@@ -128,3 +130,102 @@ void makeSincKernel(short *const kernel, int const phases, int const phaseLen, d
 			*km-- = *k++ = static_cast<short>(std::floor(*dk++ * gain + 0.5));
 	}
 }
+
+struct SincKernelCacheEntry {
+	int phases;
+	int phaseLen;
+	double fc;
+	double (*win)(long m, long M);
+	double gain;
+	Array<short> kernel;
+	long refs;
+
+	SincKernelCacheEntry(int phases, int phaseLen,
+	                     double fc, double (*win)(long m, long M), double gain)
+	: phases(phases), phaseLen(phaseLen), fc(fc), win(win), gain(gain)
+	, kernel(std::size_t(phases) * phaseLen), refs(0)
+	{
+		makeSincKernel(kernel, phases, phaseLen, fc, win, gain);
+	}
+
+	bool matches(int phases, int phaseLen,
+	             double fc, double (*win)(long m, long M), double gain) const {
+		return this->phases == phases && this->phaseLen == phaseLen
+		    && this->fc == fc && this->win == win && this->gain == gain;
+	}
+};
+
+namespace {
+
+// Enough to cover a full reconfiguration of a few chains (up to three sinc stages each).
+enum { max_unreferenced_kernels = 8 };
+
+class SincKernelCache {
+public:
+	static SincKernelCache & instance() {
+		static SincKernelCache cache;
+		return cache;
+	}
+
+	~SincKernelCache() {
+		for (List::iterator it = list_.begin(); it != list_.end(); ++it)
+			delete *it;
+	}
+
+	SincKernelCacheEntry * acquire(int phases, int phaseLen,
+	                               double fc, double (*win)(long m, long M), double gain) {
+		{
+			std::lock_guard<std::mutex> lock(mut_);
+			for (List::iterator it = list_.begin(); it != list_.end(); ++it) {
+				if ((*it)->matches(phases, phaseLen, fc, win, gain)) {
+					SincKernelCacheEntry *const e = *it;
+					++e->refs;
+					list_.splice(list_.begin(), list_, it);
+					return e;
+				}
+			}
+		}
+
+		// Made without holding the lock. Should another thread race us to it,
+		// we end up with two equal entries, which is harmless.
+		SincKernelCacheEntry *const e = new SincKernelCacheEntry(phases, phaseLen, fc, win, gain);
+		e->refs = 1;
+		std::lock_guard<std::mutex> lock(mut_);
+		list_.push_front(e);
+		return e;
+	}
+
+	void release(SincKernelCacheEntry *e) {
+		std::lock_guard<std::mutex> lock(mut_);
+		if (--e->refs)
+			return;
+
+		std::size_t unreferenced = 0;
+		for (List::iterator it = list_.begin(); it != list_.end();) {
+			if ((*it)->refs == 0 && ++unreferenced > max_unreferenced_kernels) {
+				delete *it;
+				it = list_.erase(it);
+			} else
+				++it;
+		}
+	}
+
+private:
+	typedef std::list<SincKernelCacheEntry *> List;
+
+	std::mutex mut_;
+	List list_; // most recently acquired first
+};
+
+} // anon namespace
+
+SharedSincKernel::SharedSincKernel(int const phases, int const phaseLen, double const fc,
+                                   double (*const win)(long m, long M), double const gain)
+: entry_(SincKernelCache::instance().acquire(phases, phaseLen, fc, win, gain))
+, kernel_(entry_->kernel)
+{
+}
+
+SharedSincKernel::~SharedSincKernel() {
+	SincKernelCache::instance().release(entry_);
+}
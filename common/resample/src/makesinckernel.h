@@ -19,7 +19,30 @@
 #ifndef MAKE_SINC_KERNEL_H
 #define MAKE_SINC_KERNEL_H
 
+#include "uncopyable.h"
+
+struct SincKernelCacheEntry;
+
 void makeSincKernel(short *kernel, int phases, int phaseLen,
                     double fc, double (*win)(long m, long M), double gain);
 
+/**
+  * A sinc kernel as made by makeSincKernel, shared by all instances constructed with
+  * the same arguments. A small number of kernels that are no longer referenced are
+  * kept around, such that recreating a resampler with the same parameters (as is done
+  * on audio reconfiguration) does not need to recompute the kernel.
+  */
+class SharedSincKernel : Uncopyable {
+public:
+	SharedSincKernel(int phases, int phaseLen,
+	                 double fc, double (*win)(long m, long M), double gain);
+	~SharedSincKernel();
+	short const * get() const { return kernel_; }
+	operator short const *() const { return kernel_; }
+
+private:
+	SincKernelCacheEntry *const entry_;
+	short const *const kernel_;
+};
+
 #endif
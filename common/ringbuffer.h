@@ -20,9 +20,13 @@
 #define RINGBUFFER_H
 
 #include "array.h"
+#include "uncopyable.h"
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cstddef>
 #include <cstring>
+#include <thread>
 
 template<typename T>
 class RingBuffer {
@@ -106,4 +110,137 @@ void RingBuffer<T>::write(T const *in, std::size_t num) {
 		wpos_ = 0;
 }
 
+// Producer wait strategy for SpscRingBuffer::writeAll. Yields a few times, then sleeps
+// for exponentially growing periods up to maxSleepUsecs, so a producer waiting on a
+// slow consumer neither burns a core nor oversleeps by much.
+class SpscBackoff {
+public:
+	explicit SpscBackoff(unsigned long maxSleepUsecs = 1000)
+	: maxSleep_(maxSleepUsecs), n_(0)
+	{
+	}
+
+	void operator()() {
+		if (n_ < num_yields) {
+			std::this_thread::yield();
+		} else {
+			unsigned long const usecs = 50ul << (n_ - num_yields);
+			std::this_thread::sleep_for(std::chrono::microseconds(std::min(usecs, maxSleep_)));
+		}
+
+		if (n_ < num_yields + max_sleep_doublings)
+			++n_;
+	}
+
+private:
+	enum { num_yields = 4, max_sleep_doublings = 5 };
+	unsigned long maxSleep_;
+	unsigned n_;
+};
+
+// Lock-free variant of RingBuffer for exactly one producer thread and one consumer
+// thread. Only the producer may call write, writeAll and avail, and only the consumer
+// may call read and used. Only writeAll blocks; the others transfer as much as
+// currently fits/is available and return the count.
+template<typename T>
+class SpscRingBuffer : Uncopyable {
+public:
+	explicit SpscRingBuffer(std::size_t size)
+	: buf_(size + 1), rpos_(0), wpos_(0)
+	{
+	}
+
+	// Not thread safe. Only call while neither side is active.
+	void clear() {
+		rpos_.store(0, std::memory_order_relaxed);
+		wpos_.store(0, std::memory_order_relaxed);
+	}
+
+	// Not thread safe. Only call while neither side is active.
+	void fill(T value) {
+		std::fill(buf_.get(), buf_.get() + buf_.size(), value);
+		rpos_.store(0, std::memory_order_relaxed);
+		wpos_.store(buf_.size() - 1, std::memory_order_relaxed);
+	}
+
+	std::size_t read(T *out, std::size_t num);
+	std::size_t write(T const *in, std::size_t num);
+
+	// Writes all of in, calling wait() whenever the buffer is full. wait is copied
+	// afresh after every partial write, so stateful strategies restart once the
+	// consumer makes progress.
+	template<class Wait>
+	void writeAll(T const *in, std::size_t num, Wait const &wait) {
+		for (Wait w = wait;;) {
+			std::size_t const n = write(in, num);
+			in += n;
+			num -= n;
+			if (!num)
+				return;
+
+			if (n)
+				w = wait;
+
+			w();
+		}
+	}
+
+	std::size_t avail() const {
+		return free(wpos_.load(std::memory_order_relaxed),
+		            rpos_.load(std::memory_order_acquire));
+	}
+
+	std::size_t used() const {
+		return used(rpos_.load(std::memory_order_relaxed),
+		            wpos_.load(std::memory_order_acquire));
+	}
+
+	std::size_t size() const {
+		return buf_.size() - 1;
+	}
+
+private:
+	Array<T> const buf_;
+	std::atomic<std::size_t> rpos_;
+	std::atomic<std::size_t> wpos_;
+
+	std::size_t used(std::size_t rpos, std::size_t wpos) const {
+		return (wpos < rpos ? buf_.size() : 0) + wpos - rpos;
+	}
+
+	std::size_t free(std::size_t wpos, std::size_t rpos) const {
+		return (wpos < rpos ? 0 : buf_.size()) + rpos - wpos - 1;
+	}
+};
+
+template<typename T>
+std::size_t SpscRingBuffer<T>::read(T *out, std::size_t const num) {
+	std::size_t const endpos = buf_.size();
+	std::size_t rpos = rpos_.load(std::memory_order_relaxed);
+	std::size_t const n = std::min(num, used(rpos, wpos_.load(std::memory_order_acquire)));
+	std::size_t const first = std::min(n, endpos - rpos);
+	std::memcpy(out, buf_ + rpos, first * sizeof *out);
+	std::memcpy(out + first, buf_.get(), (n - first) * sizeof *out);
+	if ((rpos += n) >= endpos)
+		rpos -= endpos;
+
+	rpos_.store(rpos, std::memory_order_release);
+	return n;
+}
+
+template<typename T>
+std::size_t SpscRingBuffer<T>::write(T const *in, std::size_t const num) {
+	std::size_t const endpos = buf_.size();
+	std::size_t wpos = wpos_.load(std::memory_order_relaxed);
+	std::size_t const n = std::min(num, free(wpos, rpos_.load(std::memory_order_acquire)));
+	std::size_t const first = std::min(n, endpos - wpos);
+	std::memcpy(buf_ + wpos, in, first * sizeof *in);
+	std::memcpy(buf_.get(), in + first, (n - first) * sizeof *in);
+	if ((wpos += n) >= endpos)
+		wpos -= endpos;
+
+	wpos_.store(wpos, std::memory_order_release);
+	return n;
+}
+
 #endif
@@ -0,0 +1,298 @@
+//
+//   Copyright (C) 2026 by the Gambatte contributors
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License version 2 for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   version 2 along with this program; if not, write to the
+//   Free Software Foundation, Inc.,
+//   51 Franklin St, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+
+#include <batchrunner.h>
+#include <gambatte.h>
+#include <inputmovie.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+using gambatte::InputGetter;
+
+struct ButtonName {
+	char const *name;
+	unsigned button;
+};
+
+ButtonName const buttonNames[] = {
+	{ "A", InputGetter::A }, { "B", InputGetter::B },
+	{ "SELECT", InputGetter::SELECT }, { "START", InputGetter::START },
+	{ "RIGHT", InputGetter::RIGHT }, { "LEFT", InputGetter::LEFT },
+	{ "UP", InputGetter::UP }, { "DOWN", InputGetter::DOWN }
+};
+
+// Parses buttons like "A+START", or "-" for none.
+bool parseButtons(std::string const &s, unsigned &buttons) {
+	buttons = 0;
+	if (s == "-")
+		return true;
+
+	std::size_t pos = 0;
+	for (;;) {
+		std::size_t const end = std::min(s.find('+', pos), s.size());
+		std::string const name = s.substr(pos, end - pos);
+		std::size_t i = 0;
+		while (i < sizeof buttonNames / sizeof buttonNames[0] && name != buttonNames[i].name)
+			++i;
+
+		if (i == sizeof buttonNames / sizeof buttonNames[0])
+			return false;
+
+		buttons |= buttonNames[i].button;
+		if (end == s.size())
+			return true;
+
+		pos = end + 1;
+	}
+}
+
+// Reads the lines of a file that are neither empty nor comments.
+bool readLines(std::string const &path, std::vector<std::string> &lines,
+		std::vector<unsigned> &lineNumbers) {
+	std::ifstream file(path.c_str());
+	if (!file)
+		return false;
+
+	std::string line;
+	for (unsigned n = 1; std::getline(file, line); ++n) {
+		std::size_t const start = line.find_first_not_of(" \t\r");
+		if (start != std::string::npos && line[start] != '#') {
+			lines.push_back(line);
+			lineNumbers.push_back(n);
+		}
+	}
+
+	return true;
+}
+
+bool readInputScript(std::string const &path, std::vector<gambatte::InputChange> &input) {
+	std::vector<std::string> lines;
+	std::vector<unsigned> lineNumbers;
+	if (!readLines(path, lines, lineNumbers)) {
+		std::fprintf(stderr, "Failed to open input script %s\n", path.c_str());
+		return false;
+	}
+
+	for (std::size_t i = 0; i < lines.size(); ++i) {
+		std::istringstream ss(lines[i]);
+		std::string buttons;
+		gambatte::InputChange in;
+		if (!(ss >> in.frame >> buttons) || !parseButtons(buttons, in.buttons)
+				|| (!input.empty() && in.frame < input.back().frame)) {
+			std::fprintf(stderr, "%s:%u: expected a frame number, in order, and buttons\n",
+			             path.c_str(), lineNumbers[i]);
+			return false;
+		}
+
+		input.push_back(in);
+	}
+
+	return true;
+}
+
+// romHashes gets the ROM image hash each job's input movie was recorded on, or 0
+// for jobs without one.
+bool readManifest(std::string const &path, std::vector<gambatte::BatchJob> &jobs,
+		std::vector<gambatte::uint_least64_t> &romHashes) {
+	std::vector<std::string> lines;
+	std::vector<unsigned> lineNumbers;
+	if (!readLines(path, lines, lineNumbers)) {
+		std::fprintf(stderr, "Failed to open manifest %s\n", path.c_str());
+		return false;
+	}
+
+	for (std::size_t i = 0; i < lines.size(); ++i) {
+		std::istringstream ss(lines[i]);
+		gambatte::BatchJob job;
+		std::string frames, input;
+		if (!(ss >> frames >> job.romfile)
+				|| (frames != "-" && !(std::istringstream(frames) >> job.frames))) {
+			std::fprintf(stderr, "%s:%u: expected a frame count and a ROM image file\n",
+			             path.c_str(), lineNumbers[i]);
+			return false;
+		}
+
+		gambatte::InputMovie movie;
+		gambatte::uint_least64_t romHash = 0;
+		if (ss >> input && gambatte::loadInputMovie(movie, input)) {
+			job.loadFlags = movie.loadFlags;
+			job.input.swap(movie.input);
+			job.startState.swap(movie.startState);
+			romHash = movie.romHash;
+			if (frames == "-")
+				job.frames = movie.frames;
+		} else if (!input.empty() && !readInputScript(input, job.input))
+			return false;
+
+		if (frames == "-" && !romHash) {
+			std::fprintf(stderr, "%s:%u: a frame count of - needs an input movie\n",
+			             path.c_str(), lineNumbers[i]);
+			return false;
+		}
+
+		jobs.push_back(job);
+		romHashes.push_back(romHash);
+	}
+
+	return true;
+}
+
+gambatte::uint_least64_t hashVideo(std::vector<gambatte::uint_least32_t> const &videoBuf) {
+	gambatte::uint_least64_t h = 14695981039346656037ull;
+	for (std::size_t i = 0; i < videoBuf.size(); ++i)
+		h = (h ^ videoBuf[i]) * 1099511628211ull & 0xFFFFFFFFFFFFFFFFull;
+
+	return h;
+}
+
+struct JobSummary {
+	gambatte::LoadRes loadres;
+	gambatte::uint_least64_t romHash;
+	gambatte::uint_least64_t videoHash;
+	gambatte::uint_least64_t audioHash;
+	gambatte::uint_least64_t stateHash;
+	bool stateWritten;
+};
+
+// Keeps what is printed for each job, and writes states to files. Every job has
+// its own summary, so workers never write to the same one.
+class Listener : public gambatte::BatchListener {
+public:
+	Listener(std::size_t jobs, std::string const &stateDir)
+	: summaries_(jobs), stateDir_(stateDir)
+	{
+	}
+
+	JobSummary const & summary(std::size_t job) const { return summaries_[job]; }
+
+	virtual void jobDone(gambatte::BatchResult const &result) {
+		JobSummary &s = summaries_[result.job];
+		s.loadres = result.loadres;
+		s.romHash = result.romHash;
+		s.videoHash = hashVideo(result.videoBuf);
+		s.audioHash = result.audioHash;
+		s.stateHash = result.stateHash;
+		s.stateWritten = true;
+		if (!stateDir_.empty() && result.loadres == gambatte::LOADRES_OK) {
+			std::ostringstream path;
+			path << stateDir_ << '/' << result.job << ".gqs";
+			std::ofstream file(path.str().c_str(), std::ios::binary);
+			file.write(&result.state[0], result.state.size());
+			s.stateWritten = file.good();
+		}
+	}
+
+private:
+	std::vector<JobSummary> summaries_;
+	std::string const stateDir_;
+};
+
+void printUsage() {
+	std::puts("Usage: gambatte_batch [-j threads] [-s statedir] manifest\n"
+	          "  Runs the jobs in manifest on a pool of threads, one per hardware thread\n"
+	          "  by default, and prints one line per job: the job number, the load\n"
+	          "  result, and hashes of the last video frame, of the audio and of the state.\n"
+	          "  With -s, also writes each job's final state to statedir/<job>.gqs.\n"
+	          "\n"
+	          "  Each manifest line is a job: a frame count, a ROM image file, and\n"
+	          "  optionally an input script or input movie. Each input script line is a\n"
+	          "  frame number and the buttons held from that frame on, like A+START, or -\n"
+	          "  for none. Lines starting with # are comments. Paths cannot contain\n"
+	          "  whitespace.\n"
+	          "\n"
+	          "  An input movie, as recorded by gambatte_sdl --record, is played from its\n"
+	          "  start state with the load flags it was recorded with, and the job fails\n"
+	          "  with wrong-rom if the ROM image is not the one it was recorded on. A\n"
+	          "  frame count of - plays all of the movie.");
+}
+
+} // anon namespace
+
+int main(int argc, char **argv) {
+	unsigned threads = 0;
+	std::string stateDir;
+	char const *manifest = 0;
+
+	for (int i = 1; i < argc; ++i) {
+		if (!std::strcmp(argv[i], "-j") && i + 1 < argc) {
+			threads = std::atoi(argv[++i]);
+		} else if (!std::strcmp(argv[i], "-s") && i + 1 < argc) {
+			stateDir = argv[++i];
+		} else if (argv[i][0] != '-' && !manifest) {
+			manifest = argv[i];
+		} else {
+			printUsage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (!manifest) {
+		printUsage();
+		return EXIT_FAILURE;
+	}
+
+	std::vector<gambatte::BatchJob> jobs;
+	std::vector<gambatte::uint_least64_t> romHashes;
+	if (!readManifest(manifest, jobs, romHashes))
+		return EXIT_FAILURE;
+
+	for (std::size_t i = 0; i < jobs.size(); ++i)
+		jobs[i].saveState = !stateDir.empty();
+
+	gambatte::BatchRunner runner(threads);
+	Listener listener(jobs.size(), stateDir);
+	std::chrono::steady_clock::time_point const start = std::chrono::steady_clock::now();
+	runner.run(jobs, listener);
+	double const secs = std::chrono::duration<double>(
+		std::chrono::steady_clock::now() - start).count();
+
+	bool ok = true;
+	unsigned long long frames = 0;
+	for (std::size_t i = 0; i < jobs.size(); ++i) {
+		JobSummary const &s = listener.summary(i);
+		bool const wrongRom = s.loadres == gambatte::LOADRES_OK
+		                   && romHashes[i] && s.romHash != romHashes[i];
+		std::printf("%lu %s %016llx %016llx %016llx %s\n", static_cast<unsigned long>(i),
+		            wrongRom ? "wrong-rom"
+		                     : s.loadres == gambatte::LOADRES_OK ? "ok" : to_string(s.loadres).c_str(),
+		            static_cast<unsigned long long>(s.videoHash),
+		            static_cast<unsigned long long>(s.audioHash),
+		            static_cast<unsigned long long>(s.stateHash), jobs[i].romfile.c_str());
+		if (s.loadres != gambatte::LOADRES_OK || wrongRom || !s.stateWritten) {
+			ok = false;
+			if (!s.stateWritten)
+				std::fprintf(stderr, "Failed to write the state of job %lu\n",
+				             static_cast<unsigned long>(i));
+		} else
+			frames += jobs[i].frames;
+	}
+
+	std::fprintf(stderr, "%lu jobs, %llu frames in %.2f s on %u threads, %.0f frames/s\n",
+	             static_cast<unsigned long>(jobs.size()), frames, secs, runner.threads(),
+	             secs > 0 ? frames / secs : 0.0);
+	return ok ? 0 : EXIT_FAILURE;
+}
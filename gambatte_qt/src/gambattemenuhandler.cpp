@@ -356,6 +356,7 @@ GambatteMenuHandler::GambatteMenuHandler(MainWindow &mw,
 			}
 
 			connect(this, SIGNAL(romLoaded(bool)), stateSlotMenu, SLOT(setEnabled(bool)));
+			connect(stateSlotMenu, SIGNAL(aboutToShow()), this, SLOT(updateStateSlotActions()));
 		}
 
 		fileMenu->addSeparator();
@@ -443,6 +444,7 @@ GambatteMenuHandler::GambatteMenuHandler(MainWindow &mw,
 	connect(&source, SIGNAL(nextStateSlot()), this, SLOT(nextStateSlot()));
 	connect(&source, SIGNAL(saveStateSignal()), this, SLOT(saveState()));
 	connect(&source, SIGNAL(loadStateSignal()), this, SLOT(loadState()));
+	connect(&source, SIGNAL(stateFileWriteFailure()), this, SLOT(stateFileWriteFailure()));
 	connect(&source, SIGNAL(quit()), qApp, SLOT(closeAllWindows()));
 	connect(videoDialog_, SIGNAL(accepted()), this, SLOT(videoDialogChange()));
 	connect(soundDialog_, SIGNAL(accepted()), this, SLOT(soundDialogChange()));
@@ -647,6 +649,11 @@ struct SetSaveDirFun {
 	void operator()() const { source.setSavedir(path.toLocal8Bit().constData()); }
 };
 
+struct SetRunAheadFramesFun {
+	GambatteSource &source; int frames;
+	void operator()() const { source.setRunAheadFrames(frames); }
+};
+
 } // anon ns
 
 void GambatteMenuHandler::setDmgPaletteColors() {
@@ -676,6 +683,8 @@ void GambatteMenuHandler::soundDialogChange() {
 void GambatteMenuHandler::miscDialogChange() {
 	SetSaveDirFun const setSaveDirFun = { source_, miscDialog_->savePath() };
 	mw_.callInWorkerThread(setSaveDirFun);
+	SetRunAheadFramesFun const setRunAheadFramesFun = { source_, miscDialog_->runAheadFrames() };
+	mw_.callInWorkerThread(setRunAheadFramesFun);
 	mw_.setDwmTripleBuffer(miscDialog_->dwmTripleBuf());
 	mw_.setFastForwardSpeed(miscDialog_->turboSpeed());
 	mw_.setPauseOnFocusOut(miscDialog_->pauseOnFocusOut() ? 2 : 0);
@@ -729,6 +738,12 @@ void GambatteMenuHandler::execSoundDialog() {
 	soundDialog_->exec();
 }
 
+void GambatteMenuHandler::stateFileWriteFailure() {
+	TmpPauser tmpPauser(mw_, pauseInc_);
+	QMessageBox::warning(&mw_, tr("State save failure"),
+			tr("Failed to write state file. Check that the save state directory is writable and not full."));
+}
+
 void GambatteMenuHandler::execVideoDialog() {
 	TmpPauser tmpPauser(mw_, pauseInc_);
 	videoDialog_->exec();
@@ -801,6 +816,38 @@ void GambatteMenuHandler::selectStateSlot() {
 	}
 }
 
+// Shows when each slot was saved, and its thumbnail, from the slot index.
+void GambatteMenuHandler::updateStateSlotActions() {
+	TmpPauser tmpPauser(mw_, 4);
+	mw_.waitUntilPaused();
+
+	std::vector<gambatte::StateSlotInfo> slots;
+	std::vector<gambatte::uint_least32_t> thumb;
+	source_.stateSlots(slots);
+	foreach (QAction *action, stateSlotGroup_->actions()) {
+		int const no = action->data().toInt();
+		QString text = "Slot &" + QString::number(no);
+		QIcon icon;
+		for (std::size_t i = 0; i < slots.size(); ++i) {
+			if (slots[i].slot != no)
+				continue;
+
+			text += "   " + QDateTime::fromTime_t(slots[i].saveTime)
+			                   .toString(Qt::DefaultLocaleShortDate);
+			if (source_.stateSlotThumbnail(no, thumb)) {
+				int const w = gambatte::StateSlotInfo::thumb_width;
+				int const h = gambatte::StateSlotInfo::thumb_height;
+				QImage const image(reinterpret_cast<uchar const *>(&thumb[0]),
+				                   w, h, w * sizeof thumb[0], QImage::Format_RGB32);
+				icon = QIcon(QPixmap::fromImage(image));
+			}
+		}
+
+		action->setText(text);
+		action->setIcon(icon);
+	}
+}
+
 void GambatteMenuHandler::saveState() {
 	SaveStateFun fun = { source_, MainWindow::FrameBuffer(mw_) };
 	mw_.callInWorkerThread(fun);
@@ -178,6 +178,7 @@ private slots:
 	void prevStateSlot();
 	void nextStateSlot();
 	void selectStateSlot();
+	void updateStateSlotActions();
 	void saveState();
 	void saveStateAs();
 	void loadState();
@@ -188,6 +189,7 @@ private slots:
 	void escPressed();
 	void videoBlitterFailure();
 	void audioEngineFailure();
+	void stateFileWriteFailure();
 	void toggleFullScreen();
 	void saveWindowSizeIfNotFullScreen();
 };
@@ -148,6 +148,7 @@ GambatteSource::GambatteSource()
 , inputDialog_(createInputDialog())
 , pxformat_(PixelBuffer::RGB32)
 , vsrci_(0)
+, runAheadFrames_(0)
 , inputState_()
 , dpadUp_(false)
 , dpadDown_(false)
@@ -286,9 +287,16 @@ std::ptrdiff_t GambatteSource::update(
 	std::ptrdiff_t const vidFrameSampleNo =
 		gb_.runFor(gbvidbuf.pixels, gbvidbuf.pitch,
 		           ptr_cast<quint32>(soundBuf), samples);
-	if (vidFrameSampleNo >= 0)
+	if (vidFrameSampleNo >= 0) {
+		if (runAheadFrames_ && gbvidbuf.pixels)
+			gb_.runAhead(runAheadFrames_, gbvidbuf.pixels, gbvidbuf.pitch);
+
 		inputDialog_->consumeAutoPress();
 
+		if (!gb_.pollStateFiles())
+			emit stateFileWriteFailure();
+	}
+
 	return vidFrameSampleNo;
 }
 
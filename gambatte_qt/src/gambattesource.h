@@ -44,12 +44,19 @@ public:
 	}
 
 	void setSavedir(std::string const &sdir) { gb_.setSaveDir(sdir); }
+	void setRunAheadFrames(unsigned frames) { runAheadFrames_ = frames; }
 	void setVideoSource(std::size_t videoSourceIndex);
 	bool isCgb() const { return gb_.isCgb(); }
 	std::string const romTitle() const { return gb_.romTitle(); }
 	gambatte::PakInfo pakInfo() const { return gb_.pakInfo(); }
 	void selectState(int n) { gb_.selectState(n); }
 	int currentState() const { return gb_.currentState(); }
+	void stateSlots(std::vector<gambatte::StateSlotInfo> &slots) { gb_.stateSlots(slots); }
+
+	bool stateSlotThumbnail(int slot, std::vector<gambatte::uint_least32_t> &thumb) {
+		return gb_.stateSlotThumbnail(slot, thumb);
+	}
+
 	void saveState(PixelBuffer const &fb, std::string const &filepath);
 	void loadState(std::string const &filepath) { gb_.loadState(filepath); }
 	QDialog * inputDialog() const { return inputDialog_; }
@@ -73,6 +80,7 @@ signals:
 	void nextStateSlot();
 	void saveStateSignal();
 	void loadStateSignal();
+	void stateFileWriteFailure();
 	void quit();
 
 private:
@@ -92,6 +100,7 @@ private:
 	scoped_ptr<VideoLink> vfilter_;
 	PixelBuffer::PixelFormat pxformat_;
 	std::size_t vsrci_;
+	unsigned runAheadFrames_;
 	bool inputState_[10];
 	bool dpadUp_, dpadDown_;
 	bool dpadLeft_, dpadRight_;
@@ -30,6 +30,7 @@
 MiscDialog::MiscDialog(QString const &savepath, QWidget *parent)
 : QDialog(parent)
 , turboSpeedBox(new QSpinBox(this))
+, runAheadBox(new QSpinBox(this))
 , pauseOnDialogs_(new QCheckBox(tr("Pause when displaying dialogs"), this), "misc/pauseOnDialogs", true)
 , pauseOnFocusOut_(new QCheckBox(tr("Pause on focus out"), this), "misc/pauseOnFocusOut", false)
 , fpsSelector_(this)
@@ -41,10 +42,12 @@ MiscDialog::MiscDialog(QString const &savepath, QWidget *parent)
                     std::make_pair(tr("Same folder as ROM image"), QString()),
                     this)
 , turboSpeed_(8)
+, runAheadFrames_(0)
 {
 	setWindowTitle(tr("Miscellaneous Settings"));
 	turboSpeedBox->setRange(2, 16);
 	turboSpeedBox->setSuffix("x");
+	runAheadBox->setRange(0, 8);
 
 	QVBoxLayout *const mainLayout = new QVBoxLayout(this);
 	QVBoxLayout *const topLayout = addLayout(mainLayout, new QVBoxLayout);
@@ -55,6 +58,14 @@ MiscDialog::MiscDialog(QString const &savepath, QWidget *parent)
 		hLayout->addWidget(turboSpeedBox);
 	}
 
+	{
+		QHBoxLayout *hLayout = addLayout(topLayout, new QHBoxLayout);
+		hLayout->addWidget(new QLabel(tr("Run-ahead frames:")));
+		hLayout->addWidget(runAheadBox);
+		runAheadBox->setToolTip(tr(
+			"Hides input lag by showing frames this many frames ahead, at the cost of emulating them."));
+	}
+
 	addLayout(topLayout, new QHBoxLayout)->addWidget(pauseOnDialogs_.checkBox());
 	addLayout(topLayout, new QHBoxLayout)->addWidget(pauseOnFocusOut_.checkBox());
 
@@ -93,17 +104,22 @@ MiscDialog::MiscDialog(QString const &savepath, QWidget *parent)
 
 	turboSpeed_ = std::min(std::max(QSettings().value("misc/turboSpeed", turboSpeed_).toInt(), 2),
 	                       16);
+	runAheadFrames_ = std::min(std::max(QSettings().value("misc/runAheadFrames",
+	                                                      runAheadFrames_).toInt(), 0),
+	                           8);
 	restore();
 }
 
 MiscDialog::~MiscDialog() {
 	QSettings settings;
 	settings.setValue("misc/turboSpeed", turboSpeed_);
+	settings.setValue("misc/runAheadFrames", runAheadFrames_);
 }
 
 void MiscDialog::restore() {
 	fpsSelector_.reject();
 	turboSpeedBox->setValue(turboSpeed_);
+	runAheadBox->setValue(runAheadFrames_);
 	pauseOnDialogs_.reject();
 	pauseOnFocusOut_.reject();
 	dwmTripleBuf_.reject();
@@ -114,6 +130,7 @@ void MiscDialog::restore() {
 void MiscDialog::accept() {
 	fpsSelector_.accept();
 	turboSpeed_ = turboSpeedBox->value();
+	runAheadFrames_ = runAheadBox->value();
 	pauseOnDialogs_.accept();
 	pauseOnFocusOut_.accept();
 	dwmTripleBuf_.accept();
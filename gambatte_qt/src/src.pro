@@ -29,7 +29,7 @@ macx:TARGET = "Gambatte Qt"
 DESTDIR = ../bin
 INCLUDEPATH += ../../libgambatte/include
 DEPENDPATH  += ../../libgambatte/include
-LIBS += -L../../libgambatte -lgambatte -lz
+LIBS += -L../../libgambatte -lgambatte -lz -pthread
 exists(../../.git) {
 	MY_GIT_REVNO = $$system(git rev-list HEAD --count)
 	!isEmpty(MY_GIT_REVNO):DEFINES += GAMBATTE_QT_VERSION_STR='\\"r$$MY_GIT_REVNO\\"'
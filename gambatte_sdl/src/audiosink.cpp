@@ -17,7 +17,6 @@
 //
 
 #include "audiosink.h"
-#include <SDL_thread.h>
 #include <cstdio>
 
 namespace {
@@ -56,26 +55,15 @@ static int openAudio(long srate, std::size_t samples,
 	return 0;
 }
 
-class LockGuard {
-public:
-	explicit LockGuard(SDL_mutex *m) : m_(m) { SDL_mutexP(m); }
-private:
-	struct LockDeleter { static void del(SDL_mutex *m) { SDL_mutexV(m); } };
-	scoped_ptr<SDL_mutex, LockDeleter> const m_;
-};
-
 } // anon ns
 
-struct AudioSink::SdlDeleter {
-	static void del(SDL_mutex *m) { SDL_DestroyMutex(m); }
-	static void del(SDL_cond *c) { SDL_DestroyCond(c); }
-};
-
 AudioSink::AudioSink(long const srate, int const latency, int const periods)
 : rbuf_(nearestPowerOf2(srate * latency / ((periods + 1) * 1000)) * periods * 2)
 , rateEst_(srate, rbuf_.size() / periods)
-, mut_(SDL_CreateMutex())
-, bufReadyCond_(SDL_CreateCond())
+, rate_(rateEst_.result())
+, underruns_(0)
+, minFill_(rbuf_.size() / 2)
+, periodUsecs_(rbuf_.size() / 2 / periods * 1000000ull / srate)
 , failed_(openAudio(srate, rbuf_.size() / 2 / periods, fillBuffer, this) < 0)
 {
 	rbuf_.fill(0);
@@ -88,19 +76,14 @@ AudioSink::~AudioSink() {
 
 AudioSink::Status AudioSink::write(Sint16 const *inBuf, std::size_t samples) {
 	if (failed_)
-		return Status(rbuf_.size() / 2, 0, rateEst_.result());
-
-	LockGuard lock(mut_.get());
-	Status const status(rbuf_.used() / 2, rbuf_.avail() / 2, rateEst_.result());
+		return Status(rbuf_.size() / 2, 0, rate_, 0, rbuf_.size() / 2);
 
-	for (std::size_t avail; (avail = rbuf_.avail() / 2) < samples;) {
-		rbuf_.write(inBuf, avail * 2);
-		inBuf += avail * 2;
-		samples -= avail;
-		SDL_CondWait(bufReadyCond_.get(), mut_.get());
-	}
+	std::size_t const avail = rbuf_.avail();
+	Status const status((rbuf_.size() - avail) / 2, avail / 2, rate_, underruns_,
+	                    minFill_.exchange(rbuf_.size() / 2));
 
-	rbuf_.write(inBuf, samples * 2);
+	// Sleep at most half a period at a time while waiting for the callback to make room.
+	rbuf_.writeAll(inBuf, samples * 2, SpscBackoff(periodUsecs_ / 2));
 	return status;
 }
 
@@ -108,8 +91,15 @@ void AudioSink::read(Uint8 *const stream, std::size_t const len) {
 	if (failed_)
 		return;
 
-	LockGuard lock(mut_.get());
-	rbuf_.read(reinterpret_cast<Sint16 *>(stream), std::min(len / 2, rbuf_.used()));
+	std::size_t const used = rbuf_.used();
+	if (used < len / 2)
+		++underruns_;
+
+	long const fill = used / 2;
+	long min = minFill_;
+	while (fill < min && !minFill_.compare_exchange_weak(min, fill)) {}
+
+	rbuf_.read(reinterpret_cast<Sint16 *>(stream), len / 2);
 	rateEst_.feed(len / 4);
-	SDL_CondSignal(bufReadyCond_.get());
+	rate_ = rateEst_.result();
 }
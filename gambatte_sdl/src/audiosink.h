@@ -21,8 +21,8 @@
 
 #include "ringbuffer.h"
 #include "rateest.h"
-#include "scoped_ptr.h"
 #include <SDL.h>
+#include <atomic>
 #include <cstddef>
 
 class AudioSink {
@@ -31,9 +31,12 @@ public:
 		long fromUnderrun;
 		long fromOverflow;
 		long rate;
+		long underruns;
+		long minFill; // lowest fill seen by the audio callback since the previous write
 
-		Status(long fromUnderrun, long fromOverflow, long rate)
+		Status(long fromUnderrun, long fromOverflow, long rate, long underruns, long minFill)
 		: fromUnderrun(fromUnderrun), fromOverflow(fromOverflow), rate(rate)
+		, underruns(underruns), minFill(minFill)
 		{
 		}
 	};
@@ -43,12 +46,14 @@ public:
 	Status write(Sint16 const *inBuf, std::size_t samples);
 
 private:
-	struct SdlDeleter;
-
-	RingBuffer<Sint16> rbuf_;
-	RateEst rateEst_;
-	scoped_ptr<SDL_mutex, SdlDeleter> const mut_;
-	scoped_ptr<SDL_cond, SdlDeleter> const bufReadyCond_;
+	// write runs on the emulation thread and read on the SDL audio thread. They only
+	// share rbuf_ and the atomics below, so neither ever waits on the other's locks.
+	SpscRingBuffer<Sint16> rbuf_;
+	RateEst rateEst_; // audio thread only
+	std::atomic<long> rate_;
+	std::atomic<long> underruns_;
+	std::atomic<long> minFill_;
+	unsigned long const periodUsecs_;
 	bool const failed_;
 
 	static void fillBuffer(void *data, Uint8 *stream, int len) {
@@ -22,13 +22,17 @@
 #include "parser.h"
 #include "resample/resampler.h"
 #include "resample/resamplerinfo.h"
+#include "ringbuffer.h"
+#include "scoped_ptr.h"
 #include "skipsched.h"
 #include "str_to_sdlkey.h"
 #include "videolink/vfilterinfo.h"
 #include <gambatte.h>
+#include <inputmovie.h>
 #include <pakinfo.h>
 #include <SDL.h>
 #include <algorithm>
+#include <atomic>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
@@ -151,6 +155,76 @@ private:
 	int periods_;
 };
 
+class RewindOption : public DescOption {
+public:
+	RewindOption()
+	: DescOption("rewind-buffer", 0, 1)
+	, mib_(0)
+	{
+	}
+
+	virtual void exec(char const *const *argv, int index) {
+		int m = std::atoi(argv[index + 1]);
+		if (m < 0 || m > 1024)
+			return;
+
+		mib_ = m;
+	}
+
+	virtual std::string const desc() const {
+		return " N\t\tUse up to N MiB for rewind snapshots, which\n"
+		       "\t\t\t\tenables rewinding. 0 <= N <= 1024, default: 0\n";
+	}
+
+	std::size_t bytes() const { return std::size_t(mib_) << 20; }
+
+private:
+	int mib_;
+};
+
+class MovieOption : public DescOption {
+public:
+	MovieOption(char const *desc, char const *s)
+	: DescOption(s, 0, 1), desc_(desc)
+	{
+	}
+
+	virtual void exec(char const *const *argv, int index) { path_ = argv[index + 1]; }
+	virtual std::string const desc() const { return desc_; }
+	std::string const & path() const { return path_; }
+
+private:
+	char const *const desc_;
+	std::string path_;
+};
+
+class RunAheadOption : public DescOption {
+public:
+	RunAheadOption()
+	: DescOption("run-ahead", 0, 1)
+	, frames_(0)
+	{
+	}
+
+	virtual void exec(char const *const *argv, int index) {
+		int f = std::atoi(argv[index + 1]);
+		if (f < 0 || f > 8)
+			return;
+
+		frames_ = f;
+	}
+
+	virtual std::string const desc() const {
+		return " N\t\tShow each frame N frames ahead to hide input lag\n"
+		       "\t\t\t\t    0 <= N <= 8, default: 0\n";
+	}
+
+	unsigned frames() const { return frames_; }
+
+private:
+	int frames_;
+};
+
 class ScaleOption : public DescOption {
 public:
 	ScaleOption()
@@ -390,7 +464,7 @@ void InputOption::exec(char const *const *argv, int index) {
 	}
 }
 
-class AudioOut {
+class AudioOut : Uncopyable {
 public:
 	struct Status {
 		long rate;
@@ -400,25 +474,138 @@ public:
 	};
 
 	AudioOut(long sampleRate, int latency, int periods,
-	         ResamplerInfo const &resamplerInfo, std::size_t maxInSamplesPerWrite)
+	         ResamplerInfo const &resamplerInfo, std::size_t maxInSamplesPerWrite,
+	         bool threaded)
 	: resampler_(resamplerInfo.create(2097152, sampleRate, maxInSamplesPerWrite))
 	, resampleBuf_(resampler_->maxOut(maxInSamplesPerWrite) * 2)
 	, sink_(sampleRate, latency, periods)
+	, sampleRate_(sampleRate)
+	, rawq_(threaded ? maxInSamplesPerWrite : 0)
+	, rawInBuf_(threaded ? maxInSamplesPerWrite : 0)
+	, rawData_(threaded ? SDL_CreateSemaphore(0) : 0)
+	, rawSpace_(threaded ? SDL_CreateSemaphore(0) : 0)
+	, thread_(0)
+	, quit_(false)
+	, rate_(sampleRate)
+	, low_(false)
+	, sinkBuffered_(0)
+	, underruns_(0)
+	, minFill_(-1)
+	, delaySum_(0)
+	, delayMax_(0)
+	, writes_(0)
 	{
+		if (threaded)
+			thread_ = SDL_CreateThread(resampleThreadMain, this);
+	}
+
+	~AudioOut() {
+		if (thread_) {
+			quit_ = true;
+			SDL_SemPost(rawData_.get());
+			SDL_WaitThread(thread_, 0);
+		}
 	}
 
 	Status write(Uint32 const *data, std::size_t samples) {
-		long const outsamples = resampler_->resample(
-			resampleBuf_, reinterpret_cast<Sint16 const *>(data), samples);
-		AudioSink::Status const &stat = sink_.write(resampleBuf_, outsamples);
-		bool low = stat.fromUnderrun + outsamples < (stat.fromOverflow - outsamples) * 2;
-		return Status(stat.rate, low);
+		if (thread_) {
+			for (;;) {
+				std::size_t const n = rawq_.write(data, samples);
+				data += n;
+				samples -= n;
+				if (n)
+					signal(rawData_.get());
+				if (!samples)
+					break;
+
+				SDL_SemWait(rawSpace_.get());
+			}
+		} else
+			resampleAndWrite(data, samples);
+
+		recordDelay();
+		return Status(rate_, low_);
+	}
+
+	void printStats() const {
+		std::printf("audio: mean delay %.1f ms, max delay %.1f ms, "
+		            "min buffer fill %.1f ms, %ld underruns\n",
+		            writes_ ? delaySum_ / writes_ / 1000.0 : 0.0, delayMax_ / 1000.0,
+		            std::max(minFill_.load(), 0l) * 1000.0 / sampleRate_,
+		            underruns_.load());
 	}
 
 private:
+	struct SemDeleter { static void del(SDL_sem *s) { SDL_DestroySemaphore(s); } };
+
 	scoped_ptr<Resampler> const resampler_;
 	Array<Sint16> const resampleBuf_;
 	AudioSink sink_;
+	long const sampleRate_;
+
+	// Threaded mode. Native rate samples are passed through rawq_ to a thread that
+	// does the resampling and feeds sink_, which overlaps resampling of one frame
+	// with emulation of the next at the cost of up to rawq_.size() samples of delay.
+	SpscRingBuffer<Uint32> rawq_;
+	Array<Uint32> const rawInBuf_;
+	scoped_ptr<SDL_sem, SemDeleter> const rawData_;
+	scoped_ptr<SDL_sem, SemDeleter> const rawSpace_;
+	SDL_Thread *thread_;
+	std::atomic<bool> quit_;
+
+	// Updated by whichever thread feeds sink_.
+	std::atomic<long> rate_;
+	std::atomic<bool> low_;
+	std::atomic<long> sinkBuffered_;
+	std::atomic<long> underruns_;
+	std::atomic<long> minFill_;
+
+	double delaySum_;
+	usec_t delayMax_;
+	unsigned long writes_;
+
+	static int resampleThreadMain(void *data) {
+		static_cast<AudioOut *>(data)->resampleLoop();
+		return 0;
+	}
+
+	// Wakes up a waiter on s, if any. Posting only from zero keeps the count bounded.
+	static void signal(SDL_sem *s) {
+		if (SDL_SemValue(s) == 0)
+			SDL_SemPost(s);
+	}
+
+	void resampleLoop() {
+		while (!quit_) {
+			if (std::size_t const n = rawq_.read(rawInBuf_, rawInBuf_.size())) {
+				signal(rawSpace_.get());
+				resampleAndWrite(rawInBuf_, n);
+			} else
+				SDL_SemWait(rawData_.get());
+		}
+	}
+
+	void resampleAndWrite(Uint32 const *data, std::size_t samples) {
+		long const outsamples = resampler_->resample(
+			resampleBuf_, reinterpret_cast<Sint16 const *>(data), samples);
+		AudioSink::Status const &stat = sink_.write(resampleBuf_, outsamples);
+		low_ = stat.fromUnderrun + outsamples < (stat.fromOverflow - outsamples) * 2;
+		rate_ = stat.rate;
+		sinkBuffered_ = stat.fromUnderrun + outsamples;
+		underruns_ = stat.underruns;
+		if (minFill_ < 0 || stat.minFill < minFill_)
+			minFill_ = stat.minFill;
+	}
+
+	// Estimated time until the last sample written is played back.
+	void recordDelay() {
+		std::size_t const rawQueued = thread_ ? rawq_.size() - rawq_.avail() : 0;
+		usec_t const delay = rawQueued * 1000000ull / 2097152
+		                   + sinkBuffered_ * 1000000ull / sampleRate_;
+		delaySum_ += delay;
+		delayMax_ = std::max(delayMax_, delay);
+		++writes_;
+	}
 };
 
 class FrameWait {
@@ -480,14 +667,29 @@ private:
 
 class GambatteSdl {
 public:
-	GambatteSdl() { gambatte.setInputGetter(&inputGetter); }
+	GambatteSdl()
+	: movieRecorder(inputGetter)
+	, moviePlayer(movie)
+	, movieMode(movie_off)
+	{
+		gambatte.setInputGetter(&inputGetter);
+	}
+
 	int exec(int argc, char const *const argv[]);
 
 private:
 	typedef std::multimap<SDLKey,  InputGetter::Button> keymap_t;
 	typedef std::multimap<JoyData, InputGetter::Button> jmap_t;
 
+	// Reset, loading state and rewinding would take the emulation off the
+	// movie, so they are disabled while recording or playing one.
+	enum MovieMode { movie_off, movie_record, movie_play };
+
 	GetInput inputGetter;
+	InputMovie movie;
+	InputMovieRecorder movieRecorder;
+	InputMoviePlayer moviePlayer;
+	MovieMode movieMode;
 	GB gambatte;
 	keymap_t keyMap;
 	jmap_t jbMap;
@@ -496,7 +698,9 @@ private:
 
 	bool handleEvents(BlitterWrapper &blitter);
 	int run(long sampleRate, int latency, int periods,
-	        ResamplerInfo const &resamplerInfo, BlitterWrapper &blitter);
+	        ResamplerInfo const &resamplerInfo, bool audioThread, bool audioStats,
+	        unsigned runAheadFrames, BlitterWrapper &blitter);
+	void movieFrameDone();
 };
 
 static void printOptionUsage(DescOption const *const o) {
@@ -535,6 +739,7 @@ static void printValidInputKeys() {
 static void printControls() {
 	std::puts("Controls:");
 	std::puts("TAB\t- fast-forward");
+	std::puts("BACKSPACE\t- rewind while held (needs --rewind-buffer)");
 	std::puts("Ctrl-f\t- toggle full screen");
 	std::puts("Ctrl-r\t- reset");
 	std::puts("F5\t- save state");
@@ -542,6 +747,8 @@ static void printControls() {
 	std::puts("F7\t- next state slot");
 	std::puts("F8\t- load state");
 	std::puts("0 to 9\t- select state slot 0 to 9");
+	std::puts("Rewind, reset and load state are disabled while an input movie");
+	std::puts("is recorded or played.");
 	std::puts("");
 	std::puts("Default key mapping:");
 	std::puts("Up:\tup");
@@ -562,11 +769,18 @@ int GambatteSdl::exec(int const argc, char const *const argv[]) {
 	);
 
 	std::set<Uint8> jdevnums;
+	BoolOption audioStatsOption("\t\tPrint audio delay and underrun statistics on exit\n",
+	                            "audio-stats");
+	BoolOption audioThreadOption("\t\tResample audio on a separate thread\n"
+	                             "\t\t\t\t(experimental)\n",
+	                             "audio-thread");
 	BoolOption fsOption("\t\tStart in full screen mode\n", "full-screen", 'f');
 	LatencyOption latencyOption;
 	PeriodsOption periodsOption;
 	RateOption rateOption;
 	ResamplerOption resamplerOption;
+	RewindOption rewindOption;
+	RunAheadOption runAheadOption;
 	ScaleOption scaleOption;
 	VfOption vfOption;
 	BoolOption yuvOption("\t\tUse YUV overlay for (usually faster) scaling\n",
@@ -577,12 +791,22 @@ int GambatteSdl::exec(int const argc, char const *const argv[]) {
 		"\tSupport certain multicart ROM images by\n"
 		"\t\t\t\tnot strictly respecting ROM header MBC type\n", "multicart-compat");
 	InputOption inputOption;
+	MovieOption playOption(
+		" FILE\t\tPlay back the input movie FILE, then take\n"
+		"\t\t\t\tinput as usual. Prints the state hash at\n"
+		"\t\t\t\tthe end of the movie\n", "play");
+	MovieOption recordOption(
+		" FILE\t\tRecord input to the input movie FILE\n"
+		"\t\t\t\tuntil exit. The cartridge clock runs in\n"
+		"\t\t\t\temulated time while recording or playing\n", "record");
 	int loadIndex = 0;
 
 	{
 		BoolOption controlsOption("\t\tShow keyboard controls\n", "controls");
 		BoolOption lkOption("\t\tList valid input KEYS\n", "list-keys");
 		std::vector<DescOption *> v;
+		v.push_back(&audioStatsOption);
+		v.push_back(&audioThreadOption);
 		v.push_back(&controlsOption);
 		v.push_back(&gbaCgbOption);
 		v.push_back(&forceDmgOption);
@@ -592,8 +816,12 @@ int GambatteSdl::exec(int const argc, char const *const argv[]) {
 		v.push_back(&latencyOption);
 		v.push_back(&lkOption);
 		v.push_back(&periodsOption);
+		v.push_back(&playOption);
 		v.push_back(&rateOption);
+		v.push_back(&recordOption);
 		v.push_back(&resamplerOption);
+		v.push_back(&rewindOption);
+		v.push_back(&runAheadOption);
 		v.push_back(&scaleOption);
 		v.push_back(&vfOption);
 		v.push_back(&yuvOption);
@@ -643,15 +871,46 @@ int GambatteSdl::exec(int const argc, char const *const argv[]) {
 		}
 	}
 
-	if (LoadRes const error =
-			gambatte.load(argv[loadIndex],
-			                gbaCgbOption.isSet()          * GB::GBA_CGB
-			              + forceDmgOption.isSet()        * GB::FORCE_DMG
-			              + multicartCompatOption.isSet() * GB::MULTICART_COMPAT)) {
+	unsigned loadFlags = gbaCgbOption.isSet()          * GB::GBA_CGB
+	                   + forceDmgOption.isSet()        * GB::FORCE_DMG
+	                   + multicartCompatOption.isSet() * GB::MULTICART_COMPAT;
+	if (!playOption.path().empty()) {
+		if (!recordOption.path().empty()) {
+			std::puts("cannot both record and play an input movie");
+			return EXIT_FAILURE;
+		}
+
+		if (!loadInputMovie(movie, playOption.path())) {
+			std::printf("failed to load input movie %s\n", playOption.path().c_str());
+			return EXIT_FAILURE;
+		}
+
+		// The start state has the cartridge RAM. Save files are neither read
+		// nor overwritten.
+		loadFlags = movie.loadFlags | GB::NO_SAVEDATA;
+		movieMode = movie_play;
+	} else if (!recordOption.path().empty())
+		movieMode = movie_record;
+
+	if (movieMode != movie_off)
+		gambatte.setRtcMode(GB::RTC_EMULATED_TIME);
+
+	if (LoadRes const error = gambatte.load(argv[loadIndex], loadFlags)) {
 		std::printf("failed to load ROM %s: %s\n", argv[loadIndex], to_string(error).c_str());
 		return EXIT_FAILURE;
 	}
 
+	if (movieMode == movie_play && !moviePlayer.start(gambatte)) {
+		std::printf("input movie %s was not recorded on ROM %s\n",
+		            playOption.path().c_str(), argv[loadIndex]);
+		return EXIT_FAILURE;
+	}
+
+	if (movieMode == movie_record && !movieRecorder.start(gambatte, loadFlags)) {
+		std::printf("failed to start recording input movie %s\n", recordOption.path().c_str());
+		return EXIT_FAILURE;
+	}
+
 	{
 		PakInfo const &pak = gambatte.pakInfo();
 		std::puts(gambatte.romTitle().c_str());
@@ -661,6 +920,8 @@ int GambatteSdl::exec(int const argc, char const *const argv[]) {
 		std::printf("cgb: %d\n", gambatte.isCgb());
 	}
 
+	gambatte.setRewindBufferSize(rewindOption.bytes());
+
 	SdlIniter sdlIniter;
 	if (sdlIniter.isFailed())
 		return EXIT_FAILURE;
@@ -679,8 +940,20 @@ int GambatteSdl::exec(int const argc, char const *const argv[]) {
 	SDL_ShowCursor(SDL_DISABLE);
 	SDL_WM_SetCaption("Gambatte SDL", 0);
 
-	return run(rateOption.rate(), latencyOption.latency(), periodsOption.periods(),
-	           resamplerOption.resampler(), blitter);
+	int const result = run(rateOption.rate(), latencyOption.latency(), periodsOption.periods(),
+	                       resamplerOption.resampler(), audioThreadOption.isSet(),
+	                       audioStatsOption.isSet(), runAheadOption.frames(), blitter);
+	if (movieMode == movie_record) {
+		if (!saveInputMovie(movieRecorder.movie(), recordOption.path())) {
+			std::printf("failed to save input movie %s\n", recordOption.path().c_str());
+			return EXIT_FAILURE;
+		}
+
+		std::printf("recorded %lu frames to input movie %s\n",
+		            movieRecorder.movie().frames, recordOption.path().c_str());
+	}
+
+	return result;
 }
 
 bool GambatteSdl::handleEvents(BlitterWrapper &blitter) {
@@ -735,7 +1008,11 @@ bool GambatteSdl::handleEvents(BlitterWrapper &blitter) {
 		if (e.key.keysym.mod & KMOD_CTRL) {
 			switch (e.key.keysym.sym) {
 			case SDLK_f: blitter.toggleFullScreen(); break;
-			case SDLK_r: gambatte.reset(); break;
+			case SDLK_r:
+				if (movieMode == movie_off)
+					gambatte.reset();
+
+				break;
 			default: break;
 			}
 		} else {
@@ -747,7 +1024,11 @@ bool GambatteSdl::handleEvents(BlitterWrapper &blitter) {
 				break;
 			case SDLK_F6: gambatte.selectState(gambatte.currentState() - 1); break;
 			case SDLK_F7: gambatte.selectState(gambatte.currentState() + 1); break;
-			case SDLK_F8: gambatte.loadState(); break;
+			case SDLK_F8:
+				if (movieMode == movie_off)
+					gambatte.loadState();
+
+				break;
 			case SDLK_0: gambatte.selectState(0); break;
 			case SDLK_1: gambatte.selectState(1); break;
 			case SDLK_2: gambatte.selectState(2); break;
@@ -787,10 +1068,31 @@ static bool isFastForward(Uint8 const *keys) {
 	return keys[SDLK_TAB];
 }
 
+static bool isRewind(Uint8 const *keys) {
+	return keys[SDLK_BACKSPACE];
+}
+
+void GambatteSdl::movieFrameDone() {
+	if (movieMode == movie_record) {
+		movieRecorder.frameDone();
+	} else if (movieMode == movie_play) {
+		moviePlayer.frameDone();
+		if (moviePlayer.done()) {
+			std::printf("input movie done after %lu frames, state hash %016llx\n",
+			            moviePlayer.frame(),
+			            static_cast<unsigned long long>(gambatte.stateHash()));
+			gambatte.setInputGetter(&inputGetter);
+			movieMode = movie_off;
+		}
+	}
+}
+
 int GambatteSdl::run(long const sampleRate, int const latency, int const periods,
-                     ResamplerInfo const &resamplerInfo, BlitterWrapper &blitter) {
+                     ResamplerInfo const &resamplerInfo, bool const audioThread,
+                     bool const audioStats, unsigned const runAheadFrames,
+                     BlitterWrapper &blitter) {
 	Array<Uint32> const audioBuf(gb_samples_per_frame + gambatte_max_overproduction);
-	AudioOut aout(sampleRate, latency, periods, resamplerInfo, audioBuf.size());
+	AudioOut aout(sampleRate, latency, periods, resamplerInfo, audioBuf.size(), audioThread);
 	FrameWait frameWait;
 	SkipSched skipSched;
 	Uint8 const *const keys = SDL_GetKeyState(0);
@@ -801,7 +1103,7 @@ int GambatteSdl::run(long const sampleRate, int const latency, int const periods
 
 	for (;;) {
 		if (handleEvents(blitter))
-			return 0;
+			break;
 
 		BlitterWrapper::Buf const &vbuf = blitter.inBuf();
 		std::size_t runsamples = gb_samples_per_frame - bufsamples;
@@ -813,16 +1115,39 @@ int GambatteSdl::run(long const sampleRate, int const latency, int const periods
 		bufsamples += runsamples;
 		bufsamples -= outsamples;
 
+		if (vidFrameDoneSampleCnt >= 0) {
+			movieFrameDone();
+
+			// Rewinding would break a movie, so there is no point in snapshots
+			// until it is done.
+			if (movieMode == movie_off) {
+				if (isRewind(keys))
+					gambatte.rewindPop();
+				else
+					gambatte.rewindPush();
+			}
+
+			if (!gambatte.pollStateFiles())
+				std::fprintf(stderr, "failed to write state file\n");
+		}
+
 		if (isFastForward(keys)) {
 			if (vidFrameDoneSampleCnt >= 0) {
+				if (runAheadFrames)
+					gambatte.runAhead(runAheadFrames, vbuf.pixels, vbuf.pitch);
+
 				blitter.draw();
 				blitter.present();
 			}
 		} else {
 			bool const blit = vidFrameDoneSampleCnt >= 0
 			               && !skipSched.skipNext(audioOutBufLow);
-			if (blit)
+			if (blit) {
+				if (runAheadFrames)
+					gambatte.runAhead(runAheadFrames, vbuf.pixels, vbuf.pitch);
+
 				blitter.draw();
+			}
 
 			AudioOut::Status const &astatus = aout.write(audioBuf, outsamples);
 			audioOutBufLow = astatus.low;
@@ -836,6 +1161,12 @@ int GambatteSdl::run(long const sampleRate, int const latency, int const periods
 		std::memmove(audioBuf, audioBuf + outsamples, bufsamples * sizeof *audioBuf);
 	}
 
+	if (audioStats)
+		aout.printStats();
+
+	if (!gambatte.flushStateFiles())
+		std::fprintf(stderr, "failed to write state file\n");
+
 	return 0;
 }
 
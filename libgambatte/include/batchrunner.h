@@ -0,0 +1,130 @@
+//
+//   Copyright (C) 2026 by the Gambatte contributors
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License version 2 for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   version 2 along with this program; if not, write to the
+//   Free Software Foundation, Inc.,
+//   51 Franklin St, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+
+#ifndef GAMBATTE_BATCHRUNNER_H
+#define GAMBATTE_BATCHRUNNER_H
+
+#include "gbint.h"
+#include "inputgetter.h"
+#include "loadres.h"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace gambatte {
+
+/** A ROM image to run for a number of video frames with scripted input. */
+struct BatchJob {
+	std::string romfile;
+
+	/** ORed combination of GB::LoadFlags. */
+	unsigned loadFlags;
+
+	/** Video frames to emulate. */
+	unsigned long frames;
+
+	/** Input changes in frame order. No buttons are held before the first. */
+	std::vector<InputChange> input;
+
+	/**
+	  * State, as saved by GB::saveState(std::vector<char> &), to load after the
+	  * ROM image and run from. Runs from power-on if empty.
+	  */
+	std::vector<char> startState;
+
+	/** Whether the result should include the state, and with it the RAM. */
+	bool saveState;
+
+	BatchJob() : loadFlags(0), frames(0), saveState(false) {}
+};
+
+struct BatchResult {
+	enum { video_width = 160, video_height = 144 };
+
+	/** Index of the job in the list passed to BatchRunner::run. */
+	std::size_t job;
+
+	/**
+	  * Result of loading the ROM image. Nothing was emulated unless LOADRES_OK.
+	  * A start state that fails to load counts as a bad file.
+	  */
+	LoadRes loadres;
+
+	/** GB::romHash of the ROM image, or 0 if it failed to load. */
+	gambatte::uint_least64_t romHash;
+
+	/** video_width x video_height RGB32 (native endian) last video frame. */
+	std::vector<gambatte::uint_least32_t> videoBuf;
+
+	/**
+	  * 64-bit xxHash (XXH64, seed 0) of all audio samples produced, as 32-bit
+	  * values in native byte order.
+	  */
+	gambatte::uint_least64_t audioHash;
+
+	/** GB::stateHash at the end of the job. */
+	gambatte::uint_least64_t stateHash;
+
+	/** GB::saveState at the end of the job, if BatchJob::saveState was set. */
+	std::vector<char> state;
+};
+
+class BatchListener {
+public:
+	virtual ~BatchListener() {}
+
+	/**
+	  * Called on a worker thread as each job finishes, so possibly from several
+	  * threads at once. The result is only valid during the call.
+	  */
+	virtual void jobDone(BatchResult const &result) = 0;
+};
+
+/**
+  * Runs batches of jobs on a pool of worker threads, each with a GB instance of
+  * its own that it reuses from job to job. Jobs are dealt out to the workers up
+  * front, and a worker that runs out of jobs takes the last queued job of
+  * another, so that uneven job lengths do not leave threads idle. ROM images are
+  * loaded with GB::NO_SAVEDATA, so jobs are not affected by save files and never
+  * write them, and run with GB::RTC_EMULATED_TIME from epoch 0, so that their
+  * results do not depend on when they are run. Within a run, ROM images are also
+  * loaded with GB::REUSE_ROM, so a worker that runs jobs on the same ROM image
+  * back to back reads the file only once. ROM files must not change during a run.
+  */
+class BatchRunner {
+public:
+	/** @param threads  number of worker threads, or 0 for one per hardware thread */
+	explicit BatchRunner(unsigned threads = 0);
+	~BatchRunner();
+
+	unsigned threads() const;
+
+	/** Runs every job in jobs, and returns when all are done. */
+	void run(std::vector<BatchJob> const &jobs, BatchListener &listener);
+
+private:
+	struct Priv;
+	Priv *const p_;
+
+	BatchRunner(BatchRunner const &);
+	BatchRunner & operator=(BatchRunner const &);
+};
+
+}
+
+#endif
@@ -0,0 +1,111 @@
+//
+//   Copyright (C) 2026 by the Gambatte contributors
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License version 2 for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   version 2 along with this program; if not, write to the
+//   Free Software Foundation, Inc.,
+//   51 Franklin St, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+
+#ifndef GAMBATTE_BATCHSTEPPER_H
+#define GAMBATTE_BATCHSTEPPER_H
+
+#include "gbint.h"
+#include <cstddef>
+#include <vector>
+
+namespace gambatte {
+
+class GB;
+
+/** size bytes of the address space from address on, as read by GB::peek. */
+struct StepRamRange {
+	unsigned address;
+	unsigned size;
+};
+
+/**
+  * Steps a fixed set of GB instances one video frame at a time in lockstep, on
+  * a pool of threads that each step a contiguous share of the instances, and
+  * writes what each instance shows into arrays the caller provides, at a fixed
+  * stride per instance. Meant for running many environments side by side, as
+  * in reinforcement learning, without copying each frame and RAM out one
+  * instance at a time.
+  *
+  * Each kind of observation goes to an array of its own, where the observation
+  * of instance i starts at element i times the stride of that kind:
+  *  - video:  videoStride() RGB32 (native endian) pixels of the frame, at full
+  *            size or downscaled, row by row.
+  *  - ram:    ramStride() bytes, the RAM ranges one after the other.
+  *  - bytes:  bytesStride() bytes, one per watched address, such as the score
+  *            or lives counters a reward is computed from.
+  */
+class BatchStepper {
+public:
+	enum VideoMode {
+		/** No video frame is written. The fastest. */
+		video_none,
+		/** 160x144 pixels. */
+		video_full,
+		/** 80x72 pixels, each the average of a 2x2 block. */
+		video_half
+	};
+
+	/**
+	  * @param instances  number of GB instances
+	  * @param threads    number of threads to step them on, including the one
+	  *                   calling step, or 0 for one per hardware thread. Never
+	  *                   more than instances.
+	  */
+	explicit BatchStepper(std::size_t instances, unsigned threads = 0);
+	~BatchStepper();
+
+	std::size_t size() const;
+	unsigned threads() const;
+
+	/**
+	  * Instance i, to load ROM images into, set up and save or load states of
+	  * between steps. Its input getter is replaced by the buttons passed to step,
+	  * so setInputGetter must not be called on it.
+	  */
+	GB & operator[](std::size_t i);
+
+	void setVideoMode(VideoMode mode);
+	void setRamRanges(std::vector<StepRamRange> const &ranges);
+	void setWatchAddresses(std::vector<unsigned> const &addresses);
+
+	/** Elements per instance in each observation array. */
+	std::size_t videoStride() const;
+	std::size_t ramStride() const;
+	std::size_t bytesStride() const;
+
+	/**
+	  * Runs every instance with a ROM image loaded for one video frame, holding
+	  * buttons[i] (see InputGetter::Button) on instance i, and writes their
+	  * observations. Returns once all are done. Audio is discarded.
+	  * Observations of instances with no ROM image loaded are left as they are.
+	  * Any of video, ram and bytes may be null to skip that kind.
+	  */
+	void step(unsigned const *buttons, gambatte::uint_least32_t *video,
+	          unsigned char *ram, unsigned char *bytes);
+
+private:
+	struct Priv;
+	Priv *const p_;
+
+	BatchStepper(BatchStepper const &);
+	BatchStepper & operator=(BatchStepper const &);
+};
+
+}
+
+#endif
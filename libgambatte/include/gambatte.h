@@ -23,12 +23,98 @@
 #include "inputgetter.h"
 #include "loadres.h"
 #include <cstddef>
+#include <ctime>
 #include <string>
+#include <vector>
 
 namespace gambatte {
 
 enum { BG_PALETTE = 0, SP1_PALETTE = 1, SP2_PALETTE = 2 };
 
+/** A state slot as recorded in the slot index when it was last saved. */
+struct StateSlotInfo {
+	enum { thumb_width = 80, thumb_height = 72 };
+
+	/** Slot number, as passed to selectState(). */
+	int slot;
+
+	/** When the slot was saved, as returned by std::time. */
+	std::time_t saveTime;
+
+	/** Size of the uncompressed state in bytes. */
+	std::size_t stateSize;
+
+	/** stateHash() of the saved state. */
+	gambatte::uint_least64_t stateHash;
+
+	/**
+	  * Whether a video frame was passed to saveState, so that
+	  * GB::stateSlotThumbnail() can give a thumbnail.
+	  */
+	bool hasThumbnail;
+};
+
+/**
+  * A condition for GB::runUntil to stop at. Conditions are checked before each
+  * instruction and after each interrupt dispatch.
+  */
+struct RunCondition {
+	enum Type {
+		/** Never holds, so that runUntil runs for all of its cycles. */
+		none,
+		/** The CPU is about to execute the instruction at address. */
+		pc_equals,
+		/** The byte at address, as GB::peek reads it, equals value. */
+		byte_equals,
+		/** The byte at address differs from what it was when runUntil was called. */
+		byte_changes,
+		/**
+		  * The LY register (0xFF44) reads value. LY reads 0 for nearly all of
+		  * line 153, so 153 is almost never seen.
+		  */
+		ly_equals,
+		/**
+		  * The CPU has just taken an interrupt whose IF bit is in value, or any
+		  * interrupt if value is 0, and is about to execute the first instruction
+		  * of the handler.
+		  */
+		interrupt_taken
+	};
+
+	Type type;
+	unsigned address;
+	unsigned value;
+};
+
+/**
+  * A read-only view of an area of emulated memory, straight into the memory the
+  * emulation reads and writes. See GB::memoryView.
+  */
+struct MemoryView {
+	/** The first byte of the area, or null if there is none. */
+	unsigned char const *data;
+	/** Size of the area in bytes, 0 if there is none. */
+	std::size_t size;
+	/** Size of each bank of the area in bytes. size for areas without banks. */
+	std::size_t bankSize;
+	/**
+	  * The bank the CPU sees in the switchable part of the area's address range
+	  * at the time of the GB::memoryView call, or -1 if it sees none there.
+	  */
+	int bank;
+};
+
+/**
+  * Threading: instances share no mutable state, so different instances, clones
+  * included, can be used on different threads at the same time without locking.
+  * A single instance is not thread-safe. Calls to it must not overlap, but it can
+  * move between threads if each handover synchronizes, like through a mutex or
+  * by joining a thread. The InputGetter is called on the thread that runs the
+  * instance. Files are the exception: instances that load the same ROM image
+  * from the same save directory write the same save and state files, so such
+  * instances should use NO_SAVEDATA, or different save directories, and only
+  * save states from one of them.
+  */
 class GB {
 public:
 	GB();
@@ -38,8 +124,15 @@ public:
 		FORCE_DMG        = 1, /**< Treat the ROM as not having CGB support regardless of
 		                           what its header advertises. */
 		GBA_CGB          = 2, /**< Use GBA intial CPU register values when in CGB mode. */
-		MULTICART_COMPAT = 4  /**< Use heuristics to detect and support some multicart
+		MULTICART_COMPAT = 4, /**< Use heuristics to detect and support some multicart
 		                           MBCs disguised as MBC1. */
+		NO_SAVEDATA      = 8, /**< Neither read nor implicitly write the battery backed
+		                           save files, so that cartridge RAM always starts out
+		                           the same. saveSavedata() still writes them. */
+		REUSE_ROM        = 16 /**< Do not read romfile again if it is the ROM image
+		                           already loaded, by path, only undoing any Game Genie
+		                           codes. For reloading files known not to have changed
+		                           since, as in batch runs. */
 	};
 
 	 /*
@@ -82,7 +175,70 @@ public:
 	  */
 	std::ptrdiff_t runFor(gambatte::uint_least32_t *videoBuf, std::ptrdiff_t pitch,
 	                      gambatte::uint_least32_t *audioBuf, std::size_t &samples);
+
+	/**
+	  * Audio samples runFrame may produce. A frame is normally 35112 samples, but
+	  * the frame in which the LCD is switched on lasts until the end of the first
+	  * frame the LCD draws, which can take up to three times as long.
+	  */
+	enum { max_frame_samples = 3 * 35112 + 2064 };
+
+	/**
+	  * Emulates until the next video frame has been drawn, that is up to the
+	  * first instruction boundary at or after the start of vertical blank, and
+	  * returns the audio produced on the way. Successive calls produce one frame
+	  * each and all of the audio, so that the caller need not keep track of
+	  * samples left over. Mixing calls with runFor is fine.
+	  *
+	  * Should audioBuf fill up before a frame is drawn, which a ROM image can
+	  * only bring about by keeping the LCD from completing a frame for about
+	  * three frames' time, runFrame returns false with the audio produced so far.
+	  * Calling it again continues the same frame.
+	  *
+	  * @param videoBuf 160x144 RGB32 (native endian) video frame buffer or 0
+	  * @param pitch distance in number of pixels (not bytes) from the start of one line
+	  *              to the next in videoBuf.
+	  * @param audioBuf buffer with space for max_frame_samples audio samples, in
+	  *                 the format described for runFor
+	  * @param samples  out: number of audio samples produced
+	  * @return whether a video frame was drawn. false if no ROM image is loaded.
+	  */
+	bool runFrame(gambatte::uint_least32_t *videoBuf, std::ptrdiff_t pitch,
+	              gambatte::uint_least32_t *audioBuf, std::size_t &samples);
+
+	/**
+	  * Like runFrame above, but discards the audio, for callers that have no use
+	  * for it. Saves allocating and keeping track of an audio buffer; the audio is
+	  * still generated, as it affects emulation. Runs until a frame is drawn
+	  * however long that takes, since there is no audio buffer to fill up.
+	  */
+	void runFrame(gambatte::uint_least32_t *videoBuf, std::ptrdiff_t pitch);
     
+	/**
+	  * Emulates until condition holds, or for cycles cycles, whichever comes
+	  * first, without returning when a video frame is drawn. The conditions are
+	  * checked inside the emulation loop, which takes a slower path only while
+	  * runUntil runs, so host-side loops of short runFor calls are not needed.
+	  *
+	  * A condition that holds when runUntil is called must stop holding before it
+	  * can be met, so that calling runUntil again with the same condition runs to
+	  * the next time it is met, like continuing from a breakpoint in a debugger.
+	  *
+	  * Cycles are counted at 4194304 Hz (2 per audio sample, 70224 per video
+	  * frame) in either CPU speed mode.
+	  *
+	  * @param videoBuf 160x144 RGB32 (native endian) video frame buffer or 0,
+	  *                 as for runFor. Frames are drawn into it as they complete.
+	  * @param audioBuf buffer with space >= cycles / 2 + 2064 audio samples
+	  * @param samples  out: number of audio samples produced
+	  * @return cycles emulated until the condition was met, that is up to the
+	  *         instruction boundary at which it was first seen to hold, or -1 if
+	  *         it was not met within cycles cycles or no ROM image is loaded
+	  */
+	long runUntil(RunCondition const &condition, unsigned long cycles,
+	              gambatte::uint_least32_t *videoBuf, std::ptrdiff_t pitch,
+	              gambatte::uint_least32_t *audioBuf, std::size_t &samples);
+
 	/**
 	  * Reset to initial state, using the given LoadFlags.
 	  * Equivalent to reloading a ROM image, or turning a Game Boy Color off and on again.
@@ -103,15 +259,64 @@ public:
 	  */
 	void setDmgPaletteColor(int palNum, int colorNum, unsigned long rgb32);
 
-	/** Sets the callback used for getting input state. */
+	/** Sets the callback used for getting input state. Ends any input timeline. */
 	void setInputGetter(InputGetter *getInput);
 
+	/**
+	  * Takes input from a timeline of changes instead of an input getter, until
+	  * setInputGetter() is called. The buttons of each change are held from the
+	  * start of its video frame on, and none before the first. Frames count from
+	  * 0 at this call, one for each video frame completed by runFor(),
+	  * runFrame() or runUntil(), which is where runFor() returns >= 0, so a
+	  * timeline plays out like an input getter whose buttons are changed between
+	  * frames. Frames run by runAhead() are not counted. Loading a ROM image,
+	  * reset and loading state leave the timeline and the frame count as they are.
+	  *
+	  * The ROM image reads the buttons straight from the timeline, without
+	  * calling back, which makes a difference to ROM images that poll the joypad
+	  * often.
+	  *
+	  * @param input  changes in frame order. Copied.
+	  */
+	void setInputTimeline(std::vector<InputChange> const &input);
+
+	/** Video frames completed since setInputTimeline(). */
+	unsigned long inputTimelineFrame() const;
+
 	/**
 	  * Sets the directory used for storing save data. The default is the same directory as
 	  * the ROM Image file.
 	  */
 	void setSaveDir(std::string const &sdir);
 
+	enum RtcMode {
+		/** The clock follows the host's clock. The default. */
+		RTC_REAL_TIME,
+		/**
+		  * The clock advances with emulated cycles, at the Game Boy's clock rate
+		  * in either CPU speed, however fast or slow emulation runs. Runs of the
+		  * same ROM image with the same input then behave the same whenever they
+		  * are run, and fast-forwarding advances the clock as much as the game.
+		  */
+		RTC_EMULATED_TIME
+	};
+
+	/**
+	  * Sets what drives the real-time clock of MBC3 cartridges, which games like
+	  * Pokemon Gold and Silver read.
+	  *
+	  * Emulated time reads epoch, in seconds since 1970 like std::time, when a
+	  * ROM image is loaded or reset, and a cartridge clock set by neither the
+	  * game nor savedata starts at 0 days 00:00:00 in RTC_EMULATED_TIME mode.
+	  * Emulated time is stored in states, so loading one resumes the emulated
+	  * time it was saved at. Clock registers written by the game, and savedata,
+	  * are relative to whichever time the mode uses, so call this before load()
+	  * rather than switching modes in the middle of a game.
+	  *
+	  * @param epoch takes effect at the next load(), reset() or resetWithFlags()
+	  */
+	void setRtcMode(RtcMode mode, std::time_t epoch = 0);
+
 	/** Returns true if the currently loaded ROM image is treated as having CGB support. */
 	bool isCgb() const;
 
@@ -124,6 +329,9 @@ public:
 	/**
 	  * Saves emulator state to the state slot selected with selectState().
 	  * The data will be stored in the directory given by setSaveDir().
+	  * Like saveState(videoBuf, pitch, filepath), the file is written in the
+	  * background. The slot is also recorded in the ROM's slot index, see
+	  * stateSlots().
 	  *
 	  * @param  videoBuf 160x144 RGB32 (native endian) video frame buffer or 0. Used for
 	  *                  saving a thumbnail.
@@ -140,23 +348,267 @@ public:
 	bool loadState();
 
 	/**
-	  * Saves emulator state to the file given by 'filepath'.
+	  * Saves emulator state to the file given by 'filepath'. Only the in-memory
+	  * capture of the state happens in the call. Compressing it (if libgambatte is
+	  * built with zlib) and writing the file is done by a background thread,
+	  * which writes a temporary file and renames it over 'filepath', so a crash
+	  * never leaves a partially written state file. Use flushStateFiles() to wait
+	  * for the write and get its outcome.
 	  *
 	  * @param  videoBuf 160x144 RGB32 (native endian) video frame buffer or 0. Used for
 	  *                  saving a thumbnail.
 	  * @param  pitch distance in number of pixels (not bytes) from the start of one line
 	  *               to the next in videoBuf.
-	  * @return success
+	  * @return true if the state was captured and queued for writing
 	  */
 	bool saveState(gambatte::uint_least32_t const *videoBuf, std::ptrdiff_t pitch,
 	               std::string const &filepath);
 
 	/**
-	  * Loads emulator state from the file given by 'filepath'.
+	  * Loads emulator state from the file given by 'filepath'. Both compressed
+	  * state files and uncompressed ones written by earlier versions are accepted.
+	  * Waits for pending state file writes first.
 	  * @return success
 	  */
 	bool loadState(std::string const &filepath);
 
+	/**
+	  * Waits for state files queued by saveState to be written. Done implicitly on
+	  * destruction and before loading a state file.
+	  * @return false if writing any state file failed since the last call
+	  */
+	bool flushStateFiles();
+
+	/**
+	  * Like flushStateFiles(), but does not wait. Reports the outcome of the state
+	  * file writes that finished since the last call, so that frontends can check
+	  * for write errors once per frame.
+	  * @return false if writing any state file failed since the last call
+	  */
+	bool pollStateFiles();
+
+	/**
+	  * Saves emulator state to 'data', replacing its contents. The result has the
+	  * format of a state file without a thumbnail. Does no file I/O, and only
+	  * allocates if 'data' needs to grow.
+	  *
+	  * @return success
+	  */
+	bool saveState(std::vector<char> &data);
+
+	/**
+	  * Saves emulator state to the 'bufsize' bytes at 'buf' like
+	  * saveState(std::vector<char> &), but never allocates. Nothing is written past
+	  * buf + bufsize.
+	  *
+	  * @return size of the state in bytes, which is only completely written if it is
+	  *         <= bufsize. 0 if no ROM image is loaded.
+	  */
+	std::size_t saveState(char *buf, std::size_t bufsize);
+
+	/**
+	  * Saves emulator state to 'data' like saveState(std::vector<char> &), but in a
+	  * raw fixed-layout format that is several times faster to save and load. Raw
+	  * states can only be loaded by the same build of libgambatte with the same ROM
+	  * image loaded, so they suit in-process uses like rewind buffers rather than
+	  * files meant to be kept.
+	  *
+	  * @return success
+	  */
+	bool saveStateRaw(std::vector<char> &data);
+
+	/**
+	  * Saves emulator state to the 'bufsize' bytes at 'buf' like
+	  * saveStateRaw(std::vector<char> &), but never allocates. Nothing is written
+	  * unless the whole state fits.
+	  *
+	  * @return size of the state in bytes, which is only written if it is
+	  *         <= bufsize. 0 if no ROM image is loaded.
+	  */
+	std::size_t saveStateRaw(char *buf, std::size_t bufsize);
+
+	/**
+	  * Loads emulator state from the 'size' bytes at 'data', as saved by
+	  * saveState(std::vector<char> &), saveStateRaw or read from a state file.
+	  * The format is detected from the data. Raw states saved by a different build
+	  * are rejected. Unlike the other loadState overloads, this does not write save
+	  * data to disk first.
+	  *
+	  * @return success
+	  */
+	bool loadState(void const *data, std::size_t size);
+
+	/**
+	  * Sets how much memory the rewind buffer may use for snapshots, and clears it.
+	  * Rewinding is disabled (0 bytes) by default. Snapshots are kept as compressed
+	  * differences to the one before, with a complete keyframe every
+	  * keyframeInterval snapshots. The oldest keyframe interval is dropped when the
+	  * limit is exceeded. Loading a ROM image clears the buffer.
+	  */
+	void setRewindBufferSize(std::size_t maxBytes, unsigned keyframeInterval = 60);
+
+	/**
+	  * Pushes a snapshot of the current emulator state onto the rewind buffer.
+	  * Typically called once per video frame.
+	  *
+	  * @return false if no ROM image is loaded or rewinding is disabled
+	  */
+	bool rewindPush();
+
+	/**
+	  * Restores the emulator state of the most recently pushed snapshot, and removes
+	  * it from the rewind buffer.
+	  *
+	  * @return false if the rewind buffer is empty
+	  */
+	bool rewindPop();
+
+	/** Number of snapshots in the rewind buffer that rewindPop can restore. */
+	std::size_t rewindDepth() const;
+
+	/**
+	  * Run-ahead, which hides input lag: emulates 'frames' video frames beyond the
+	  * current one with the current input, writes the last of them to videoBuf, and
+	  * then restores the emulator state. Audio of the frames run ahead is discarded.
+	  * Meant to be called when runFor has completed a frame, before videoBuf is
+	  * displayed. Costs a little more than emulating 'frames' frames. Like loading
+	  * state, marks every dirty tracking page dirty.
+	  *
+	  * @return false if no ROM image is loaded
+	  */
+	bool runAhead(unsigned frames, gambatte::uint_least32_t *videoBuf, std::ptrdiff_t pitch);
+
+	/**
+	  * Enables or disables tracking of which 256-byte pages of VRAM, SRAM and WRAM are
+	  * written to. Disabled by default. While enabled, emulated writes to SRAM and WRAM
+	  * take a slightly slower path. Enabling marks every page dirty, as do loading a
+	  * ROM image, reset and loading state.
+	  */
+	void setDirtyTracking(bool enable);
+
+	/**
+	  * Replaces the contents of 'pages' with the numbers of the pages written to since
+	  * the last clearDirtyPages(), in increasing order. Page n covers bytes
+	  * [n * 256, n * 256 + 256) of VRAM, SRAM and WRAM laid out back to back, as they
+	  * are stored in state: 0x4000 bytes of VRAM (two banks, also in DMG mode),
+	  * pakInfo().rambanks() * 0x2000 bytes of SRAM, and 0x8000 (CGB) or 0x2000 (DMG)
+	  * bytes of WRAM.
+	  */
+	void dirtyPages(std::vector<unsigned> &pages) const;
+
+	/** Marks every page clean. Typically called after copying the dirty pages. */
+	void clearDirtyPages();
+
+	/**
+	  * Returns a 64-bit non-cryptographic hash (XXH64) of the emulator state, for
+	  * checking that runs on different machines stay in lockstep. Covers what a
+	  * state saved with saveState(std::vector<char> &) does: CPU registers, memory,
+	  * and PPU, sound, timer and interrupt state. The RTC base time, which follows
+	  * the wall clock, is left out. The hash does not depend on the host, and
+	  * computing it does no file I/O and no allocation.
+	  *
+	  * Runs of the same ROM image from the same state with the same input have the
+	  * same hash after each runFor call that completes a frame. Loading a state
+	  * recomputes some PPU fields, so the hash right after loadState may differ
+	  * from the hash when the state was saved. It agrees again after the next
+	  * frame.
+	  *
+	  * @return 0 if no ROM image is loaded
+	  */
+	gambatte::uint_least64_t stateHash();
+
+	/**
+	  * Returns the byte the CPU would read at address, 0-0xFFFF, as of the end of
+	  * the last runFor call, without side effects. Reads the cartridge rather than
+	  * any boot ROM, and ignores the PPU and OAM DMA blocking access to VRAM and
+	  * OAM. I/O registers read as last written.
+	  *
+	  * @return 0xFF if no ROM image is loaded
+	  */
+	unsigned peek(unsigned address) const;
+
+	enum MemoryArea {
+		/**
+		  * Work RAM, 0x2000 bytes on DMG and 0x8000 on CGB in 0x1000 byte banks.
+		  * Bank 0 is at $C000 and the bank is the one at $D000, selected by
+		  * SVBK ($FF70) on CGB and always 1 on DMG.
+		  */
+		WRAM,
+		/**
+		  * Video RAM, 0x2000 bytes on DMG and 0x4000 on CGB in 0x2000 byte banks.
+		  * The bank is the one at $8000, selected by VBK ($FF4F) on CGB and
+		  * always 0 on DMG.
+		  */
+		VRAM,
+		/**
+		  * Cartridge RAM, as many 0x2000 byte banks as the cartridge has. The
+		  * bank is the one at $A000, or -1 if the cartridge RAM is disabled, or
+		  * an MBC3 RTC register is mapped there instead.
+		  */
+		SRAM,
+		/** Object attribute memory, the 0xA0 bytes at $FE00. Bank 0. */
+		OAM,
+		/** High RAM, the 0x7F bytes at $FF80. Bank 0. */
+		HRAM
+	};
+
+	/**
+	  * Returns a read-only view of a memory area, without copying it. The data
+	  * is what the emulation reads and writes, so it is what the area holds as
+	  * of the end of the last call that ran the emulation. The data pointer
+	  * stays valid, following the emulation as it runs, until the next load(),
+	  * resetWithFlags() or destruction of this instance; savedata, states and
+	  * reset() keep it. The bank is a snapshot, as the ROM image may switch banks
+	  * whenever it runs.
+	  *
+	  * Like peek(), this ignores the PPU and OAM DMA blocking access to VRAM and
+	  * OAM, and what any boot ROM maps over the cartridge. Writing through the
+	  * view is not supported.
+	  *
+	  * @return A view with null data, size 0 and bank -1 if no ROM image is
+	  *         loaded or the cartridge has no RAM.
+	  */
+	MemoryView memoryView(MemoryArea area) const;
+
+	/**
+	  * Returns a new instance in the same state as this one, for the caller to
+	  * delete. Run with the same input, the clone evolves exactly like this
+	  * instance. The ROM image data is shared rather than copied, until
+	  * setGameGenie() is called on either instance. The save directory, cheats,
+	  * boot ROMs, DMG palettes, input getter or input timeline, dirty tracking,
+	  * RTC mode and selected state slot carry over; the rewind buffer does not.
+	  *
+	  * A clone never writes save data implicitly, as on destruction, load(),
+	  * reset() or loadState(), so that clones do not overwrite the save data of
+	  * the instance they were cloned from. saveSavedata() still writes it.
+	  *
+	  * Cloning an instance with no ROM image loaded gives a new instance.
+	  */
+	GB * clone();
+
+	/**
+	  * Replaces the contents of 'slots' with the state slots saved for the loaded
+	  * ROM image, in increasing slot order. Only the fixed-size slot entries at
+	  * the start of the ROM's slot index, a file in the directory given by
+	  * setSaveDir() that saveState() keeps up to date, are read, and only the
+	  * first time. Nothing is decompressed. State files are not opened, so
+	  * slots whose files were deleted or written by other programs are reported
+	  * as last saved through saveState().
+	  */
+	void stateSlots(std::vector<StateSlotInfo> &slots);
+
+	/**
+	  * Replaces the contents of 'thumb' with the thumbnail of a state slot listed
+	  * by stateSlots(). Thumbnails are stored compressed in the slot index, and
+	  * only read and decompressed when asked for.
+	  *
+	  * @param thumb set to a StateSlotInfo::thumb_width x StateSlotInfo::thumb_height
+	  *              RGB32 (native endian) video frame, downscaled from the one passed
+	  *              to saveState
+	  * @return false if the slot has no thumbnail or it could not be read
+	  */
+	bool stateSlotThumbnail(int slot, std::vector<gambatte::uint_least32_t> &thumb);
+
 	/**
 	  * Selects which state slot to save state to or load state from.
 	  * There are 10 such slots, numbered from 0 to 9 (periodically extended for all n).
@@ -175,6 +627,15 @@ public:
 	/** GamePak/Cartridge info. */
 	class PakInfo const pakInfo() const;
 
+	/**
+	  * Returns the 64-bit xxHash (XXH64, seed 0) of the loaded ROM image, as
+	  * padded to a power of two banks and patched by any Game Genie codes. Used
+	  * to tell whether input recorded on one ROM image is played back on the same.
+	  *
+	  * @return 0 if no ROM image is loaded
+	  */
+	gambatte::uint_least64_t romHash() const;
+
 	/**
 	  * Set Game Genie codes to apply to currently loaded ROM image. Cleared on ROM load.
 	  * @param codes Game Genie codes in format HHH-HHH-HHH;HHH-HHH-HHH;... where
@@ -32,6 +32,16 @@ public:
 	virtual unsigned operator()() = 0;
 };
 
+/**
+  * A change of input in a frame-counted input sequence, as played by an input
+  * timeline, recorded in an input movie or scripted for a batch job: buttons
+  * (see InputGetter::Button) held from the start of video frame 'frame' on.
+  */
+struct InputChange {
+	unsigned long frame;
+	unsigned buttons;
+};
+
 }
 
 #endif
@@ -0,0 +1,154 @@
+//
+//   Copyright (C) 2026 by the Gambatte contributors
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License version 2 for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   version 2 along with this program; if not, write to the
+//   Free Software Foundation, Inc.,
+//   51 Franklin St, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+
+#ifndef GAMBATTE_INPUTMOVIE_H
+#define GAMBATTE_INPUTMOVIE_H
+
+#include "batchrunner.h"
+#include "gbint.h"
+#include "inputgetter.h"
+#include <string>
+#include <vector>
+
+namespace gambatte {
+
+class GB;
+
+/**
+  * Input recorded from a state of a ROM image, to play back from the same state.
+  * Buttons are sampled once per video frame, so a movie plays back the same
+  * however the emulation is split into runFor calls, and with runFrame or
+  * BatchRunner (see BatchJob) too.
+  */
+struct InputMovie {
+	/** GB::romHash of the ROM image recorded on. */
+	gambatte::uint_least64_t romHash;
+
+	/** ORed combination of GB::LoadFlags the ROM image was loaded with. */
+	unsigned loadFlags;
+
+	/** State recorded from, as saved by GB::saveState(std::vector<char> &). */
+	std::vector<char> startState;
+
+	/**
+	  * Input changes in frame order, frames counting from the start state. No
+	  * buttons are held before the first.
+	  */
+	std::vector<InputChange> input;
+
+	/** Video frames recorded. */
+	unsigned long frames;
+
+	InputMovie() : romHash(0), loadFlags(0), frames(0) {}
+};
+
+/**
+  * Writes movie to a file. Only input changes are stored, each as the frames
+  * since the last change and the buttons, so held input takes no space.
+  *
+  * @return success
+  */
+bool saveInputMovie(InputMovie const &movie, std::string const &filepath);
+
+/**
+  * Reads a movie written by saveInputMovie into movie.
+  * @return success. movie is left unchanged on failure.
+  */
+bool loadInputMovie(InputMovie &movie, std::string const &filepath);
+
+/**
+  * Records the input of another InputGetter, such as a frontend's, as an
+  * InputMovie. The source is sampled at the start of each video frame, and the
+  * emulation sees the sampled buttons for the whole frame.
+  */
+class InputMovieRecorder : public InputGetter {
+public:
+	explicit InputMovieRecorder(InputGetter &source);
+
+	/**
+	  * Starts a new movie from the current state of gb, which must have a ROM
+	  * image loaded, and makes this gb's input getter. The state is saved and
+	  * loaded back, so that recording starts from the same loaded state as
+	  * playback.
+	  *
+	  * @param loadFlags  the GB::LoadFlags the ROM image was loaded with
+	  * @return success
+	  */
+	bool start(GB &gb, unsigned loadFlags);
+
+	/** To be called whenever gb completes a video frame, as when runFor returns >= 0. */
+	void frameDone();
+
+	InputMovie const & movie() const { return movie_; }
+	virtual unsigned operator()() { return buttons_; }
+
+private:
+	InputGetter &source_;
+	InputMovie movie_;
+	unsigned buttons_;
+
+	void sample();
+
+	InputMovieRecorder(InputMovieRecorder const &);
+	InputMovieRecorder & operator=(InputMovieRecorder const &);
+};
+
+/** Plays back an InputMovie. The movie is referenced, not copied. */
+class InputMoviePlayer : public InputGetter {
+public:
+	explicit InputMoviePlayer(InputMovie const &movie);
+
+	/**
+	  * Loads the start state of the movie into gb and makes this gb's input
+	  * getter. gb must have the ROM image the movie was recorded on loaded, with
+	  * the same load flags.
+	  *
+	  * @return false if gb has another ROM image loaded or the start state
+	  *         fails to load
+	  */
+	bool start(GB &gb);
+
+	/** To be called whenever gb completes a video frame, as when runFor returns >= 0. */
+	void frameDone();
+
+	/** Video frames played. */
+	unsigned long frame() const { return frame_; }
+
+	/**
+	  * Whether every recorded frame has been played. The last buttons recorded
+	  * stay held after, as with a BatchJob running past its input.
+	  */
+	bool done() const { return frame_ >= movie_.frames; }
+
+	virtual unsigned operator()() { return buttons_; }
+
+private:
+	InputMovie const &movie_;
+	std::vector<InputChange>::const_iterator next_;
+	unsigned long frame_;
+	unsigned buttons_;
+
+	void advance();
+
+	InputMoviePlayer(InputMoviePlayer const &);
+	InputMoviePlayer & operator=(InputMoviePlayer const &);
+};
+
+}
+
+#endif
@@ -0,0 +1,190 @@
+//
+//   Copyright (C) 2026 by the Gambatte contributors
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License version 2 for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   version 2 along with this program; if not, write to the
+//   Free Software Foundation, Inc.,
+//   51 Franklin St, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+
+#include "batchrunner.h"
+#include "gambatte.h"
+#include "xxh64.h"
+#include <algorithm>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace gambatte {
+
+namespace {
+
+// Indices of the jobs queued for one worker. The worker takes jobs from the
+// front, and other workers steal them from the back.
+class JobQueue {
+public:
+	void push(std::size_t job) {
+		std::lock_guard<std::mutex> lock(mut_);
+		jobs_.push_back(job);
+	}
+
+	bool pop(std::size_t &job) {
+		std::lock_guard<std::mutex> lock(mut_);
+		if (jobs_.empty())
+			return false;
+
+		job = jobs_.front();
+		jobs_.pop_front();
+		return true;
+	}
+
+	bool steal(std::size_t &job) {
+		std::lock_guard<std::mutex> lock(mut_);
+		if (jobs_.empty())
+			return false;
+
+		job = jobs_.back();
+		jobs_.pop_back();
+		return true;
+	}
+
+private:
+	std::mutex mut_;
+	std::deque<std::size_t> jobs_;
+};
+
+class Worker {
+public:
+	Worker()
+	: audioBuf_(GB::max_frame_samples)
+	, reuseRom_(false)
+	{
+		gb_.setRtcMode(GB::RTC_EMULATED_TIME);
+		result_.videoBuf.resize(BatchResult::video_width * BatchResult::video_height);
+	}
+
+	JobQueue & queue() { return queue_; }
+	void run(std::vector<BatchJob> const &jobs, BatchListener &listener,
+	         std::vector<std::unique_ptr<Worker> > &workers, std::size_t self);
+
+private:
+	GB gb_;
+	JobQueue queue_;
+	std::vector<uint_least32_t> audioBuf_;
+	BatchResult result_;
+	bool reuseRom_;
+
+	void runJob(BatchJob const &job, std::size_t index, BatchListener &listener);
+};
+
+void Worker::runJob(BatchJob const &job, std::size_t index, BatchListener &listener) {
+	BatchResult &r = result_;
+	r.job = index;
+	r.romHash = 0;
+	r.audioHash = 0;
+	r.stateHash = 0;
+	r.state.clear();
+	std::fill(r.videoBuf.begin(), r.videoBuf.end(), 0);
+
+	gb_.setInputTimeline(job.input);
+	r.loadres = gb_.load(job.romfile,
+	                     job.loadFlags | GB::NO_SAVEDATA | (reuseRom_ ? GB::REUSE_ROM : 0));
+	reuseRom_ = true;
+	if (r.loadres == LOADRES_OK && !job.startState.empty()
+			&& !gb_.loadState(&job.startState[0], job.startState.size())) {
+		r.loadres = LOADRES_BAD_FILE_OR_UNKNOWN_MBC;
+	}
+
+	if (r.loadres == LOADRES_OK) {
+		r.romHash = gb_.romHash();
+		Xxh64 audioHash;
+		for (unsigned long frame = 0; frame < job.frames;) {
+			std::size_t samples;
+			if (gb_.runFrame(&r.videoBuf[0], BatchResult::video_width, &audioBuf_[0], samples))
+				++frame;
+
+			audioHash.update(&audioBuf_[0], samples * sizeof audioBuf_[0]);
+		}
+
+		r.audioHash = audioHash.digest();
+		r.stateHash = gb_.stateHash();
+		if (job.saveState)
+			gb_.saveState(r.state);
+	}
+
+	listener.jobDone(r);
+}
+
+void Worker::run(std::vector<BatchJob> const &jobs, BatchListener &listener,
+		std::vector<std::unique_ptr<Worker> > &workers, std::size_t const self) {
+	// ROM images are read at least once a run, in case the files changed since the last.
+	reuseRom_ = false;
+
+	// No jobs are queued once the workers are started, so there is nothing left
+	// to do when no queue has any.
+	for (;;) {
+		std::size_t job;
+		bool found = queue_.pop(job);
+		for (std::size_t i = 1; !found && i < workers.size(); ++i)
+			found = workers[(self + i) % workers.size()]->queue().steal(job);
+
+		if (!found)
+			return;
+
+		runJob(jobs[job], job, listener);
+	}
+}
+
+} // anon namespace
+
+struct BatchRunner::Priv {
+	std::vector<std::unique_ptr<Worker> > workers;
+};
+
+BatchRunner::BatchRunner(unsigned threads)
+: p_(new Priv)
+{
+	if (threads == 0)
+		threads = std::max(std::thread::hardware_concurrency(), 1u);
+
+	for (unsigned i = 0; i < threads; ++i)
+		p_->workers.push_back(std::unique_ptr<Worker>(new Worker));
+}
+
+BatchRunner::~BatchRunner() {
+	delete p_;
+}
+
+unsigned BatchRunner::threads() const {
+	return p_->workers.size();
+}
+
+void BatchRunner::run(std::vector<BatchJob> const &jobs, BatchListener &listener) {
+	std::vector<std::unique_ptr<Worker> > &workers = p_->workers;
+	for (std::size_t i = 0; i < jobs.size(); ++i)
+		workers[i % workers.size()]->queue().push(i);
+
+	// The calling thread is the first worker.
+	std::vector<std::thread> threads;
+	for (std::size_t i = 1; i < workers.size(); ++i) {
+		threads.push_back(std::thread(&Worker::run, workers[i].get(),
+		                              std::cref(jobs), std::ref(listener), std::ref(workers), i));
+	}
+
+	workers[0]->run(jobs, listener, workers, 0);
+	for (std::size_t i = 0; i < threads.size(); ++i)
+		threads[i].join();
+}
+
+}
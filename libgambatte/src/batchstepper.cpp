@@ -0,0 +1,278 @@
+//
+//   Copyright (C) 2026 by the Gambatte contributors
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License version 2 for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   version 2 along with this program; if not, write to the
+//   Free Software Foundation, Inc.,
+//   51 Franklin St, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+
+#include "batchstepper.h"
+#include "gambatte.h"
+#include <algorithm>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace gambatte {
+
+namespace {
+
+unsigned const video_width = 160, video_height = 144;
+
+class StepInput : public InputGetter {
+public:
+	StepInput() : buttons(0) {}
+	virtual unsigned operator()() { return buttons; }
+
+	unsigned buttons;
+};
+
+struct Instance {
+	GB gb;
+	StepInput input;
+	std::vector<uint_least32_t> videoBuf;
+
+	Instance() { gb.setInputGetter(&input); }
+};
+
+// Averages each 2x2 block of pixels, a channel at a time. The red and blue
+// channels are summed together, as the sums of four cannot carry into the
+// next channel.
+void downscaleHalf(uint_least32_t const *in, uint_least32_t *out) {
+	for (unsigned y = 0; y < video_height / 2; ++y) {
+		uint_least32_t const *const line0 = in + 2 * y * video_width;
+		uint_least32_t const *const line1 = line0 + video_width;
+		for (unsigned x = 0; x < video_width / 2; ++x) {
+			uint_least32_t const a = line0[2 * x], b = line0[2 * x + 1];
+			uint_least32_t const c = line1[2 * x], d = line1[2 * x + 1];
+			uint_least32_t const rb = (a & 0xFF00FF) + (b & 0xFF00FF)
+			                        + (c & 0xFF00FF) + (d & 0xFF00FF);
+			uint_least32_t const g = (a & 0xFF00) + (b & 0xFF00) + (c & 0xFF00) + (d & 0xFF00);
+			*out++ = (rb >> 2 & 0xFF00FF) | (g >> 2 & 0xFF00);
+		}
+	}
+}
+
+} // anon namespace
+
+struct BatchStepper::Priv {
+	std::vector<std::unique_ptr<Instance> > instances;
+	std::vector<std::thread> threads;
+	VideoMode videoMode;
+	std::vector<StepRamRange> ramRanges;
+	std::vector<unsigned> watchAddresses;
+	std::size_t ramStride;
+
+	// Arguments of the step in progress.
+	unsigned const *buttons;
+	uint_least32_t *video;
+	unsigned char *ram;
+	unsigned char *bytes;
+
+	// Each step bumps generation to start the pool threads, each of which
+	// decrements pending when its share is done.
+	std::mutex mut;
+	std::condition_variable start;
+	std::condition_variable done;
+	unsigned long generation;
+	unsigned pending;
+	bool quit;
+
+	explicit Priv(std::size_t numInstances);
+	std::size_t videoStride() const;
+	void stepInstance(std::size_t i);
+	void stepShare(unsigned thread);
+	void work(unsigned thread);
+};
+
+BatchStepper::Priv::Priv(std::size_t const numInstances)
+: videoMode(video_full)
+, ramStride(0)
+, buttons(0)
+, video(0)
+, ram(0)
+, bytes(0)
+, generation(0)
+, pending(0)
+, quit(false)
+{
+	for (std::size_t i = 0; i < numInstances; ++i)
+		instances.push_back(std::unique_ptr<Instance>(new Instance));
+}
+
+std::size_t BatchStepper::Priv::videoStride() const {
+	switch (videoMode) {
+	case video_none: return 0;
+	case video_full: return video_width * video_height;
+	case video_half: return video_width / 2 * (video_height / 2);
+	}
+
+	return 0;
+}
+
+void BatchStepper::Priv::stepInstance(std::size_t const i) {
+	Instance &inst = *instances[i];
+	if (!inst.gb.isLoaded())
+		return;
+
+	// Full frames are drawn straight into the caller's array. Every step starts
+	// and ends at the same point in the frame, before the first line is drawn,
+	// so whichever array a step is given gets all of the frame.
+	uint_least32_t *videoBuf = 0;
+	if (video && videoMode == video_full) {
+		videoBuf = video + i * videoStride();
+	} else if (video && videoMode == video_half) {
+		inst.videoBuf.resize(video_width * video_height);
+		videoBuf = &inst.videoBuf[0];
+	}
+
+	inst.input.buttons = buttons[i];
+	inst.gb.runFrame(videoBuf, video_width);
+
+	if (video && videoMode == video_half)
+		downscaleHalf(videoBuf, video + i * videoStride());
+
+	if (ram) {
+		unsigned char *out = ram + i * ramStride;
+		for (std::size_t r = 0; r < ramRanges.size(); ++r) {
+			for (unsigned a = 0; a < ramRanges[r].size; ++a)
+				*out++ = inst.gb.peek(ramRanges[r].address + a);
+		}
+	}
+
+	if (bytes) {
+		unsigned char *const out = bytes + i * watchAddresses.size();
+		for (std::size_t a = 0; a < watchAddresses.size(); ++a)
+			out[a] = inst.gb.peek(watchAddresses[a]);
+	}
+}
+
+void BatchStepper::Priv::stepShare(unsigned const thread) {
+	std::size_t const numThreads = threads.size() + 1;
+	std::size_t const begin = instances.size() * thread / numThreads;
+	std::size_t const end = instances.size() * (thread + 1) / numThreads;
+	for (std::size_t i = begin; i < end; ++i)
+		stepInstance(i);
+}
+
+void BatchStepper::Priv::work(unsigned const thread) {
+	unsigned long lastGeneration = 0;
+	for (;;) {
+		{
+			std::unique_lock<std::mutex> lock(mut);
+			start.wait(lock, [&] { return quit || generation != lastGeneration; });
+			if (quit)
+				return;
+
+			lastGeneration = generation;
+		}
+
+		stepShare(thread);
+
+		std::lock_guard<std::mutex> lock(mut);
+		if (--pending == 0)
+			done.notify_one();
+	}
+}
+
+BatchStepper::BatchStepper(std::size_t const instances, unsigned threads)
+: p_(new Priv(instances))
+{
+	if (threads == 0)
+		threads = std::max(std::thread::hardware_concurrency(), 1u);
+
+	threads = std::max<std::size_t>(std::min<std::size_t>(threads, instances), 1);
+
+	// The thread calling step takes the first share.
+	for (unsigned i = 1; i < threads; ++i)
+		p_->threads.push_back(std::thread(&Priv::work, p_, i));
+}
+
+BatchStepper::~BatchStepper() {
+	{
+		std::lock_guard<std::mutex> lock(p_->mut);
+		p_->quit = true;
+	}
+
+	p_->start.notify_all();
+	for (std::size_t i = 0; i < p_->threads.size(); ++i)
+		p_->threads[i].join();
+
+	delete p_;
+}
+
+std::size_t BatchStepper::size() const {
+	return p_->instances.size();
+}
+
+unsigned BatchStepper::threads() const {
+	return p_->threads.size() + 1;
+}
+
+GB & BatchStepper::operator[](std::size_t const i) {
+	return p_->instances[i]->gb;
+}
+
+void BatchStepper::setVideoMode(VideoMode const mode) {
+	p_->videoMode = mode;
+}
+
+void BatchStepper::setRamRanges(std::vector<StepRamRange> const &ranges) {
+	p_->ramRanges = ranges;
+	p_->ramStride = 0;
+	for (std::size_t i = 0; i < ranges.size(); ++i)
+		p_->ramStride += ranges[i].size;
+}
+
+void BatchStepper::setWatchAddresses(std::vector<unsigned> const &addresses) {
+	p_->watchAddresses = addresses;
+}
+
+std::size_t BatchStepper::videoStride() const {
+	return p_->videoStride();
+}
+
+std::size_t BatchStepper::ramStride() const {
+	return p_->ramStride;
+}
+
+std::size_t BatchStepper::bytesStride() const {
+	return p_->watchAddresses.size();
+}
+
+void BatchStepper::step(unsigned const *const buttons, uint_least32_t *const video,
+		unsigned char *const ram, unsigned char *const bytes) {
+	p_->buttons = buttons;
+	p_->video = video;
+	p_->ram = ram;
+	p_->bytes = bytes;
+	if (p_->threads.empty()) {
+		p_->stepShare(0);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(p_->mut);
+		++p_->generation;
+		p_->pending = p_->threads.size();
+	}
+
+	p_->start.notify_all();
+	p_->stepShare(0);
+
+	std::unique_lock<std::mutex> lock(p_->mut);
+	p_->done.wait(lock, [this] { return p_->pending == 0; });
+}
+
+}
@@ -40,11 +40,15 @@ CPU::CPU()
 , l(0x4D)
 , skip_(false)
 , hang_(false)
+, until_()
+, untilStartByte_(0)
+, untilArmed_(false)
+, untilMet_(false)
 {
 }
 
 long CPU::runFor(unsigned long const cycles) {
-	process(cycles);
+	process<false>(cycles);
 
 	long const csb = mem_.cyclesSinceBlit(cycleCounter_);
 
@@ -54,6 +58,67 @@ long CPU::runFor(unsigned long const cycles) {
 	return csb;
 }
 
+long CPU::runUntil(RunCondition const &condition, unsigned long const cycles) {
+	until_ = condition;
+	untilStartByte_ = mem_.peek(until_.address & 0xFFFF);
+
+	// Arms the condition unless it holds already.
+	untilArmed_ = false;
+	untilHolds(pc_, cycleCounter_);
+	untilMet_ = false;
+
+	// Blits end process early, so go on until the condition is met or the time is up.
+	unsigned long const start = cycleCounter_;
+	unsigned long const end = start + (cycles << mem_.isDoubleSpeed());
+	while (!untilMet_ && static_cast<long>(end - cycleCounter_) > 0) {
+		unsigned long const left = (end - cycleCounter_) >> mem_.isDoubleSpeed();
+		process<true>(left ? left : 1);
+	}
+
+	// Met right as the time is up counts too.
+	if (!untilMet_ && cycleCounter_ == end)
+		untilHolds(pc_, cycleCounter_);
+
+	long const elapsed = untilMet_
+	                   ? static_cast<long>((cycleCounter_ - start) >> mem_.isDoubleSpeed())
+	                   : -1;
+	if (untilMet_)
+		mem_.cancelEndtime();
+
+	until_.type = RunCondition::none;
+	if (cycleCounter_ & 0x80000000)
+		cycleCounter_ = mem_.resetCounters(cycleCounter_);
+
+	return elapsed;
+}
+
+// Also tracks whether the condition has stopped holding since runUntil was
+// called, which it must have before it can be met.
+bool CPU::untilHolds(unsigned const pc, unsigned long const cc) {
+	bool holds = false;
+	switch (until_.type) {
+	case RunCondition::none:
+	case RunCondition::interrupt_taken:
+		break;
+	case RunCondition::pc_equals:
+		holds = pc == until_.address;
+		break;
+	case RunCondition::byte_equals:
+		holds = mem_.peek(until_.address & 0xFFFF) == until_.value;
+		break;
+	case RunCondition::byte_changes:
+		holds = mem_.peek(until_.address & 0xFFFF) != untilStartByte_;
+		break;
+	case RunCondition::ly_equals:
+		holds = mem_.lyReg(cc) == until_.value;
+		break;
+	}
+
+	untilMet_ = holds && untilArmed_;
+	untilArmed_ |= !holds;
+	return untilMet_;
+}
+
 enum { hf2_hcf = 0x200, hf2_subf = 0x400, hf2_incf = 0x800 };
 
 static unsigned updateHf2FromHf1(unsigned const hf1, unsigned hf2) {
@@ -489,6 +554,29 @@ void CPU::loadState(SaveState const &state) {
 	PC_MOD(high << 8 | low); \
 } while (0)
 
+// Moves on to the next event while the CPU is halted. LY moves on meanwhile, so
+// when runUntil waits for it, this stops at each machine cycle to check it.
+template <bool checkUntil>
+inline void CPU::skipHalted(unsigned const pc, unsigned long &cycleCounter) {
+	if (cycleCounter < mem_.nextEventTime()) {
+		unsigned long cycles = mem_.nextEventTime() - cycleCounter;
+		if (checkUntil && until_.type == RunCondition::ly_equals) {
+			for (; cycles > 4; cycles -= 4) {
+				if (untilHolds(pc, cycleCounter))
+					return;
+
+				cycleCounter += 4;
+			}
+		}
+
+		cycleCounter += cycles + (-cycles & 3);
+	}
+}
+
+// With checkUntil, the condition of runUntil is checked before each instruction
+// and after each event, and process returns as soon as it is met. The check
+// compiles away otherwise.
+template <bool checkUntil>
 void CPU::process(unsigned long const cycles) {
 	mem_.setEndtime(cycleCounter_, cycles);
 	mem_.updateInput();
@@ -499,14 +587,17 @@ void CPU::process(unsigned long const cycles) {
 	while (mem_.isActive()) {
 		unsigned short pc = pc_;
 
+		if (checkUntil && untilHolds(pc, cycleCounter))
+			break;
+
 		if (mem_.halted() || hang_) {
-			if (cycleCounter < mem_.nextEventTime()) {
-				unsigned long cycles = mem_.nextEventTime() - cycleCounter;
-				cycleCounter += cycles + (-cycles & 3);
-			}
+			skipHalted<checkUntil>(pc, cycleCounter);
 		} else while (cycleCounter < mem_.nextEventTime() && !hang_) {
 			unsigned char opcode;
 
+			if (checkUntil && untilHolds(pc, cycleCounter))
+				break;
+
 			PC_READ(opcode);
 
 			if (skip_) {
@@ -1011,11 +1102,7 @@ void CPU::process(unsigned long const cycles) {
 				} else {
 					mem_.halt();
 					cycleCounter += 8 * !mem_.isCgb();
-
-					if (cycleCounter < mem_.nextEventTime()) {
-						unsigned long cycles = mem_.nextEventTime() - cycleCounter;
-						cycleCounter += cycles + (-cycles & 3);
-					}
+					skipHalted<checkUntil>(pc, cycleCounter);
 				}
 
 				break;
@@ -1967,7 +2054,19 @@ void CPU::process(unsigned long const cycles) {
 		}
 
 		pc_ = pc;
+		if (checkUntil && untilMet_)
+			break;
+
+		// Events only move the stack pointer to take an interrupt.
+		unsigned short const spBeforeEvent = sp;
 		cycleCounter = mem_.event(cycleCounter);
+		if (checkUntil && until_.type == RunCondition::interrupt_taken && sp != spBeforeEvent) {
+			unsigned const irqBit = pc_ >= 0x40 ? 1 << ((pc_ - 0x40) >> 3) : 0;
+			if (until_.value == 0 || (until_.value & irqBit)) {
+				untilMet_ = true;
+				break;
+			}
+		}
 	}
 
 	a_ = a;
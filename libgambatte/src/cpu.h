@@ -19,6 +19,7 @@
 #ifndef CPU_H
 #define CPU_H
 
+#include "gambatte.h"
 #include "memory.h"
 
 namespace gambatte {
@@ -27,6 +28,7 @@ class CPU {
 public:
 	CPU();
 	long runFor(unsigned long cycles);
+	long runUntil(RunCondition const &condition, unsigned long cycles);
 	void setStatePtrs(SaveState &state);
 	void saveState(SaveState &state);
 	void loadState(SaveState const &state);
@@ -41,6 +43,12 @@ public:
 		mem_.setInputGetter(getInput);
 	}
 
+	void setInputTimeline(InputChange const *begin, InputChange const *end, unsigned long frame) {
+		mem_.setInputTimeline(begin, end, frame);
+	}
+
+	unsigned long inputTimelineFrame() const { return mem_.inputTimelineFrame(); }
+
 	void setSaveDir(std::string const &sdir) {
 		mem_.setSaveDir(sdir);
 	}
@@ -49,13 +57,20 @@ public:
 		return mem_.saveBasePath();
 	}
 
-	LoadRes load(std::string const &romfile, bool forceDmg, bool multicartCompat) {
-		return mem_.loadROM(romfile, forceDmg, multicartCompat);
+	LoadRes load(std::string const &romfile, bool forceDmg, bool multicartCompat, bool reuseRom) {
+		return mem_.loadROM(romfile, forceDmg, multicartCompat, reuseRom);
+	}
+
+	void load(CPU const &other, bool multicartCompat) {
+		mem_.loadROM(other.mem_, multicartCompat);
 	}
 
 	bool loaded() const { return mem_.loaded(); }
+	unsigned peek(unsigned address) const { return mem_.peek(address); }
+	MemoryView memoryView(GB::MemoryArea area) const { return mem_.memoryView(area); }
 	char const * romTitle() const { return mem_.romTitle(); }
 	PakInfo const pakInfo(bool multicartCompat) const { return mem_.pakInfo(multicartCompat); }
+	uint_least64_t romHash() const { return mem_.romHash(); }
 	void setSoundBuffer(uint_least32_t *buf) { mem_.setSoundBuffer(buf); }
 	std::size_t fillSoundBuffer() { return mem_.fillSoundBuffer(cycleCounter_); }
 	bool isCgb() const { return mem_.isCgb(); }
@@ -64,6 +79,11 @@ public:
 		mem_.setDmgPaletteColor(palNum, colorNum, rgb32);
 	}
 
+	void setRtcUseEmulatedTime(bool enable) { mem_.setRtcUseEmulatedTime(enable); }
+	void setWriteTracking(bool enable) { mem_.setWriteTracking(enable); }
+	void clearDirty() { mem_.clearDirty(); }
+	unsigned char const * dirtyPages() const { return mem_.dirtyPages(); }
+	std::size_t numPages() const { return mem_.numPages(); }
 	void setGameGenie(std::string const &codes) { mem_.setGameGenie(codes); }
 	void setGameShark(std::string const &codes) { mem_.setGameShark(codes); }
     
@@ -101,7 +121,15 @@ private:
 	bool skip_;
 	bool hang_;
 
-	void process(unsigned long cycles);
+	// The condition of the runUntil call in progress.
+	RunCondition until_;
+	unsigned untilStartByte_;
+	bool untilArmed_;
+	bool untilMet_;
+
+	template <bool checkUntil> void process(unsigned long cycles);
+	template <bool checkUntil> void skipHalted(unsigned pc, unsigned long &cycleCounter);
+	bool untilHolds(unsigned pc, unsigned long cc);
 };
 
 }
@@ -19,8 +19,12 @@
 #include "gambatte.h"
 #include "cpu.h"
 #include "initstate.h"
+#include "rewinder.h"
 #include "savestate.h"
+#include "statefilewriter.h"
 #include "statesaver.h"
+#include "stateslotindex.h"
+#include <algorithm>
 #include <cstring>
 #include <sstream>
 #include <climits>
@@ -39,21 +43,96 @@ std::string statePath(std::string const &basePath, int stateNo) {
     return basePath + '_' + std::to_string(stateNo) + ".gqs";
 }
 
+std::string stateSlotIndexPath(std::string const &basePath) {
+	return basePath + ".gqi";
+}
+
+std::size_t const samples_per_frame = 35112;
+std::size_t const max_overproduction = 2064;
+
 }
 
 struct GB::Priv {
 	CPU cpu;
+	Rewinder rewinder;
+	std::vector<char> rewindState;
+	std::vector<char> runAheadState;
+	std::vector<uint_least32_t> discardedAudio;
+	StateFileWriter stateFileWriter;
+	std::vector<char> stateFileData;
+	StateSlotIndex stateSlotIndex;
+	std::vector<char> stateSlotIndexData;
 	int stateNo;
 	unsigned loadflags;
+	bool ownsSavedata;
+	RtcMode rtcMode;
+	std::time_t rtcEpoch;
+	std::vector<InputChange> inputTimeline;
+
+	Priv()
+	: stateNo(1), loadflags(0), ownsSavedata(true), rtcMode(RTC_REAL_TIME), rtcEpoch(0)
+	{
+	}
+
+	void setInputTimeline(unsigned long frame) {
+		InputChange const *const begin = inputTimeline.empty() ? 0 : &inputTimeline[0];
+		cpu.setInputTimeline(begin, begin + inputTimeline.size(), frame);
+	}
+
+	// Save data writes that the user did not ask for, which clones and NO_SAVEDATA
+	// loads skip.
+	void saveSavedataImplicitly() {
+		if (ownsSavedata)
+			cpu.saveSavedata();
+	}
+
+	void loadStateSlotIndex() {
+		std::string const path = stateSlotIndexPath(cpu.saveBasePath());
+		if (path != stateSlotIndex.filepath()) {
+			// The index may have a pending write from when this ROM was last loaded.
+			stateFileWriter.wait();
+			stateSlotIndex.load(path);
+		}
+	}
+
+	// Starts emulated time at the epoch, and in emulated time mode the cartridge
+	// clock at 0, in the initial state of a load or reset.
+	void setInitRtc(SaveState &state) const {
+		state.rtc.emulatedTime = rtcEpoch;
+		if (rtcMode == RTC_EMULATED_TIME)
+			state.rtc.baseTime = state.rtc.haltTime = rtcEpoch;
+	}
 
-	Priv() : stateNo(1), loadflags(0) {}
+	std::size_t saveStateFile(uint_least32_t const *videoBuf, std::ptrdiff_t pitch,
+	                          std::string const &filepath, uint_least64_t *hash = 0);
+	bool runFrame(uint_least32_t *audioBuf, bool discardAudio, std::size_t &samples);
 };
 
+// Captures the state, and queues it to be written to filepath. Sets *hash to
+// the stateHash of the state if hash is not null. Returns the size of the state.
+std::size_t GB::Priv::saveStateFile(uint_least32_t const *const videoBuf,
+		std::ptrdiff_t const pitch, std::string const &filepath, uint_least64_t *const hash) {
+	// Zeroed, so that fields the cartridge type does not use are saved as zeros
+	// rather than whatever was on the stack. States, and their hashes, are then
+	// the same for the same emulator state.
+	SaveState state = SaveState();
+	cpu.setStatePtrs(state);
+	cpu.saveState(state);
+
+	StateSaver::saveState(state, videoBuf, pitch, stateFileData);
+	if (hash)
+		*hash = StateSaver::hashState(state);
+
+	std::size_t const size = stateFileData.size();
+	stateFileWriter.write(filepath, stateFileData);
+	return size;
+}
+
 GB::GB() : p_(new Priv) {}
 
 GB::~GB() {
 	if (p_->cpu.loaded())
-		p_->cpu.saveSavedata();
+		p_->saveSavedataImplicitly();
 
 	delete p_;
 }
@@ -75,11 +154,68 @@ std::ptrdiff_t GB::runFor(gambatte::uint_least32_t *const videoBuf, std::ptrdiff
 	     : cyclesSinceBlit;
 }
 
+// Runs in chunks of up to a frame's worth of samples until a video frame is drawn,
+// or until audioBuf is full. The audio of each chunk follows that of the last in
+// audioBuf, or, when it is discarded, overwrites it, so that the buffer never fills.
+bool GB::Priv::runFrame(uint_least32_t *const audioBuf, bool const discardAudio,
+		std::size_t &samples) {
+	samples = 0;
+	for (;;) {
+		std::size_t const pos = discardAudio ? 0 : samples;
+		if (pos + max_overproduction >= max_frame_samples)
+			return false;
+
+		std::size_t const chunk = std::min(samples_per_frame,
+			max_frame_samples - max_overproduction - pos);
+		cpu.setSoundBuffer(audioBuf + pos);
+		long const cyclesSinceBlit = cpu.runFor(chunk * 2);
+		samples += cpu.fillSoundBuffer();
+		if (cyclesSinceBlit >= 0)
+			return true;
+	}
+}
+
+bool GB::runFrame(gambatte::uint_least32_t *const videoBuf, std::ptrdiff_t const pitch,
+		gambatte::uint_least32_t *const audioBuf, std::size_t &samples) {
+	if (!p_->cpu.loaded()) {
+		samples = 0;
+		return false;
+	}
+
+	p_->cpu.setVideoBuffer(videoBuf, pitch);
+	return p_->runFrame(audioBuf, false, samples);
+}
+
+void GB::runFrame(gambatte::uint_least32_t *const videoBuf, std::ptrdiff_t const pitch) {
+	if (!p_->cpu.loaded())
+		return;
+
+	std::size_t samples;
+	p_->discardedAudio.resize(samples_per_frame + max_overproduction);
+	p_->cpu.setVideoBuffer(videoBuf, pitch);
+	p_->runFrame(&p_->discardedAudio[0], true, samples);
+}
+
+long GB::runUntil(RunCondition const &condition, unsigned long const cycles,
+		gambatte::uint_least32_t *const videoBuf, std::ptrdiff_t const pitch,
+		gambatte::uint_least32_t *const audioBuf, std::size_t &samples) {
+	if (!p_->cpu.loaded()) {
+		samples = 0;
+		return -1;
+	}
+
+	p_->cpu.setVideoBuffer(videoBuf, pitch);
+	p_->cpu.setSoundBuffer(audioBuf);
+	long const cyclesUntilMet = p_->cpu.runUntil(condition, cycles);
+	samples = p_->cpu.fillSoundBuffer();
+	return cyclesUntilMet;
+}
+
 void GB::resetWithFlags(unsigned const flags, const bool saveSaveData) {
 	p_->loadflags = flags;
     if (p_->cpu.loaded()) {
         if (saveSaveData) {
-            p_->cpu.saveSavedata();
+            p_->saveSavedataImplicitly();
         }
         
         p_->cpu.resetMemorySize(flags & FORCE_DMG);
@@ -91,41 +227,65 @@ void GB::resetWithFlags(unsigned const flags, const bool saveSaveData) {
 void GB::reset(const bool saveSaveData) {
 	if (p_->cpu.loaded()) {
         if (saveSaveData) {
-    		p_->cpu.saveSavedata();
+    		p_->saveSavedataImplicitly();
         }
 
 		SaveState state;
 		p_->cpu.setStatePtrs(state);
 		setInitState(state, p_->cpu.isCgb(), p_->loadflags & GBA_CGB, p_->cpu.isBootRomSet());
+		p_->setInitRtc(state);
 		p_->cpu.loadState(state);
-		p_->cpu.loadSavedata();
+		if (!(p_->loadflags & NO_SAVEDATA))
+			p_->cpu.loadSavedata();
 	}
 }
 
 void GB::setInputGetter(InputGetter *getInput) {
 	p_->cpu.setInputGetter(getInput);
+	p_->inputTimeline.clear();
+}
+
+void GB::setInputTimeline(std::vector<InputChange> const &input) {
+	p_->cpu.setInputGetter(0);
+	p_->inputTimeline.assign(input.begin(), input.end());
+	p_->setInputTimeline(0);
+}
+
+unsigned long GB::inputTimelineFrame() const {
+	return p_->cpu.inputTimelineFrame();
 }
 
 void GB::setSaveDir(std::string const &sdir) {
 	p_->cpu.setSaveDir(sdir);
 }
 
+void GB::setRtcMode(RtcMode const mode, std::time_t const epoch) {
+	p_->rtcMode = mode;
+	p_->rtcEpoch = epoch;
+	p_->cpu.setRtcUseEmulatedTime(mode == RTC_EMULATED_TIME);
+}
+
 LoadRes GB::load(std::string const &romfile, unsigned const flags) {
 	if (p_->cpu.loaded())
-		p_->cpu.saveSavedata();
+		p_->saveSavedataImplicitly();
 
 	LoadRes const loadres = p_->cpu.load(romfile,
 	                                     flags & FORCE_DMG,
-	                                     flags & MULTICART_COMPAT);
+	                                     flags & MULTICART_COMPAT,
+	                                     flags & REUSE_ROM);
 	if (loadres == LOADRES_OK) {
 		SaveState state;
 		p_->cpu.setStatePtrs(state);
 		p_->loadflags = flags;
 		setInitState(state, p_->cpu.isCgb(), flags & GBA_CGB, p_->cpu.isBootRomSet());
+		p_->setInitRtc(state);
 		p_->cpu.loadState(state);
-		p_->cpu.loadSavedata();
+		if (!(flags & NO_SAVEDATA))
+			p_->cpu.loadSavedata();
 
 		p_->stateNo = 1;
+		p_->ownsSavedata = !(flags & NO_SAVEDATA);
+		p_->rewinder.clear();
 	}
 
 	return loadres;
@@ -139,6 +299,14 @@ bool GB::isLoaded() const {
 	return p_->cpu.loaded();
 }
 
+unsigned GB::peek(unsigned address) const {
+	return p_->cpu.loaded() ? p_->cpu.peek(address & 0xFFFF) : 0xFF;
+}
+
+MemoryView GB::memoryView(MemoryArea const area) const {
+	return p_->cpu.memoryView(area);
+}
+
 void GB::saveSavedata() {
 	if (p_->cpu.loaded())
 		p_->cpu.saveSavedata();
@@ -150,7 +318,8 @@ void GB::setDmgPaletteColor(int palNum, int colorNum, unsigned long rgb32) {
 
 bool GB::loadState(std::string const &filepath) {
 	if (p_->cpu.loaded()) {
-		p_->cpu.saveSavedata();
+		p_->saveSavedataImplicitly();
+		p_->stateFileWriter.wait();
 
 		SaveState state;
 		p_->cpu.setStatePtrs(state);
@@ -165,7 +334,22 @@ bool GB::loadState(std::string const &filepath) {
 }
 
 bool GB::saveState(gambatte::uint_least32_t const *videoBuf, std::ptrdiff_t pitch) {
-	return saveState(videoBuf, pitch, statePath(p_->cpu.saveBasePath(), p_->stateNo));
+	if (p_->cpu.loaded()) {
+		std::string const basePath = p_->cpu.saveBasePath();
+		uint_least64_t hash = 0;
+		std::size_t const size = p_->saveStateFile(videoBuf, pitch,
+		                                           statePath(basePath, p_->stateNo), &hash);
+
+		p_->loadStateSlotIndex();
+		p_->stateSlotIndex.update(p_->stateNo, size, hash, videoBuf, pitch);
+
+		// Not compressed as a whole, so that the slot entries can be read directly.
+		p_->stateSlotIndex.save(p_->stateSlotIndexData);
+		p_->stateFileWriter.write(p_->stateSlotIndex.filepath(), p_->stateSlotIndexData, false);
+		return true;
+	}
+
+	return false;
 }
 
 bool GB::loadState() {
@@ -174,11 +358,185 @@ bool GB::loadState() {
 
 bool GB::saveState(gambatte::uint_least32_t const *videoBuf, std::ptrdiff_t pitch,
                    std::string const &filepath) {
+	if (p_->cpu.loaded()) {
+		p_->saveStateFile(videoBuf, pitch, filepath);
+		return true;
+	}
+
+	return false;
+}
+
+bool GB::flushStateFiles() {
+	return p_->stateFileWriter.flush();
+}
+
+bool GB::pollStateFiles() {
+	return p_->stateFileWriter.poll();
+}
+
+bool GB::saveState(std::vector<char> &data) {
+	if (p_->cpu.loaded()) {
+		SaveState state = SaveState();
+		p_->cpu.setStatePtrs(state);
+		p_->cpu.saveState(state);
+		StateSaver::saveState(state, data);
+		return true;
+	}
+
+	return false;
+}
+
+std::size_t GB::saveState(char *const buf, std::size_t const bufsize) {
+	if (p_->cpu.loaded()) {
+		SaveState state = SaveState();
+		p_->cpu.setStatePtrs(state);
+		p_->cpu.saveState(state);
+		return StateSaver::saveState(state, buf, bufsize);
+	}
+
+	return 0;
+}
+
+bool GB::saveStateRaw(std::vector<char> &data) {
+	if (p_->cpu.loaded()) {
+		SaveState state = SaveState();
+		p_->cpu.setStatePtrs(state);
+		p_->cpu.saveState(state);
+		StateSaver::saveRawState(state, data);
+		return true;
+	}
+
+	return false;
+}
+
+std::size_t GB::saveStateRaw(char *const buf, std::size_t const bufsize) {
+	if (p_->cpu.loaded()) {
+		SaveState state = SaveState();
+		p_->cpu.setStatePtrs(state);
+		p_->cpu.saveState(state);
+		return StateSaver::saveRawState(state, buf, bufsize);
+	}
+
+	return 0;
+}
+
+bool GB::loadState(void const *const data, std::size_t const size) {
 	if (p_->cpu.loaded()) {
 		SaveState state;
 		p_->cpu.setStatePtrs(state);
+
+		if (StateSaver::loadState(state, static_cast<char const *>(data), size)) {
+			p_->cpu.loadState(state);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void GB::setRewindBufferSize(std::size_t const maxBytes, unsigned const keyframeInterval) {
+	p_->rewinder.reset(maxBytes, keyframeInterval);
+}
+
+bool GB::rewindPush() {
+	if (!p_->rewinder.bytesLimit() || !saveStateRaw(p_->rewindState))
+		return false;
+
+	p_->rewinder.push(p_->rewindState);
+	return true;
+}
+
+bool GB::rewindPop() {
+	return p_->rewinder.pop(p_->rewindState)
+	    && loadState(&p_->rewindState[0], p_->rewindState.size());
+}
+
+std::size_t GB::rewindDepth() const {
+	return p_->rewinder.size();
+}
+
+bool GB::runAhead(unsigned const frames,
+		gambatte::uint_least32_t *const videoBuf, std::ptrdiff_t const pitch) {
+	if (!saveStateRaw(p_->runAheadState))
+		return false;
+
+	// Only the last frame is drawn. The input timeline goes back with the state.
+	unsigned long const inputFrame = p_->cpu.inputTimelineFrame();
+	for (unsigned i = 0; i < frames; ++i)
+		runFrame(i + 1 == frames ? videoBuf : 0, pitch);
+
+	p_->setInputTimeline(inputFrame);
+	return loadState(&p_->runAheadState[0], p_->runAheadState.size());
+}
+
+void GB::setDirtyTracking(bool enable) {
+	p_->cpu.setWriteTracking(enable);
+}
+
+void GB::dirtyPages(std::vector<unsigned> &pages) const {
+	unsigned char const *const dirty = p_->cpu.dirtyPages();
+	pages.clear();
+	for (std::size_t i = 0; i < p_->cpu.numPages(); ++i) {
+		if (dirty[i])
+			pages.push_back(i);
+	}
+}
+
+void GB::clearDirtyPages() {
+	p_->cpu.clearDirty();
+}
+
+gambatte::uint_least64_t GB::stateHash() {
+	if (p_->cpu.loaded()) {
+		SaveState state = SaveState();
+		p_->cpu.setStatePtrs(state);
+		p_->cpu.saveState(state);
+		return StateSaver::hashState(state);
+	}
+
+	return 0;
+}
+
+GB * GB::clone() {
+	GB *const gb = new GB;
+	if (p_->cpu.loaded()) {
+		Priv &clone = *gb->p_;
+		clone.cpu.load(p_->cpu, p_->loadflags & MULTICART_COMPAT);
+		clone.stateNo = p_->stateNo;
+		clone.loadflags = p_->loadflags;
+		clone.ownsSavedata = false;
+		clone.rtcMode = p_->rtcMode;
+		clone.rtcEpoch = p_->rtcEpoch;
+		clone.cpu.setRtcUseEmulatedTime(p_->rtcMode == RTC_EMULATED_TIME);
+		clone.inputTimeline = p_->inputTimeline;
+		if (!p_->inputTimeline.empty())
+			clone.setInputTimeline(p_->cpu.inputTimelineFrame());
+
+		SaveState state = SaveState();
+		p_->cpu.setStatePtrs(state);
 		p_->cpu.saveState(state);
-		return StateSaver::saveState(state, videoBuf, pitch, filepath);
+
+		SaveState cloneState;
+		clone.cpu.setStatePtrs(cloneState);
+		StateSaver::copyState(state, cloneState);
+		clone.cpu.loadState(cloneState);
+	}
+
+	return gb;
+}
+
+void GB::stateSlots(std::vector<StateSlotInfo> &slots) {
+	if (p_->cpu.loaded()) {
+		p_->loadStateSlotIndex();
+		slots = p_->stateSlotIndex.slots();
+	} else
+		slots.clear();
+}
+
+bool GB::stateSlotThumbnail(int slot, std::vector<gambatte::uint_least32_t> &thumb) {
+	if (p_->cpu.loaded()) {
+		p_->loadStateSlotIndex();
+		return p_->stateSlotIndex.thumbnail(slot, thumb);
 	}
 
 	return false;
@@ -203,6 +561,8 @@ std::string const GB::romTitle() const {
 
 PakInfo const GB::pakInfo() const { return p_->cpu.pakInfo(p_->loadflags & MULTICART_COMPAT); }
 
+gambatte::uint_least64_t GB::romHash() const { return p_->cpu.romHash(); }
+
 void GB::setGameGenie(std::string const &codes) {
 	p_->cpu.setGameGenie(codes);
 }
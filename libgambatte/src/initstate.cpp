@@ -1325,6 +1325,8 @@ void gambatte::setInitState(SaveState &state, bool const cgb, bool const gbaCgbM
 
 	state.rtc.baseTime = std::time(0);
 	state.rtc.haltTime = state.rtc.baseTime;
+	state.rtc.emulatedTime = 0;
+	state.rtc.emulatedTicks = 0;
 	state.rtc.dataDh = 0;
 	state.rtc.dataDl = 0;
 	state.rtc.dataH = 0;
@@ -0,0 +1,244 @@
+//
+//   Copyright (C) 2026 by the Gambatte contributors
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License version 2 for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   version 2 along with this program; if not, write to the
+//   Free Software Foundation, Inc.,
+//   51 Franklin St, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+
+#include "inputmovie.h"
+#include "gambatte.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+// Movie files are little endian:
+//
+//   "GBIM" 01          magic and version
+//   u32 loadFlags
+//   u64 romHash
+//   u32 frames
+//   u32 input changes
+//   u32 start state size, then the start state
+//   per input change: the frames since the previous change (or since the
+//   start), as a base 128 varint, low groups first, and a byte of buttons.
+
+namespace gambatte {
+
+namespace {
+
+unsigned char const movie_magic[] = { 'G', 'B', 'I', 'M', 1 };
+std::size_t const movie_header_size = sizeof movie_magic + 4 + 8 + 4 + 4 + 4;
+
+void putInt(std::vector<char> &out, uint_least64_t n, unsigned bytes) {
+	for (unsigned i = 0; i < bytes; ++i)
+		out.push_back(static_cast<char>(n >> (8 * i) & 0xFF));
+}
+
+void putVarint(std::vector<char> &out, unsigned long n) {
+	while (n >= 0x80) {
+		out.push_back(static_cast<char>((n & 0x7F) | 0x80));
+		n >>= 7;
+	}
+
+	out.push_back(static_cast<char>(n));
+}
+
+class Reader {
+public:
+	Reader(std::vector<char> const &data) : p_(data.begin()), end_(data.end()) {}
+	bool atEnd() const { return p_ == end_; }
+	std::size_t left() const { return end_ - p_; }
+	void skip(std::size_t size) { p_ += size; }
+
+	bool get(uint_least64_t &n, unsigned bytes) {
+		if (left() < bytes)
+			return false;
+
+		n = 0;
+		for (unsigned i = 0; i < bytes; ++i)
+			n |= uint_least64_t(static_cast<unsigned char>(*p_++)) << (8 * i);
+
+		return true;
+	}
+
+	bool getVarint(unsigned long &n) {
+		n = 0;
+		for (unsigned shift = 0; shift < 32; shift += 7) {
+			if (atEnd())
+				return false;
+
+			unsigned const c = static_cast<unsigned char>(*p_++);
+			n |= static_cast<unsigned long>(c & 0x7F) << shift;
+			if (!(c & 0x80))
+				return true;
+		}
+
+		return false;
+	}
+
+	bool getBytes(std::vector<char> &out, std::size_t size) {
+		if (left() < size)
+			return false;
+
+		out.assign(p_, p_ + size);
+		p_ += size;
+		return true;
+	}
+
+private:
+	std::vector<char>::const_iterator p_;
+	std::vector<char>::const_iterator const end_;
+};
+
+} // anon namespace
+
+bool saveInputMovie(InputMovie const &movie, std::string const &filepath) {
+	std::vector<char> data(movie_magic, movie_magic + sizeof movie_magic);
+	data.reserve(movie_header_size + movie.startState.size() + 2 * movie.input.size());
+	putInt(data, movie.loadFlags, 4);
+	putInt(data, movie.romHash, 8);
+	putInt(data, movie.frames, 4);
+	putInt(data, movie.input.size(), 4);
+	putInt(data, movie.startState.size(), 4);
+	data.insert(data.end(), movie.startState.begin(), movie.startState.end());
+
+	unsigned long frame = 0;
+	for (std::size_t i = 0; i < movie.input.size(); ++i) {
+		putVarint(data, movie.input[i].frame - frame);
+		data.push_back(static_cast<char>(movie.input[i].buttons & 0xFF));
+		frame = movie.input[i].frame;
+	}
+
+	std::ofstream file(filepath.c_str(), std::ios_base::binary);
+	file.write(&data[0], data.size());
+	return file.good();
+}
+
+bool loadInputMovie(InputMovie &movie, std::string const &filepath) {
+	std::ifstream file(filepath.c_str(), std::ios_base::binary);
+	if (!file)
+		return false;
+
+	std::vector<char> const data((std::istreambuf_iterator<char>(file)),
+	                             std::istreambuf_iterator<char>());
+	if (data.size() < movie_header_size
+			|| std::memcmp(&data[0], movie_magic, sizeof movie_magic)) {
+		return false;
+	}
+
+	Reader r(data);
+	uint_least64_t loadFlags, romHash, frames, changes, stateSize;
+	r.skip(sizeof movie_magic);
+	if (!r.get(loadFlags, 4) || !r.get(romHash, 8) || !r.get(frames, 4)
+			|| !r.get(changes, 4) || !r.get(stateSize, 4)) {
+		return false;
+	}
+
+	InputMovie m;
+	m.loadFlags = loadFlags;
+	m.romHash = romHash;
+	m.frames = frames;
+	if (!r.getBytes(m.startState, stateSize) || changes > r.left() / 2)
+		return false;
+
+	m.input.resize(changes);
+	unsigned long frame = 0;
+	for (std::size_t i = 0; i < m.input.size(); ++i) {
+		unsigned long delta;
+		uint_least64_t buttons;
+		if (!r.getVarint(delta) || !r.get(buttons, 1))
+			return false;
+
+		frame += delta;
+		m.input[i].frame = frame;
+		m.input[i].buttons = buttons;
+	}
+
+	if (!r.atEnd())
+		return false;
+
+	std::swap(movie, m);
+	return true;
+}
+
+InputMovieRecorder::InputMovieRecorder(InputGetter &source)
+: source_(source)
+, buttons_(0)
+{
+}
+
+bool InputMovieRecorder::start(GB &gb, unsigned const loadFlags) {
+	InputMovie m;
+	m.romHash = gb.romHash();
+	m.loadFlags = loadFlags;
+	if (!m.romHash || !gb.saveState(m.startState)
+			|| !gb.loadState(&m.startState[0], m.startState.size())) {
+		return false;
+	}
+
+	std::swap(movie_, m);
+	buttons_ = 0;
+	gb.setInputGetter(this);
+	sample();
+	return true;
+}
+
+void InputMovieRecorder::sample() {
+	unsigned const buttons = source_() & 0xFF;
+	if (buttons != buttons_) {
+		InputChange const in = { movie_.frames, buttons };
+		movie_.input.push_back(in);
+		buttons_ = buttons;
+	}
+}
+
+void InputMovieRecorder::frameDone() {
+	++movie_.frames;
+	sample();
+}
+
+InputMoviePlayer::InputMoviePlayer(InputMovie const &movie)
+: movie_(movie)
+, next_(movie.input.begin())
+, frame_(0)
+, buttons_(0)
+{
+}
+
+bool InputMoviePlayer::start(GB &gb) {
+	if (gb.romHash() != movie_.romHash || movie_.startState.empty()
+			|| !gb.loadState(&movie_.startState[0], movie_.startState.size())) {
+		return false;
+	}
+
+	next_ = movie_.input.begin();
+	frame_ = 0;
+	buttons_ = 0;
+	gb.setInputGetter(this);
+	advance();
+	return true;
+}
+
+void InputMoviePlayer::advance() {
+	for (; next_ != movie_.input.end() && next_->frame <= frame_; ++next_)
+		buttons_ = next_->buttons;
+}
+
+void InputMoviePlayer::frameDone() {
+	++frame_;
+	advance();
+}
+
+}
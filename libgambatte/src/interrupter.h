@@ -37,6 +37,7 @@ public:
 	Interrupter(unsigned short &sp, unsigned short &pc);
 	unsigned long interrupt(unsigned long cycleCounter, Memory &memory);
 	void setGameShark(std::string const &codes);
+	void setGameShark(Interrupter const &other) { gsCodes_ = other.gsCodes_; }
 
 private:
 	unsigned short &sp_;
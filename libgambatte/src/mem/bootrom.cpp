@@ -19,6 +19,7 @@
 #include "../common/scoped_ptr.h"
 #include "../file/file.h"
 #include "bootrom.h"
+#include <algorithm>
 #include <ios>
 
 using namespace std;
@@ -41,6 +42,13 @@ BootRom::BootRom(const string &filename, size_t expectedSize_)
 	file->read(reinterpret_cast<char *>(romData), expectedSize);
 }
 
+BootRom::BootRom(const BootRom &other)
+: romData(new unsigned char[other.expectedSize])
+, enabled(other.enabled)
+, expectedSize(other.expectedSize) {
+	copy(other.romData, other.romData + expectedSize, romData);
+}
+
 BootRom::~BootRom() {
 	delete []romData;
 }
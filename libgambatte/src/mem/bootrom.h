@@ -26,6 +26,7 @@ namespace gambatte {
 class BootRom {
 public:
 	BootRom(const std::string &filename, size_t expectedSize);
+	BootRom(const BootRom &other);
 	virtual ~BootRom();
 	virtual bool isReadInBootRom(unsigned p) const;
 	virtual unsigned read(unsigned p) const;
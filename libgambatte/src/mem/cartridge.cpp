@@ -19,6 +19,7 @@
 #include "cartridge.h"
 #include "file/file.h"
 #include "../savestate.h"
+#include "../xxh64.h"
 #include "pakinfo_internal.h"
 #include <cstring>
 #include <fstream>
@@ -551,8 +552,19 @@ void Cartridge::setSaveDir(std::string const &dir) {
 
 LoadRes Cartridge::loadROM(std::string const &romfile,
                            bool const forceDmg,
-                           bool const multicartCompat)
+                           bool const multicartCompat,
+                           bool const reuseRom)
 {
+	if (reuseRom && loaded() && romfile == romfile_) {
+		if (!ggUndoList_.empty())
+			setGameGenie(std::string());
+
+		rtc_.set(false, 0);
+		setMemPtrs(forceDmg);
+		setMbc(multicartCompat);
+		return LOADRES_OK;
+	}
+
 	scoped_ptr<File> const rom(newFileInstance(romfile));
 	if (rom->fail())
 		return LOADRES_IO_ERROR;
@@ -608,9 +620,10 @@ LoadRes Cartridge::loadROM(std::string const &romfile,
 	std::size_t const filesize = rom->size();
 	rombanks = std::max(pow2ceil(filesize / rombank_size()), 2u);
 
+	// The MBC is kept until the ROM data is read, so that setMbc can reuse it.
+	romfile_.clear();
 	defaultSaveBasePath_.clear();
 	ggUndoList_.clear();
-	mbc_.reset();
 	memptrs_.reset(rombanks, rambanks, cgb ? 8 : 2);
 	rtc_.set(false, 0);
 
@@ -620,9 +633,12 @@ LoadRes Cartridge::loadROM(std::string const &romfile,
 	            0xFF,
 	            (rombanks - filesize / rombank_size()) * rombank_size());
 
-	if (rom->fail())
+	if (rom->fail()) {
+		mbc_.reset();
 		return LOADRES_IO_ERROR;
+	}
 
+	romfile_ = romfile;
 	defaultSaveBasePath_ = stripExtension(romfile);
 
 	setMbc(multicartCompat);
@@ -630,6 +646,21 @@ LoadRes Cartridge::loadROM(std::string const &romfile,
 	return LOADRES_OK;
 }
 
+void Cartridge::loadROM(Cartridge const &other, bool const multicartCompat) {
+	unsigned const wrambanks =
+		(other.memptrs_.wramdataend() - other.memptrs_.wramdata(0)) / wrambank_size();
+
+	type_ = other.type_;
+	romfile_ = other.romfile_;
+	defaultSaveBasePath_ = other.defaultSaveBasePath_;
+	saveDir_ = other.saveDir_;
+	ggUndoList_ = other.ggUndoList_;
+	memptrs_.reset(other.memptrs_, rambanks(other.memptrs_), wrambanks);
+	memptrs_.setWriteTracking(other.memptrs_.writeTracking());
+	rtc_.set(false, 0);
+	setMbc(multicartCompat);
+}
+
 void Cartridge::setMemPtrs(bool const forceDmg) {
 	unsigned rambanks = numRambanksFromH14x(memptrs_.romdata()[0x147], memptrs_.romdata()[0x149]);
 	bool cgb = memptrs_.romdata()[0x0143] >> 7 & (1 ^ forceDmg);
@@ -637,10 +668,20 @@ void Cartridge::setMemPtrs(bool const forceDmg) {
 }
 
 void Cartridge::setMbc(bool const multicartCompat) {
+	bool const multi64 = type_ == type_mbc1 && multicartCompat
+		&& presumedMulti64Mbc1(memptrs_.romdata(), (memptrs_.romdata() - memptrs_.romdataend()) / 0x4000);
+	bool const rtc = type_ == type_mbc3 && hasRtc(memptrs_.romdata()[0x147]);
+
+	// Every MBC gets its state loaded after this, so one of the same kind can be kept.
+	unsigned const kind = type_ << 2 | multi64 << 1 | rtc;
+	if (mbc_ && mbcKind_ == kind)
+		return;
+
+	mbcKind_ = kind;
 	switch (type_) {
 	case type_plain: mbc_.reset(new Mbc0(memptrs_)); break;
 	case type_mbc1:
-		if (multicartCompat && presumedMulti64Mbc1(memptrs_.romdata(), (memptrs_.romdata() - memptrs_.romdataend()) / 0x4000)) {
+		if (multi64) {
 			mbc_.reset(new Mbc1Multi64(memptrs_));
 		} else
 			mbc_.reset(new Mbc1(memptrs_));
@@ -648,7 +689,7 @@ void Cartridge::setMbc(bool const multicartCompat) {
 		break;
 	case type_mbc2: mbc_.reset(new Mbc2(memptrs_)); break;
 	case type_mbc3:
-		mbc_.reset(new Mbc3(memptrs_, hasRtc(memptrs_.romdata()[0x147]) ? &rtc_ : 0));
+		mbc_.reset(new Mbc3(memptrs_, rtc ? &rtc_ : 0));
 		break;
 	case type_mbc5: mbc_.reset(new Mbc5(memptrs_)); break;
 	case type_huc1: mbc_.reset(new HuC1(memptrs_)); break;
@@ -665,6 +706,8 @@ void Cartridge::loadSavedata() {
 			file.read(reinterpret_cast<char*>(memptrs_.rambankdata()),
 			          memptrs_.rambankdataend() - memptrs_.rambankdata());
 		}
+
+		memptrs_.markAllDirty();
 	}
 
 	if (hasRtc(memptrs_.romdata()[0x147])) {
@@ -724,6 +767,7 @@ void Cartridge::applyGameGenie(std::string const &code) {
 
 void Cartridge::setGameGenie(std::string const &codes) {
 	if (loaded()) {
+		memptrs_.unshareRom();
 		for (std::vector<AddrData>::reverse_iterator it =
 				ggUndoList_.rbegin(), end = ggUndoList_.rend(); it != end; ++it) {
 			if (memptrs_.romdata() + it->addr < memptrs_.romdataend())
@@ -750,3 +794,12 @@ PakInfo const Cartridge::pakInfo(bool const multipakCompat) const {
 
 	return PakInfo();
 }
+
+uint_least64_t Cartridge::romHash() const {
+	if (!loaded())
+		return 0;
+
+	Xxh64 hash;
+	hash.update(memptrs_.romdata(), std::size_t(rombanks(memptrs_)) * rombank_size());
+	return hash.digest();
+}
@@ -44,6 +44,7 @@ public:
 	void saveState(SaveState &) const;
 	void loadState(SaveState const &);
 	bool loaded() const { return mbc_.get(); }
+	MemPtrs const & memptrs() const { return memptrs_; }
 	unsigned char const * rmem(unsigned area) const { return memptrs_.rmem(area); }
 	unsigned char * wmem(unsigned area) const { return memptrs_.wmem(area); }
 	unsigned char * vramdata() const { return memptrs_.vramdata(); }
@@ -58,17 +59,32 @@ public:
 	void setVrambank(unsigned bank) { memptrs_.setVrambank(bank); }
 	void setWrambank(unsigned bank) { memptrs_.setWrambank(bank); }
 	void setOamDmaSrc(OamDmaSrc oamDmaSrc) { memptrs_.setOamDmaSrc(oamDmaSrc); }
+	void setWriteTracking(bool enable) { memptrs_.setWriteTracking(enable); }
+	void markDirty(unsigned char const *p) { memptrs_.markDirty(p); }
+	void markAllDirty() { memptrs_.markAllDirty(); }
+	void clearDirty() { memptrs_.clearDirty(); }
+	unsigned char const * dirtyPages() const { return memptrs_.dirtyPages(); }
+	std::size_t numPages() const { return memptrs_.numPages(); }
 	void mbcWrite(unsigned addr, unsigned data) { mbc_->romWrite(addr, data); }
 	bool isCgb() const { return gambatte::isCgb(memptrs_); }
 	void rtcWrite(unsigned data) { rtc_.write(data); }
+	void setRtcUseEmulatedTime(bool enable) { rtc_.setUseEmulatedTime(enable); }
+	void updateRtc(unsigned long cc, bool ds) { rtc_.update(cc, ds); }
+	void resetRtcCc(unsigned long oldCc, unsigned long newCc, bool ds) { rtc_.resetCc(oldCc, newCc, ds); }
 	unsigned char rtcRead() const { return *rtc_.activeData(); }
 	void loadSavedata();
 	void saveSavedata();
 	std::string const saveBasePath() const;
 	void setSaveDir(std::string const &dir);
-	LoadRes loadROM(std::string const &romfile, bool forceDmg, bool multicartCompat);
+	// With reuseRom, romfile is not read again if it is the ROM image already loaded.
+	// Any Game Genie codes are undone instead.
+	LoadRes loadROM(std::string const &romfile, bool forceDmg, bool multicartCompat, bool reuseRom);
+	// Loads the ROM image other has loaded, sharing its ROM data, with the same
+	// save paths and Game Genie codes. The state is left to be loaded separately.
+	void loadROM(Cartridge const &other, bool multicartCompat);
 	char const * romTitle() const { return reinterpret_cast<char const *>(memptrs_.romdata() + 0x134); }
 	class PakInfo const pakInfo(bool multicartCompat) const;
+	uint_least64_t romHash() const;
 	void setGameGenie(std::string const &codes);
 	void setMemPtrs(bool const forceDmg);
 	void setMbc(bool const multicartCompat);
@@ -90,7 +106,9 @@ private:
 	MemPtrs memptrs_;
 	Rtc rtc_;
 	scoped_ptr<Mbc> mbc_;
+	unsigned mbcKind_;
 	Cartridgetype type_;
+	std::string romfile_;
 	std::string defaultSaveBasePath_;
 	std::string saveDir_;
 	std::vector<AddrData> ggUndoList_;
@@ -79,63 +79,70 @@ MemPtrs::MemPtrs()
 , vrambankptr_(0)
 , rsrambankptr_(0)
 , wsrambankptr_(0)
+, romdataend_(0)
 , rambankdata_(0)
 , wramdataend_(0)
 , oamDmaSrc_(oam_dma_src_off)
+, writeTracking_(false)
 {
 }
 
 void MemPtrs::reset(unsigned const rombanks, unsigned const rambanks, unsigned const wrambanks) {
-	int const num_disabled_ram_areas = 2;
-	memchunk_.reset(
-		  pre_rom_pad_size()
-		+ rombanks * rombank_size()
-		+ max_num_vrambanks * vrambank_size()
-		+ rambanks * rambank_size()
-		+ wrambanks * wrambank_size()
-		+ num_disabled_ram_areas * rambank_size());
-
-	romdata_[0] = romdata();
-	rambankdata_ = romdata_[0] + rombanks * rombank_size() + max_num_vrambanks * vrambank_size();
-	wramdata_[0] = rambankdata_ + rambanks * rambank_size();
-	wramdataend_ = wramdata_[0] + wrambanks * wrambank_size();
-
-	std::fill_n(rdisabledRamw(), rambank_size(), 0xFF);
+	if (romchunk_.use_count() != 1 || romdataend_ != romdata() + rombanks * rombank_size()) {
+		romchunk_.reset(new unsigned char[pre_rom_pad_size() + rombanks * rombank_size()],
+		                std::default_delete<unsigned char[]>());
+		romdataend_ = romdata() + rombanks * rombank_size();
+	}
 
-	oamDmaSrc_ = oam_dma_src_off;
-	rmem_[0x3] = rmem_[0x2] = rmem_[0x1] = rmem_[0x0] = romdata_[0];
-	rmem_[0xC] = wmem_[0xC] = wramdata_[0] - mm_wram_begin;
-	rmem_[0xE] = wmem_[0xE] = wramdata_[0] - mm_wram_mirror_begin;
-	setRombank(1);
-	setRambank(0, 0);
-	setVrambank(0);
-	setWrambank(1);
+	resetRam(rambanks, wrambanks);
 }
 
 void MemPtrs::resetWithRomIntact(unsigned const rambanks, unsigned const wrambanks) {
-	unsigned romsize = romdataend() - romdata();
+	resetRam(rambanks, wrambanks);
+}
+
+void MemPtrs::reset(MemPtrs const &rom, unsigned const rambanks, unsigned const wrambanks) {
+	romchunk_ = rom.romchunk_;
+	romdataend_ = rom.romdataend_;
+	resetRam(rambanks, wrambanks);
+}
 
-	const auto oldrom = std::unique_ptr<unsigned char[]>(new unsigned char[rambankdata_ - memchunk_]);
-	std::copy(memchunk_.get(), rambankdata_, oldrom.get());
+void MemPtrs::unshareRom() {
+	if (romchunk_.use_count() <= 1)
+		return;
+
+	std::size_t const size = romdataend_ - romchunk_.get();
+	std::ptrdiff_t const rom0 = romdata_[0] - romdata();
+	std::ptrdiff_t const rom1 = romdata_[1] - romdata();
+	std::shared_ptr<unsigned char> const copy(new unsigned char[size],
+	                                          std::default_delete<unsigned char[]>());
+	std::copy(romchunk_.get(), romdataend_, copy.get());
+	romchunk_ = copy;
+	romdataend_ = romchunk_.get() + size;
+	romdata_[0] = romdata() + rom0;
+	romdata_[1] = romdata() + rom1;
+	setOamDmaSrc(oamDmaSrc_);
+}
 
+void MemPtrs::resetRam(unsigned const rambanks, unsigned const wrambanks) {
 	int const num_disabled_ram_areas = 2;
-	memchunk_.reset(
-		  pre_rom_pad_size()
-		+ romsize
-		+ max_num_vrambanks * vrambank_size()
+	std::size_t const memsize =
+		  max_num_vrambanks * vrambank_size()
 		+ rambanks * rambank_size()
 		+ wrambanks * wrambank_size()
-		+ num_disabled_ram_areas * rambank_size());
-		
-	romdata_[0] = romdata();
-	rambankdata_ = romdata_[0] + romsize + max_num_vrambanks * vrambank_size();
+		+ num_disabled_ram_areas * rambank_size();
+	if (memchunk_.size() != memsize)
+		memchunk_.reset(memsize);
+
+	rambankdata_ = memchunk_ + max_num_vrambanks * vrambank_size();
 	wramdata_[0] = rambankdata_ + rambanks * rambank_size();
 	wramdataend_ = wramdata_[0] + wrambanks * wrambank_size();
 
-	std::copy(oldrom.get(), oldrom.get() + (rambankdata_ - memchunk_), memchunk_.get());
 	std::fill_n(rdisabledRamw(), rambank_size(), 0xFF);
 
+	resetDirtyPages();
 	oamDmaSrc_ = oam_dma_src_off;
+	romdata_[0] = romdata();
 	rmem_[0x3] = rmem_[0x2] = rmem_[0x1] = rmem_[0x0] = romdata_[0];
 	rmem_[0xC] = wmem_[0xC] = wramdata_[0] - mm_wram_begin;
 	rmem_[0xE] = wmem_[0xE] = wramdata_[0] - mm_wram_mirror_begin;
@@ -165,12 +172,15 @@ void MemPtrs::setRambank(unsigned const flags, unsigned const rambank) {
 			: wdisabledRam();
 	}
 
-	rsrambankptr_ = (flags & read_en) && srambankptr != wdisabledRam()
-		? srambankptr - mm_sram_begin
-		: rdisabledRamw() - mm_sram_begin;
-	wsrambankptr_ = flags & write_en
-		? srambankptr - mm_sram_begin
-		: wdisabledRam() - mm_sram_begin;
+	unsigned char *const rsrambank = (flags & read_en) && srambankptr != wdisabledRam()
+		? srambankptr
+		: rdisabledRamw();
+	unsigned char *const wsrambank = flags & write_en ? srambankptr : wdisabledRam();
+
+	// null while the RTC is mapped, so that accesses take the nontrivial path
+	// rather than going through an offset null pointer.
+	rsrambankptr_ = rsrambank ? rsrambank - mm_sram_begin : 0;
+	wsrambankptr_ = wsrambank ? wsrambank - mm_sram_begin : 0;
 	rmem_[0xB] = rmem_[0xA] = rsrambankptr_;
 	wmem_[0xB] = wmem_[0xA] = wsrambankptr_;
 	disconnectOamDmaAreas();
@@ -195,10 +205,31 @@ void MemPtrs::setOamDmaSrc(OamDmaSrc oamDmaSrc) {
 	disconnectOamDmaAreas();
 }
 
+void MemPtrs::setWriteTracking(bool enable) {
+	writeTracking_ = enable;
+	markAllDirty();
+	if (memchunk_)
+		setOamDmaSrc(oamDmaSrc_);
+}
+
+void MemPtrs::resetDirtyPages() {
+	std::size_t const pages = (wramdataend_ - vramdata()) >> dirty_page_shift;
+	if (dirtyPages_.size() != pages)
+		dirtyPages_.reset(pages);
+
+	markAllDirty();
+}
+
 void MemPtrs::disconnectOamDmaAreas() {
-	return isCgb(*this)
-	? ::disconnectOamDmaAreas<true>(rmem_, wmem_, oamDmaSrc_)
-	: ::disconnectOamDmaAreas<false>(rmem_, wmem_, oamDmaSrc_);
+	if (isCgb(*this))
+		::disconnectOamDmaAreas<true>(rmem_, wmem_, oamDmaSrc_);
+	else
+		::disconnectOamDmaAreas<false>(rmem_, wmem_, oamDmaSrc_);
+
+	// Every write pointer update ends up here, so this is where tracked areas are
+	// kept disconnected.
+	if (writeTracking_)
+		std::fill_n(wmem_ + 0xA, 0xF - 0xA, static_cast<unsigned char *>(0));
 }
 
 bool MemPtrs::isInOamDmaConflictArea(unsigned p) const
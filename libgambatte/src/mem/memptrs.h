@@ -20,6 +20,8 @@
 #define MEMPTRS_H
 
 #include "array.h"
+#include <algorithm>
+#include <memory>
 
 namespace gambatte {
 
@@ -44,6 +46,7 @@ enum {
 	mm_hram_begin = 0xFF80 };
 
 enum { max_num_vrambanks = 2 };
+enum { dirty_page_shift = 8 };
 inline std::size_t rambank_size() { return 0x2000; }
 inline std::size_t rombank_size() { return 0x4000; }
 inline std::size_t vrambank_size() { return 0x2000; }
@@ -54,15 +57,23 @@ public:
 	enum RamFlag { read_en = 1, write_en = 2, rtc_en = 4 };
 
 	MemPtrs();
+
+	// Reuses the ROM data and RAM already allocated when the sizes match and the ROM
+	// data is not shared, so that reloading a ROM image does not allocate.
 	void reset(unsigned rombanks, unsigned rambanks, unsigned wrambanks);
     void resetWithRomIntact(unsigned const rambanks, unsigned const wrambanks);
 
+	// Like reset, but shares the ROM data of rom rather than allocating its own.
+	// Shared ROM data must be unshared before it is written to.
+	void reset(MemPtrs const &rom, unsigned rambanks, unsigned wrambanks);
+	void unshareRom();
+
 	unsigned char const * rmem(unsigned area) const { return rmem_[area]; }
 	unsigned char * wmem(unsigned area) const { return wmem_[area]; }
-	unsigned char * romdata() const { return memchunk_ + pre_rom_pad_size(); }
+	unsigned char * romdata() const { return romchunk_.get() + pre_rom_pad_size(); }
 	unsigned char * romdata(unsigned area) const { return romdata_[area]; }
-	unsigned char * romdataend() const { return rambankdata_ - max_num_vrambanks * vrambank_size(); }
-	unsigned char * vramdata() const { return romdataend(); }
+	unsigned char * romdataend() const { return romdataend_; }
+	unsigned char * vramdata() const { return memchunk_; }
 	unsigned char * vramdataend() const { return rambankdata_; }
 	unsigned char * rambankdata() const { return rambankdata_; }
 	unsigned char * rambankdataend() const { return wramdata_[0]; }
@@ -82,6 +93,21 @@ public:
 	void setWrambank(unsigned bank);
 	void setOamDmaSrc(OamDmaSrc oamDmaSrc);
 
+	// Dirty page tracking covers VRAM, SRAM and WRAM, which are laid out back to back
+	// from vramdata() to wramdataend(). While enabled, the write pointers of the SRAM and
+	// WRAM areas are disconnected so that every write takes the path that marks pages.
+	void setWriteTracking(bool enable);
+	bool writeTracking() const { return writeTracking_; }
+	void markDirty(unsigned char const *p) {
+		std::size_t const page = static_cast<std::size_t>(p - vramdata()) >> dirty_page_shift;
+		if (writeTracking_ && page < dirtyPages_.size())
+			dirtyPages_[page] = 1;
+	}
+	void markAllDirty() { std::fill_n(dirtyPages_.get(), dirtyPages_.size(), 1); }
+	void clearDirty() { std::fill_n(dirtyPages_.get(), dirtyPages_.size(), 0); }
+	unsigned char const * dirtyPages() const { return dirtyPages_; }
+	std::size_t numPages() const { return dirtyPages_.size(); }
+
 private:
 	unsigned char const *rmem_[0x10];
 	unsigned char       *wmem_[0x10];
@@ -90,12 +116,18 @@ private:
 	unsigned char *vrambankptr_;
 	unsigned char *rsrambankptr_;
 	unsigned char *wsrambankptr_;
-	SimpleArray<unsigned char> memchunk_;
+	std::shared_ptr<unsigned char> romchunk_;
+	unsigned char *romdataend_;
+	Array<unsigned char> memchunk_;
 	unsigned char *rambankdata_;
 	unsigned char *wramdataend_;
 	OamDmaSrc oamDmaSrc_;
+	Array<unsigned char> dirtyPages_;
+	bool writeTracking_;
 
 	static std::size_t pre_rom_pad_size() { return mm_rom1_begin; }
+	void resetRam(unsigned rambanks, unsigned wrambanks);
+	void resetDirtyPages();
 	void disconnectOamDmaAreas();
 	unsigned char * rdisabledRamw() const { return wramdataend_; }
 	unsigned char * wdisabledRam()  const { return wramdataend_ + rambank_size(); }
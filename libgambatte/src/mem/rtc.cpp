@@ -26,6 +26,9 @@ Rtc::Rtc()
 , activeSet_(0)
 , baseTime_(0)
 , haltTime_(0)
+, emulatedTime_(0)
+, emulatedTicks_(0)
+, lastUpdateCc_(0)
 , index_(5)
 , dataDh_(0)
 , dataDl_(0)
@@ -34,11 +37,12 @@ Rtc::Rtc()
 , dataS_(0)
 , enabled_(false)
 , lastLatchData_(false)
+, useEmulatedTime_(false)
 {
 }
 
 void Rtc::doLatch() {
-	std::time_t tmp = (dataDh_ & 0x40 ? haltTime_ : std::time(0)) - baseTime_;
+	std::time_t tmp = (dataDh_ & 0x40 ? haltTime_ : now()) - baseTime_;
 
 	while (tmp > 0x1FF * 86400) {
 		baseTime_ += 0x1FF * 86400;
@@ -91,6 +95,8 @@ void Rtc::doSwapActive() {
 void Rtc::saveState(SaveState &state) const {
 	state.rtc.baseTime = baseTime_;
 	state.rtc.haltTime = haltTime_;
+	state.rtc.emulatedTime = emulatedTime_;
+	state.rtc.emulatedTicks = emulatedTicks_;
 	state.rtc.dataDh = dataDh_;
 	state.rtc.dataDl = dataDl_;
 	state.rtc.dataH = dataH_;
@@ -102,6 +108,9 @@ void Rtc::saveState(SaveState &state) const {
 void Rtc::loadState(SaveState const &state) {
 	baseTime_ = state.rtc.baseTime;
 	haltTime_ = state.rtc.haltTime;
+	emulatedTime_ = state.rtc.emulatedTime;
+	emulatedTicks_ = state.rtc.emulatedTicks & (ticks_per_second - 1);
+	lastUpdateCc_ = state.cpu.cycleCounter;
 	dataDh_ = state.rtc.dataDh;
 	dataDl_ = state.rtc.dataDl;
 	dataH_ = state.rtc.dataH;
@@ -112,42 +121,42 @@ void Rtc::loadState(SaveState const &state) {
 }
 
 void Rtc::setDh(unsigned const newDh) {
-	std::time_t const unixtime = dataDh_ & 0x40 ? haltTime_ : std::time(0);
+	std::time_t const unixtime = dataDh_ & 0x40 ? haltTime_ : now();
 	std::time_t const oldHighdays = ((unixtime - baseTime_) / 86400) & 0x100;
 	baseTime_ += oldHighdays * 86400;
 	baseTime_ -= ((newDh & 0x1) << 8) * 86400;
 
 	if ((dataDh_ ^ newDh) & 0x40) {
 		if (newDh & 0x40)
-			haltTime_ = std::time(0);
+			haltTime_ = now();
 		else
-			baseTime_ += std::time(0) - haltTime_;
+			baseTime_ += now() - haltTime_;
 	}
 }
 
 void Rtc::setDl(unsigned const newLowdays) {
-	std::time_t const unixtime = dataDh_ & 0x40 ? haltTime_ : std::time(0);
+	std::time_t const unixtime = dataDh_ & 0x40 ? haltTime_ : now();
 	std::time_t const oldLowdays = ((unixtime - baseTime_) / 86400) & 0xFF;
 	baseTime_ += oldLowdays * 86400;
 	baseTime_ -= newLowdays * 86400;
 }
 
 void Rtc::setH(unsigned const newHours) {
-	std::time_t const unixtime = dataDh_ & 0x40 ? haltTime_ : std::time(0);
+	std::time_t const unixtime = dataDh_ & 0x40 ? haltTime_ : now();
 	std::time_t const oldHours = ((unixtime - baseTime_) / 3600) % 24;
 	baseTime_ += oldHours * 3600;
 	baseTime_ -= newHours * 3600;
 }
 
 void Rtc::setM(unsigned const newMinutes) {
-	std::time_t const unixtime = dataDh_ & 0x40 ? haltTime_ : std::time(0);
+	std::time_t const unixtime = dataDh_ & 0x40 ? haltTime_ : now();
 	std::time_t const oldMinutes = ((unixtime - baseTime_) / 60) % 60;
 	baseTime_ += oldMinutes * 60;
 	baseTime_ -= newMinutes * 60;
 }
 
 void Rtc::setS(unsigned const newSeconds) {
-	std::time_t const unixtime = dataDh_ & 0x40 ? haltTime_ : std::time(0);
+	std::time_t const unixtime = dataDh_ & 0x40 ? haltTime_ : now();
 	baseTime_ += (unixtime - baseTime_) % 60;
 	baseTime_ -= newSeconds;
 }
@@ -42,6 +42,28 @@ public:
 	void saveState(SaveState &state) const;
 	void loadState(SaveState const &state);
 
+	// Whether the clock runs on emulated time, which update advances, rather than
+	// the host's clock.
+	void setUseEmulatedTime(bool enable) { useEmulatedTime_ = enable; }
+
+	// Advances emulated time to cycle counter cc, which has run at double speed
+	// since the last update if ds. cc runs at 2^22 Hz at normal speed.
+	void update(unsigned long const cc, bool const ds) {
+		unsigned long const cycles = cc - lastUpdateCc_;
+		lastUpdateCc_ = cc;
+		emulatedTime_ += cycles >> (22 + ds);
+		emulatedTicks_ += (cycles << !ds) & (ticks_per_second - 1);
+		if (emulatedTicks_ >= ticks_per_second) {
+			emulatedTicks_ -= ticks_per_second;
+			++emulatedTime_;
+		}
+	}
+
+	void resetCc(unsigned long const oldCc, unsigned long const newCc, bool const ds) {
+		update(oldCc, ds);
+		lastUpdateCc_ = newCc;
+	}
+
 	void set(bool enabled, unsigned bank) {
 		bank &= 0xF;
 		bank -= 8;
@@ -57,10 +79,15 @@ public:
 	}
 
 private:
+	enum { ticks_per_second = 0x800000 };
+
 	unsigned char *activeData_;
 	void (Rtc::*activeSet_)(unsigned);
 	std::time_t baseTime_;
 	std::time_t haltTime_;
+	std::time_t emulatedTime_;
+	unsigned long emulatedTicks_;
+	unsigned long lastUpdateCc_;
 	unsigned char index_;
 	unsigned char dataDh_;
 	unsigned char dataDl_;
@@ -69,7 +96,9 @@ private:
 	unsigned char dataS_;
 	bool enabled_;
 	bool lastLatchData_;
+	bool useEmulatedTime_;
 
+	std::time_t now() const { return useEmulatedTime_ ? emulatedTime_ : std::time(0); }
 	void doLatch();
 	void doSwapActive();
 	void setDh(unsigned newDh);
@@ -42,6 +42,10 @@ int serialCntFrom(unsigned long cyclesUntilDone, bool cgbFast) {
 
 Memory::Memory(Interrupter const &interrupter)
 : getInput_(0)
+, inputTimelineNext_(0)
+, inputTimelineEnd_(0)
+, inputTimelineFrame_(0)
+, inputButtons_(0)
 , divLastUpdate_(0)
 , lastOamDmaUpdate_(disabled_time)
 , lcd_(ioamhram_, 0, VideoInterruptRequester(intreq_))
@@ -56,6 +60,11 @@ Memory::Memory(Interrupter const &interrupter)
 	intreq_.setEventTime<intevent_end>(0);
 }
 
+Memory::~Memory() {
+	delete gbBootRom_;
+	delete gbcBootRom_;
+}
+
 void Memory::setStatePtrs(SaveState &state) {
 	state.mem.ioamhram.set(ioamhram_, sizeof ioamhram_);
 
@@ -131,6 +140,8 @@ void Memory::loadState(SaveState const &state) {
 
 	if (!isCgb())
 		std::fill_n(cart_.vramdata() + vrambank_size(), vrambank_size(), 0);
+
+	cart_.markAllDirty();
 }
 
 void Memory::setEndtime(unsigned long cc, unsigned long inc) {
@@ -196,6 +207,9 @@ unsigned long Memory::event(unsigned long cc) {
 
 			if (lcden | blanklcd_) {
 				lcd_.updateScreen(blanklcd_, cc);
+				if (!getInput_)
+					advanceInputTimeline();
+
 				intreq_.setEventTime<intevent_blit>(disabled_time);
 				intreq_.setEventTime<intevent_end>(disabled_time);
 
@@ -353,6 +367,7 @@ unsigned long Memory::stop(unsigned long cc) {
 		// should keep the number of audio samples produced consistent with
 		// the number of video frames completed (less the 4-cycle skip).
 		psg_.generateSamples(cc_, isDoubleSpeed());
+		cart_.updateRtc(cc_, isDoubleSpeed());
 		lcd_.speedChange(cc_);
 		ioamhram_[0x14D] ^= 0x81;
 		// TODO: perhaps make this a bit nicer?
@@ -411,14 +426,35 @@ unsigned long Memory::resetCounters(unsigned long cc) {
 	tima_.resetCc(oldCC, cc, TimaInterruptRequester(intreq_));
 	lcd_.resetCc(oldCC, cc);
 	psg_.resetCounter(cc, oldCC, isDoubleSpeed());
+	cart_.resetRtcCc(oldCC, cc, isDoubleSpeed());
 	return cc;
 }
 
+void Memory::setInputTimeline(InputChange const *const begin, InputChange const *const end,
+		unsigned long const frame) {
+	inputTimelineNext_ = begin;
+	inputTimelineEnd_ = end;
+	inputTimelineFrame_ = frame;
+	inputButtons_ = 0;
+	for (; inputTimelineNext_ != end && inputTimelineNext_->frame <= frame; ++inputTimelineNext_)
+		inputButtons_ = inputTimelineNext_->buttons;
+}
+
+void Memory::advanceInputTimeline() {
+	++inputTimelineFrame_;
+	for (; inputTimelineNext_ != inputTimelineEnd_
+			&& inputTimelineNext_->frame <= inputTimelineFrame_; ++inputTimelineNext_) {
+		inputButtons_ = inputTimelineNext_->buttons;
+	}
+}
+
+// Input comes from the input getter if there is one, and otherwise from the
+// timeline, which holds no buttons when empty.
 void Memory::updateInput() {
 	unsigned state = 0xF;
 
-	if ((ioamhram_[0x100] & 0x30) != 0x30 && getInput_) {
-		unsigned input = (*getInput_)();
+	if ((ioamhram_[0x100] & 0x30) != 0x30) {
+		unsigned input = getInput_ ? (*getInput_)() : inputButtons_;
 		unsigned dpad_state = ~input >> 4;
 		unsigned button_state = ~input;
 		if (!(ioamhram_[0x100] & 0x10))
@@ -1044,8 +1080,11 @@ void Memory::nontrivial_write(unsigned const p, unsigned const data, unsigned lo
 			if (isCgb()) {
 				if (p < mm_wram_begin)
 					ioamhram_[oamDmaPos_] = cart_.oamDmaSrc() != oam_dma_src_vram ? data : 0;
-				else if (cart_.oamDmaSrc() != oam_dma_src_wram)
-					cart_.wramdata(ioamhram_[0x146] >> 4 & 1)[p & 0xFFF] = data;
+				else if (cart_.oamDmaSrc() != oam_dma_src_wram) {
+					unsigned char *const dst = cart_.wramdata(ioamhram_[0x146] >> 4 & 1) + (p & 0xFFF);
+					*dst = data;
+					cart_.markDirty(dst);
+				}
 			} else {
 				ioamhram_[oamDmaPos_] = cart_.oamDmaSrc() == oam_dma_src_wram
 					? ioamhram_[oamDmaPos_] & data
@@ -1059,18 +1098,27 @@ void Memory::nontrivial_write(unsigned const p, unsigned const data, unsigned lo
 	if (p < mm_oam_begin) {
 		if (p < mm_sram_begin) {
 			if (p < mm_vram_begin) {
+				// latching the RTC reads the time.
+				cart_.updateRtc(cc, isDoubleSpeed());
 				cart_.mbcWrite(p, data);
 			} else if (lcd_.vramAccessible(cc)) {
 				lcd_.vramChange(cc);
 				cart_.vrambankptr()[p] = data;
+				cart_.markDirty(cart_.vrambankptr() + p);
 			}
 		} else if (p < mm_wram_begin) {
-			if (cart_.wsrambankptr())
+			if (cart_.wsrambankptr()) {
 				cart_.wsrambankptr()[p] = data;
-			else
+				cart_.markDirty(cart_.wsrambankptr() + p);
+			} else {
+				cart_.updateRtc(cc, isDoubleSpeed());
 				cart_.rtcWrite(data);
-		} else
-			cart_.wramdata(p >> 12 & 1)[p & 0xFFF] = data;
+			}
+		} else {
+			unsigned char *const dst = cart_.wramdata(p >> 12 & 1) + (p & 0xFFF);
+			*dst = data;
+			cart_.markDirty(dst);
+		}
 	} else if (p - mm_hram_begin >= 0x7Fu) {
 		long const ffp = static_cast<long>(p) - mm_io_begin;
 		if (ffp < 0) {
@@ -1085,8 +1133,59 @@ void Memory::nontrivial_write(unsigned const p, unsigned const data, unsigned lo
 		ioamhram_[p - mm_oam_begin] = data;
 }
 
-LoadRes Memory::loadROM(std::string const &romfile, bool const forceDmg, bool const multicartCompat) {
-	if (LoadRes const fail = cart_.loadROM(romfile, forceDmg, multicartCompat))
+MemoryView Memory::memoryView(GB::MemoryArea const area) const {
+	MemoryView view = { 0, 0, 0, -1 };
+	if (!loaded())
+		return view;
+
+	MemPtrs const &mp = cart_.memptrs();
+	switch (area) {
+	case GB::WRAM:
+		view.data = mp.wramdata(0);
+		view.size = mp.wramdataend() - mp.wramdata(0);
+		view.bankSize = wrambank_size();
+		view.bank = (mp.wramdata(1) - mp.wramdata(0)) / wrambank_size();
+		break;
+	case GB::VRAM:
+		// There is room for two banks either way, DMG only ever uses the first.
+		view.data = mp.vramdata();
+		view.size = (cart_.isCgb() ? 2 : 1) * vrambank_size();
+		view.bankSize = vrambank_size();
+		view.bank = (mp.vrambankptr() + mm_vram_begin - mp.vramdata()) / vrambank_size();
+		break;
+	case GB::SRAM:
+		if (mp.rambankdata() != mp.rambankdataend()) {
+			view.data = mp.rambankdata();
+			view.size = mp.rambankdataend() - mp.rambankdata();
+			view.bankSize = rambank_size();
+			// The RTC has no pointer, and disabled RAM reads from outside of the banks.
+			if (unsigned char const *const mapped = mp.rsrambankptr()) {
+				if (mapped + mm_sram_begin >= mp.rambankdata()
+						&& mapped + mm_sram_begin < mp.rambankdataend()) {
+					view.bank = (mapped + mm_sram_begin - mp.rambankdata()) / rambank_size();
+				}
+			}
+		}
+
+		break;
+	case GB::OAM:
+		view.data = ioamhram_;
+		view.size = view.bankSize = 0xA0;
+		view.bank = 0;
+		break;
+	case GB::HRAM:
+		view.data = ioamhram_ + (mm_hram_begin - mm_oam_begin);
+		view.size = view.bankSize = 0x7F;
+		view.bank = 0;
+		break;
+	}
+
+	return view;
+}
+
+LoadRes Memory::loadROM(std::string const &romfile, bool const forceDmg, bool const multicartCompat,
+		bool const reuseRom) {
+	if (LoadRes const fail = cart_.loadROM(romfile, forceDmg, multicartCompat, reuseRom))
 		return fail;
 
 	updateCgb();
@@ -1095,6 +1194,19 @@ LoadRes Memory::loadROM(std::string const &romfile, bool const forceDmg, bool co
 	return LOADRES_OK;
 }
 
+void Memory::loadROM(Memory const &other, bool const multicartCompat) {
+	cart_.loadROM(other.cart_, multicartCompat);
+	updateCgb();
+	interrupter_.setGameShark(other.interrupter_);
+	lcd_.setDmgPalettes(other.lcd_);
+	getInput_ = other.getInput_;
+
+	delete gbBootRom_;
+	delete gbcBootRom_;
+	gbBootRom_ = other.gbBootRom_ ? new GBBootRom(*other.gbBootRom_) : nullptr;
+	gbcBootRom_ = other.gbcBootRom_ ? new GBCBootRom(*other.gbcBootRom_) : nullptr;
+}
+
 void Memory::updateCgb() {
 	psg_.init(cart_.isCgb());
 	lcd_.reset(ioamhram_, cart_.vramdata(), cart_.isCgb());
@@ -21,6 +21,7 @@
 
 #include "mem/cartridge.h"
 #include "mem/bootrom.h"
+#include "gambatte.h"
 #include "interrupter.h"
 #include "pakinfo.h"
 #include "sound.h"
@@ -35,9 +36,11 @@ class FilterInfo;
 class Memory {
 public:
 	explicit Memory(Interrupter const &interrupter);
+	~Memory();
 	bool loaded() const { return cart_.loaded(); }
 	char const * romTitle() const { return cart_.romTitle(); }
 	PakInfo const pakInfo(bool multicartCompat) const { return cart_.pakInfo(multicartCompat); }
+	uint_least64_t romHash() const { return cart_.romHash(); }
 	void setStatePtrs(SaveState &state);
 	unsigned long saveState(SaveState &state, unsigned long cc);
 	void loadState(SaveState const &state);
@@ -51,6 +54,9 @@ public:
 	bool halted() const { return intreq_.halted(); }
 	unsigned long nextEventTime() const { return intreq_.minEventTime(); }
 	bool isActive() const { return intreq_.eventTime(intevent_end) != disabled_time; }
+	void cancelEndtime() { intreq_.setEventTime<intevent_end>(disabled_time); }
+	bool isDoubleSpeed() const { return lcd_.isDoubleSpeed(); }
+	unsigned lyReg(unsigned long cc) { return lcd_.getLyReg(cc); }
 
 	long cyclesSinceBlit(unsigned long cc) const {
 		if (cc < intreq_.eventTime(intevent_blit))
@@ -78,6 +84,26 @@ public:
         return cart_.rmem(p >> 12) ? cart_.rmem(p >> 12)[p] : nontrivial_read(p, cc);
 	}
 
+	// What the CPU would read at p, from the cartridge rather than any boot ROM and
+	// regardless of whether the PPU or OAM DMA blocks access, without side effects.
+	// I/O registers read as stored.
+	unsigned peek(unsigned p) const {
+		if (cart_.rmem(p >> 12))
+			return cart_.rmem(p >> 12)[p];
+		if (p < mm_vram_begin)
+			return cart_.romdata(p >> 14)[p];
+		if (p < mm_sram_begin)
+			return cart_.vrambankptr()[p];
+		if (p < mm_wram_begin)
+			return cart_.rsrambankptr() ? cart_.rsrambankptr()[p] : cart_.rtcRead();
+		if (p < mm_oam_begin)
+			return cart_.wramdata(p >> 12 & 1)[p & 0xFFF];
+
+		return ioamhram_[p - mm_oam_begin];
+	}
+
+	MemoryView memoryView(GB::MemoryArea area) const;
+
 	void write(unsigned p, unsigned data, unsigned long cc) {
 		if (cart_.wmem(p >> 12)) {
 			cart_.wmem(p >> 12)[p] = data;
@@ -94,9 +120,23 @@ public:
 
 	unsigned long event(unsigned long cycleCounter);
 	unsigned long resetCounters(unsigned long cycleCounter);
-	LoadRes loadROM(std::string const &romfile, bool forceDmg, bool multicartCompat);
+	LoadRes loadROM(std::string const &romfile, bool forceDmg, bool multicartCompat, bool reuseRom);
+	// Loads the ROM image other has loaded, sharing its ROM data, and takes over its
+	// settings: save paths, cheats, boot ROMs, DMG palettes and input getter.
+	void loadROM(Memory const &other, bool multicartCompat);
 	void setSaveDir(std::string const &dir) { cart_.setSaveDir(dir); }
-	void setInputGetter(InputGetter *getInput) { getInput_ = getInput; }
+	void setRtcUseEmulatedTime(bool enable) { cart_.setRtcUseEmulatedTime(enable); }
+	void setWriteTracking(bool enable) { cart_.setWriteTracking(enable); }
+	void clearDirty() { cart_.clearDirty(); }
+	unsigned char const * dirtyPages() const { return cart_.dirtyPages(); }
+	std::size_t numPages() const { return cart_.numPages(); }
+	void setInputGetter(InputGetter *getInput) {
+		getInput_ = getInput;
+		setInputTimeline(0, 0, 0);
+	}
+
+	void setInputTimeline(InputChange const *begin, InputChange const *end, unsigned long frame);
+	unsigned long inputTimelineFrame() const { return inputTimelineFrame_; }
 	void setEndtime(unsigned long cc, unsigned long inc);
 	void setSoundBuffer(uint_least32_t *buf) { psg_.setBuffer(buf); }
 	std::size_t fillSoundBuffer(unsigned long cc);
@@ -144,6 +184,13 @@ private:
 	Cartridge cart_;
 	unsigned char ioamhram_[0x200];
 	InputGetter *getInput_;
+	// Without an input getter, input comes from a timeline of changes, with
+	// inputTimelineNext_ the first change after inputTimelineFrame_. Blits
+	// count frames.
+	InputChange const *inputTimelineNext_;
+	InputChange const *inputTimelineEnd_;
+	unsigned long inputTimelineFrame_;
+	unsigned inputButtons_;
 	unsigned long divLastUpdate_;
 	unsigned long lastOamDmaUpdate_;
 	InterruptRequester intreq_;
@@ -170,9 +217,9 @@ private:
 	void nontrivial_ff_write(unsigned p, unsigned data, unsigned long cycleCounter);
 	void nontrivial_write(unsigned p, unsigned data, unsigned long cycleCounter);
 	void updateSerial(unsigned long cc);
+	void advanceInputTimeline();
 	void updateTimaIrq(unsigned long cc);
 	void updateIrqs(unsigned long cc);
-	bool isDoubleSpeed() const { return lcd_.isDoubleSpeed(); }
 	void updateCgb();
 
 	BootRom *getBootRom() {
@@ -0,0 +1,230 @@
+//
+//   Copyright (C) 2026 by the Gambatte contributors
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License version 2 for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   version 2 along with this program; if not, write to the
+//   Free Software Foundation, Inc.,
+//   51 Franklin St, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+
+#include "rewinder.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// Shorter runs of equal bytes are kept in the literal, where they cost less than
+// the two run lengths needed to skip them.
+enum { min_skip_run = 4 };
+
+void putLength(std::vector<unsigned char> &out, std::size_t n) {
+	while (n >= 0x80) {
+		out.push_back((n & 0x7F) | 0x80);
+		n >>= 7;
+	}
+
+	out.push_back(n);
+}
+
+std::size_t getLength(unsigned char const *&in) {
+	std::size_t n = 0;
+	for (unsigned shift = 0;; shift += 7) {
+		unsigned char const c = *in++;
+		n |= std::size_t(c & 0x7F) << shift;
+		if (!(c & 0x80))
+			return n;
+	}
+}
+
+// What a snapshot is encoded relative to: the snapshot before it, or all zeros
+// for a keyframe.
+class PrevSnapshot {
+public:
+	explicit PrevSnapshot(char const *p) : p_(p) {}
+	char diff(char const *cur, std::size_t i) const { return cur[i] ^ p_[i]; }
+	unsigned long diffWord(char const *cur, std::size_t i) const {
+		unsigned long c, p;
+		std::memcpy(&c, cur + i, sizeof c);
+		std::memcpy(&p, p_ + i, sizeof p);
+		return c ^ p;
+	}
+
+private:
+	char const *p_;
+};
+
+struct Zeros {
+	char diff(char const *cur, std::size_t i) const { return cur[i]; }
+	unsigned long diffWord(char const *cur, std::size_t i) const {
+		unsigned long c;
+		std::memcpy(&c, cur + i, sizeof c);
+		return c;
+	}
+};
+
+template<class Base>
+std::size_t skipEqual(char const *cur, Base const &base, std::size_t i, std::size_t size) {
+	while (size - i >= sizeof(unsigned long) && !base.diffWord(cur, i))
+		i += sizeof(unsigned long);
+	while (i < size && !base.diff(cur, i))
+		++i;
+
+	return i;
+}
+
+// Encodes the XOR of cur and base as the state size followed by
+// (equal run length, literal length, literal bytes) triples.
+template<class Base>
+void encode(std::vector<unsigned char> &out,
+		char const *const cur, Base const &base, std::size_t const size) {
+	out.clear();
+	putLength(out, size);
+
+	std::size_t pos = 0;
+	for (;;) {
+		std::size_t const litBegin = skipEqual(cur, base, pos, size);
+		if (litBegin == size)
+			break;
+
+		std::size_t litEnd = litBegin + 1;
+		for (std::size_t i = litEnd; i < size && i - litEnd < min_skip_run; ++i) {
+			if (base.diff(cur, i))
+				litEnd = i + 1;
+		}
+
+		putLength(out, litBegin - pos);
+		putLength(out, litEnd - litBegin);
+		std::size_t const outpos = out.size();
+		out.resize(outpos + (litEnd - litBegin));
+		for (std::size_t i = litBegin; i < litEnd; ++i)
+			out[outpos + (i - litBegin)] = base.diff(cur, i);
+
+		pos = litEnd;
+	}
+}
+
+// XORs encoded data into state, which must be zero-filled for a keyframe.
+void decode(std::vector<unsigned char> const &data, std::vector<char> &state) {
+	unsigned char const *in = &data[0];
+	unsigned char const *const end = in + data.size();
+	state.resize(getLength(in));
+
+	std::size_t pos = 0;
+	while (in != end) {
+		pos += getLength(in);
+		std::size_t const len = getLength(in);
+		for (std::size_t i = 0; i < len; ++i)
+			state[pos + i] ^= in[i];
+
+		in += len;
+		pos += len;
+	}
+}
+
+} // anon namespace
+
+namespace gambatte {
+
+Rewinder::Rewinder()
+: maxBytes_(0)
+, bytesUsed_(0)
+, keyframes_(0)
+, keyframeInterval_(1)
+, sinceKeyframe_(0)
+{
+}
+
+void Rewinder::reset(std::size_t maxBytes, unsigned keyframeInterval) {
+	maxBytes_ = maxBytes;
+	keyframeInterval_ = std::max(keyframeInterval, 1u);
+	clear();
+}
+
+void Rewinder::clear() {
+	snapshots_.clear();
+	bytesUsed_ = 0;
+	keyframes_ = 0;
+	sinceKeyframe_ = 0;
+}
+
+void Rewinder::push(std::vector<char> const &state) {
+	if (!maxBytes_ || state.empty())
+		return;
+
+	bool const keyframe = snapshots_.empty()
+	                   || sinceKeyframe_ >= keyframeInterval_
+	                   || state.size() != newest_.size();
+	if (keyframe)
+		encode(scratch_, &state[0], Zeros(), state.size());
+	else
+		encode(scratch_, &state[0], PrevSnapshot(&newest_[0]), state.size());
+
+	snapshots_.push_back(Snapshot());
+	snapshots_.back().data.assign(scratch_.begin(), scratch_.end());
+	snapshots_.back().keyframe = keyframe;
+	newest_ = state;
+	bytesUsed_ += scratch_.size();
+	keyframes_ += keyframe;
+	sinceKeyframe_ = keyframe ? 1 : sinceKeyframe_ + 1;
+
+	while (bytesUsed_ > maxBytes_ && keyframes_ > 1)
+		dropOldest();
+
+	// If the newest keyframe interval alone is too big, start a new one so that
+	// the old one can be dropped.
+	if (bytesUsed_ > maxBytes_)
+		sinceKeyframe_ = keyframeInterval_;
+}
+
+bool Rewinder::pop(std::vector<char> &state) {
+	if (snapshots_.empty())
+		return false;
+
+	state = newest_;
+
+	Snapshot &s = snapshots_.back();
+	bytesUsed_ -= s.data.size();
+	if (s.keyframe) {
+		std::size_t const end = snapshots_.size() - 1;
+		std::size_t keyframe = end;
+		while (keyframe && !snapshots_[--keyframe].keyframe) {}
+
+		if (keyframe < end)
+			decodeNewestFrom(keyframe, end);
+
+		sinceKeyframe_ = end - keyframe;
+		--keyframes_;
+	} else {
+		decode(s.data, newest_);
+		--sinceKeyframe_;
+	}
+
+	snapshots_.pop_back();
+	return true;
+}
+
+void Rewinder::dropOldest() {
+	do {
+		bytesUsed_ -= snapshots_.front().data.size();
+		snapshots_.pop_front();
+	} while (!snapshots_.front().keyframe);
+
+	--keyframes_;
+}
+
+void Rewinder::decodeNewestFrom(std::size_t const keyframe, std::size_t const end) {
+	std::fill(newest_.begin(), newest_.end(), 0);
+	for (std::size_t i = keyframe; i < end; ++i)
+		decode(snapshots_[i].data, newest_);
+}
+
+}
@@ -0,0 +1,82 @@
+//
+//   Copyright (C) 2026 by the Gambatte contributors
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License version 2 for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   version 2 along with this program; if not, write to the
+//   Free Software Foundation, Inc.,
+//   51 Franklin St, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+
+#ifndef REWINDER_H
+#define REWINDER_H
+
+#include "uncopyable.h"
+#include <cstddef>
+#include <deque>
+#include <vector>
+
+namespace gambatte {
+
+/**
+  * Bounded history of state snapshots, newest last. Every keyframeInterval'th
+  * snapshot is a keyframe, stored on its own. The others are stored as the
+  * difference (XOR) to the snapshot before them. Both are run-length encoded
+  * with respect to zero bytes, so unchanged memory costs next to nothing.
+  *
+  * Popping XORs the newest difference out of a decoded copy of the newest
+  * snapshot. Only popping a keyframe requires decoding forward from the keyframe
+  * before it. The oldest keyframe interval is dropped as a whole when maxBytes is
+  * exceeded.
+  */
+class Rewinder : Uncopyable {
+public:
+	Rewinder();
+
+	/** Sets limits and clears. maxBytes 0 disables pushing. */
+	void reset(std::size_t maxBytes, unsigned keyframeInterval);
+	void clear();
+
+	/** Stores state as the newest snapshot, dropping old ones to stay within maxBytes. */
+	void push(std::vector<char> const &state);
+
+	/**
+	  * Replaces state with the newest snapshot and removes it.
+	  * @return false if there are no snapshots
+	  */
+	bool pop(std::vector<char> &state);
+
+	std::size_t size() const { return snapshots_.size(); }
+	std::size_t bytesUsed() const { return bytesUsed_; }
+	std::size_t bytesLimit() const { return maxBytes_; }
+
+private:
+	struct Snapshot {
+		std::vector<unsigned char> data;
+		bool keyframe;
+	};
+
+	std::deque<Snapshot> snapshots_;
+	std::vector<char> newest_;
+	std::vector<unsigned char> scratch_;
+	std::size_t maxBytes_;
+	std::size_t bytesUsed_;
+	std::size_t keyframes_;
+	unsigned keyframeInterval_;
+	unsigned sinceKeyframe_;
+
+	void dropOldest();
+	void decodeNewestFrom(std::size_t keyframe, std::size_t end);
+};
+
+}
+
+#endif
@@ -187,6 +187,8 @@ struct SaveState {
 	struct RTC {
 		unsigned long baseTime;
 		unsigned long haltTime;
+		unsigned long emulatedTime;
+		unsigned long emulatedTicks;
 		unsigned char dataDh;
 		unsigned char dataDl;
 		unsigned char dataH;
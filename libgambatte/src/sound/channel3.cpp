@@ -142,11 +142,26 @@ void Channel3::updateWaveCounter(unsigned long const cc) {
 	}
 }
 
+// Whether the playing sample and all of wave RAM give the same output level, in which
+// case wave position updates do not affect the output and can be done in bulk.
+bool Channel3::isWaveFlat() const {
+	unsigned const level = ((wavePos_ & 1 ? sampleBuf_ : sampleBuf_ >> 4) & 0xF) >> rshift_;
+	for (std::size_t i = 0; i < sizeof waveRam_; ++i) {
+		if (unsigned(waveRam_[i] >> 4) >> rshift_ != level
+				|| unsigned(waveRam_[i] & 0xF) >> rshift_ != level) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
 void Channel3::update(uint_least32_t *buf, unsigned long const soBaseVol, unsigned long cycles) {
 	unsigned long const outBase = nr0_/* & 0x80*/ ? soBaseVol & soMask_ : 0;
 
 	if (outBase && rshift_ != 4) {
 		unsigned long const endCycles = cycleCounter_ + cycles;
+		bool const flat = master_ && isWaveFlat();
 
 		for (;;) {
 			unsigned long const nextMajorEvent =
@@ -156,6 +171,9 @@ void Channel3::update(uint_least32_t *buf, unsigned long const soBaseVol, unsign
 				: 0 - 15ul;
 			out *= outBase;
 
+			if (flat)
+				updateWaveCounter(nextMajorEvent);
+
 			while (waveCounter_ <= nextMajorEvent) {
 				*buf += out - prevOut_;
 				prevOut_ = out;
@@ -98,6 +98,7 @@ private:
 	bool cgb_;
 
 	void updateWaveCounter(unsigned long cc);
+	bool isWaveFlat() const;
 };
 
 }
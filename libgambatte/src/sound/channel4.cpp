@@ -42,31 +42,34 @@ Channel4::Lfsr::Lfsr()
 {
 }
 
+void Channel4::Lfsr::shift(unsigned long periods) {
+	if (nr3_ & 8) {
+		while (periods > 6) {
+			unsigned const xored = (reg_ << 1 ^ reg_) & 0x7E;
+			reg_ = (reg_ >> 6 & ~0x7Eu) | xored | xored << 8;
+			periods -= 6;
+		}
+
+		unsigned const xored = ((reg_ ^ reg_ >> 1) << (7 - periods)) & 0x7F;
+		reg_ = (reg_ >> periods & ~(0x80u - (0x80 >> periods))) | xored | xored << 8;
+	} else {
+		while (periods > 15) {
+			reg_ = reg_ ^ reg_ >> 1;
+			periods -= 15;
+		}
+
+		reg_ = reg_ >> periods | (((reg_ ^ reg_ >> 1) << (15 - periods)) & 0x7FFF);
+	}
+}
+
 void Channel4::Lfsr::updateBackupCounter(unsigned long const cc) {
 	if (backupCounter_ <= cc) {
 		unsigned long const period = toPeriod(nr3_);
 		unsigned long periods = (cc - backupCounter_) / period + 1;
 		backupCounter_ += periods * period;
 
-		if (master_ && nr3_ < 0xE0) {
-			if (nr3_ & 8) {
-				while (periods > 6) {
-					unsigned const xored = (reg_ << 1 ^ reg_) & 0x7E;
-					reg_ = (reg_ >> 6 & ~0x7Eu) | xored | xored << 8;
-					periods -= 6;
-				}
-
-				unsigned const xored = ((reg_ ^ reg_ >> 1) << (7 - periods)) & 0x7F;
-				reg_ = (reg_ >> periods & ~(0x80u - (0x80 >> periods))) | xored | xored << 8;
-			} else {
-				while (periods > 15) {
-					reg_ = reg_ ^ reg_ >> 1;
-					periods -= 15;
-				}
-
-				reg_ = reg_ >> periods | (((reg_ ^ reg_ >> 1) << (15 - periods)) & 0x7FFF);
-			}
-		}
+		if (master_ && nr3_ < 0xE0)
+			shift(periods);
 	}
 }
 
@@ -89,6 +92,30 @@ inline void Channel4::Lfsr::event() {
 	backupCounter_ = counter_;
 }
 
+// Runs the clocks up to and including cc that would not change the output level in one
+// go, leaving counter() at the first clock that does. The upcoming output levels are
+// the register bits above bit 0, of which the low 6 (7-bit mode) or 14 are known.
+void Channel4::Lfsr::skipStaticPeriods(unsigned long const cc) {
+	if (counter_ > cc)
+		return;
+
+	unsigned long const period = toPeriod(nr3_);
+	unsigned long periods = (cc - counter_) / period + 1;
+	if (nr3_ < 0xE0) {
+		unsigned const known = nr3_ & 8 ? 6 : 14;
+		unsigned const changes = (reg_ & 1 ? ~reg_ : reg_) >> 1;
+		unsigned run = 0;
+		while (run < known && !(changes >> run & 1))
+			++run;
+
+		periods = std::min<unsigned long>(periods, run);
+		shift(periods);
+	}
+
+	counter_ += periods * period;
+	backupCounter_ = counter_;
+}
+
 void Channel4::Lfsr::nr3Change(unsigned newNr3, unsigned long cc) {
 	updateBackupCounter(cc);
 	nr3_ = newNr3;
@@ -232,6 +259,7 @@ void Channel4::update(uint_least32_t *buf, unsigned long const soBaseVol, unsign
 			cycleCounter_ = lfsr_.counter();
 
 			lfsr_.event();
+			lfsr_.skipStaticPeriods(nextMajorEvent);
 			out = lfsr_.isHighState() ? outHigh : outLow;
 		}
 
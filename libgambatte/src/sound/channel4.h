@@ -58,6 +58,7 @@ private:
 		void disableMaster() { killCounter(); master_ = false; reg_ = 0x7FFF; }
 		void killCounter() { counter_ = counter_disabled; }
 		void reviveCounter(unsigned long cc);
+		void skipStaticPeriods(unsigned long cc);
 
 	private:
 		unsigned long backupCounter_;
@@ -66,6 +67,7 @@ private:
 		bool master_;
 
 		void updateBackupCounter(unsigned long cc);
+		void shift(unsigned long periods);
 	};
 
 	class Ch4MasterDisabler : public MasterDisabler {
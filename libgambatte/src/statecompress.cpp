@@ -0,0 +1,34 @@
+//
+//   Copyright (C) 2026 by the Gambatte contributors
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License version 2 for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   version 2 along with this program; if not, write to the
+//   Free Software Foundation, Inc.,
+//   51 Franklin St, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+
+#include "statecompress.h"
+
+// Used when built without zlib. States are written uncompressed, and
+// compressed ones cannot be loaded.
+
+namespace gambatte {
+
+bool compressState(std::vector<char> const &, std::vector<char> &) {
+	return false;
+}
+
+bool decompressState(std::vector<char> &data) {
+	return !isCompressedState(data);
+}
+
+}
@@ -0,0 +1,53 @@
+//
+//   Copyright (C) 2026 by the Gambatte contributors
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License version 2 for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   version 2 along with this program; if not, write to the
+//   Free Software Foundation, Inc.,
+//   51 Franklin St, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+
+#ifndef STATECOMPRESS_H
+#define STATECOMPRESS_H
+
+#include <vector>
+
+namespace gambatte {
+
+/**
+  * Compresses a state for writing to a state file, replacing the contents of
+  * out with a gzip stream of data. Only built with compression support if zlib
+  * is available (statecompress_zlib.cpp).
+  *
+  * @return false if data was not compressed and should be written as is
+  */
+bool compressState(std::vector<char> const &data, std::vector<char> &out);
+
+/**
+  * Decompresses a state read from a state file in place. Data not starting with
+  * the gzip magic bytes is assumed to be an uncompressed (legacy) state and is
+  * left as is.
+  *
+  * @return false if data is compressed and could not be decompressed
+  */
+bool decompressState(std::vector<char> &data);
+
+/** Returns true if data starts with the gzip magic bytes. */
+inline bool isCompressedState(std::vector<char> const &data) {
+	return data.size() >= 2
+	    && static_cast<unsigned char>(data[0]) == 0x1F
+	    && static_cast<unsigned char>(data[1]) == 0x8B;
+}
+
+}
+
+#endif
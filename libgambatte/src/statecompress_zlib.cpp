@@ -0,0 +1,110 @@
+//
+//   Copyright (C) 2026 by the Gambatte contributors
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License version 2 for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   version 2 along with this program; if not, write to the
+//   Free Software Foundation, Inc.,
+//   51 Franklin St, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+
+#include "statecompress.h"
+#include <algorithm>
+#include <zlib.h>
+
+namespace {
+
+// Fast over small: compression happens off the emulation thread, but states are
+// mostly zeros and repetitive tiles, which the fastest level already shrinks
+// several times over.
+enum { compression_level = Z_BEST_SPEED };
+
+// windowBits for deflateInit2 and inflateInit2 selecting a gzip wrapper, so that
+// compressed state files can be inspected with standard tools.
+enum { gzip_window_bits = 15 + 16 };
+
+// Larger than any state, with the largest cartridge RAM, by a wide margin.
+// Decompressing stops with an error past it rather than exhausting memory on a
+// corrupt or hostile state file.
+std::size_t const max_state_size = 8 * 1024 * 1024;
+
+} // anon namespace
+
+namespace gambatte {
+
+bool compressState(std::vector<char> const &data, std::vector<char> &out) {
+	z_stream zs = z_stream();
+	if (deflateInit2(&zs, compression_level, Z_DEFLATED, gzip_window_bits,
+			8, Z_DEFAULT_STRATEGY) != Z_OK) {
+		return false;
+	}
+
+	out.resize(deflateBound(&zs, data.size()));
+	zs.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data.empty() ? 0 : &data[0]));
+	zs.avail_in = data.size();
+	zs.next_out = reinterpret_cast<Bytef *>(&out[0]);
+	zs.avail_out = out.size();
+	int const result = deflate(&zs, Z_FINISH);
+	out.resize(zs.total_out);
+	deflateEnd(&zs);
+	return result == Z_STREAM_END;
+}
+
+bool decompressState(std::vector<char> &data) {
+	if (!isCompressedState(data))
+		return true;
+
+	z_stream zs = z_stream();
+	if (inflateInit2(&zs, gzip_window_bits) != Z_OK)
+		return false;
+
+	// The gzip trailer ends with the uncompressed size modulo 2^32, which is
+	// exact for anything the size of a state. It comes from the file, so it is
+	// only trusted as far as a plausible compression ratio, and the loop below
+	// grows the buffer if it was short.
+	std::size_t const n = data.size();
+	unsigned long const isize = n >= 4
+		? (data[n - 4] & 0xFFul)
+		| (data[n - 3] & 0xFFul) << 8
+		| (data[n - 2] & 0xFFul) << 16
+		| (data[n - 1] & 0xFFul) << 24
+		: 0;
+	std::vector<char> out(std::min<std::size_t>(
+		std::min<std::size_t>(isize, n * 64 + 0x1000), max_state_size));
+	zs.next_in = reinterpret_cast<Bytef *>(&data[0]);
+	zs.avail_in = n;
+
+	int result = Z_OK;
+	while (result == Z_OK) {
+		if (zs.total_out == out.size()) {
+			if (out.size() == max_state_size) {
+				result = Z_BUF_ERROR;
+				break;
+			}
+
+			out.resize(std::min(out.size() * 2 + 0x1000, max_state_size));
+		}
+
+		zs.next_out = reinterpret_cast<Bytef *>(&out[zs.total_out]);
+		zs.avail_out = out.size() - zs.total_out;
+		result = inflate(&zs, Z_NO_FLUSH);
+	}
+
+	out.resize(zs.total_out);
+	inflateEnd(&zs);
+	if (result != Z_STREAM_END)
+		return false;
+
+	data.swap(out);
+	return true;
+}
+
+}
@@ -0,0 +1,146 @@
+//
+//   Copyright (C) 2026 by the Gambatte contributors
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License version 2 for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   version 2 along with this program; if not, write to the
+//   Free Software Foundation, Inc.,
+//   51 Franklin St, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+
+#include "statefilewriter.h"
+#include "statecompress.h"
+#include <cstdio>
+
+namespace {
+
+bool writeFile(std::string const &filepath, std::vector<char> const &data) {
+	std::string const tmppath = filepath + ".tmp";
+	std::FILE *const file = std::fopen(tmppath.c_str(), "wb");
+	if (!file)
+		return false;
+
+	bool const written = std::fwrite(&data[0], 1, data.size(), file) == data.size();
+	if (std::fclose(file) != 0 || !written) {
+		std::remove(tmppath.c_str());
+		return false;
+	}
+
+#ifdef _WIN32
+	// rename does not replace existing files on Windows.
+	std::remove(filepath.c_str());
+#endif
+	if (std::rename(tmppath.c_str(), filepath.c_str()) != 0) {
+		std::remove(tmppath.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+} // anon namespace
+
+namespace gambatte {
+
+StateFileWriter::StateFileWriter()
+: busy_(false)
+, failed_(false)
+, quit_(false)
+{
+}
+
+StateFileWriter::~StateFileWriter() {
+	if (thread_.joinable()) {
+		{
+			std::lock_guard<std::mutex> lock(mut_);
+			quit_ = true;
+		}
+
+		cond_.notify_all();
+		thread_.join();
+	}
+}
+
+void StateFileWriter::write(std::string const &filepath, std::vector<char> &data,
+		bool const compress) {
+	{
+		std::lock_guard<std::mutex> lock(mut_);
+		jobs_.push_back(Job());
+		jobs_.back().filepath = filepath;
+		jobs_.back().data.swap(data);
+		jobs_.back().compress = compress;
+		data.swap(spare_);
+	}
+
+	// Started on first use, so that instances that never write a state file do
+	// not cost a thread.
+	if (!thread_.joinable())
+		thread_ = std::thread(&StateFileWriter::run, this);
+
+	cond_.notify_all();
+}
+
+void StateFileWriter::wait() {
+	std::unique_lock<std::mutex> lock(mut_);
+	while (busy_ || !jobs_.empty())
+		cond_.wait(lock);
+}
+
+bool StateFileWriter::flush() {
+	std::unique_lock<std::mutex> lock(mut_);
+	while (busy_ || !jobs_.empty())
+		cond_.wait(lock);
+
+	bool const ok = !failed_;
+	failed_ = false;
+	return ok;
+}
+
+bool StateFileWriter::poll() {
+	std::lock_guard<std::mutex> lock(mut_);
+	bool const ok = !failed_;
+	failed_ = false;
+	return ok;
+}
+
+void StateFileWriter::run() {
+	std::unique_lock<std::mutex> lock(mut_);
+	for (;;) {
+		while (jobs_.empty() && !quit_)
+			cond_.wait(lock);
+
+		// Queued writes are finished before quitting.
+		if (jobs_.empty())
+			return;
+
+		Job job;
+		job.filepath.swap(jobs_.front().filepath);
+		job.data.swap(jobs_.front().data);
+		job.compress = jobs_.front().compress;
+		jobs_.pop_front();
+		busy_ = true;
+		lock.unlock();
+
+		bool const ok = job.compress && compressState(job.data, compressed_)
+		              ? writeFile(job.filepath, compressed_)
+		              : writeFile(job.filepath, job.data);
+
+		lock.lock();
+		if (job.data.capacity() > spare_.capacity())
+			spare_.swap(job.data);
+
+		busy_ = false;
+		failed_ |= !ok;
+		cond_.notify_all();
+	}
+}
+
+}
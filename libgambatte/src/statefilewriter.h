@@ -0,0 +1,90 @@
+//
+//   Copyright (C) 2026 by the Gambatte contributors
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License version 2 for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   version 2 along with this program; if not, write to the
+//   Free Software Foundation, Inc.,
+//   51 Franklin St, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+
+#ifndef STATEFILEWRITER_H
+#define STATEFILEWRITER_H
+
+#include "uncopyable.h"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace gambatte {
+
+/**
+  * Writes states to files on a background thread, so that saving a state only
+  * costs the emulation thread an in-memory capture. Each state is compressed
+  * (see compressState) and written to a temporary file, which is then renamed
+  * over the target. A state file is thus either the old one or the complete new
+  * one, even if the process dies mid-write. Files are written in queue order.
+  */
+class StateFileWriter : Uncopyable {
+public:
+	StateFileWriter();
+
+	/** Finishes all queued writes. */
+	~StateFileWriter();
+
+	/**
+	  * Queues data to be written to filepath. Takes the contents of data and
+	  * replaces them with a buffer from an earlier write, so that callers can
+	  * reuse data without allocating. Data is written as is if compress is false.
+	  */
+	void write(std::string const &filepath, std::vector<char> &data, bool compress = true);
+
+	/** Waits for all queued writes to finish. */
+	void wait();
+
+	/**
+	  * Like wait().
+	  * @return false if any write failed since the last call
+	  */
+	bool flush();
+
+	/**
+	  * Like flush(), but does not wait.
+	  * @return false if any write failed since the last call
+	  */
+	bool poll();
+
+private:
+	struct Job {
+		std::string filepath;
+		std::vector<char> data;
+		bool compress;
+	};
+
+	std::mutex mut_;
+	std::condition_variable cond_;
+	std::deque<Job> jobs_;
+	std::vector<char> spare_;
+	std::vector<char> compressed_;
+	std::thread thread_;
+	bool busy_;
+	bool failed_;
+	bool quit_;
+
+	void run();
+};
+
+}
+
+#endif
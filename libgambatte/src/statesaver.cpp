@@ -18,78 +18,136 @@
 
 #include "statesaver.h"
 #include "savestate.h"
-#include "array.h"
+#include "statecompress.h"
+#include "xxh64.h"
 #include <algorithm>
 #include <fstream>
 #include <functional>
+#include <ostream>
+#include <streambuf>
 #include <vector>
+#include <cassert>
+#include <cstddef>
 #include <cstring>
 
 namespace {
 
 using namespace gambatte;
 
+// Reads a labelled state from memory. Reading past the end gives zeros.
+class StateReader {
+public:
+	StateReader(char const *data, std::size_t size) : p_(data), end_(data + size) {}
+	bool atEnd() const { return p_ == end_; }
+	unsigned get() { return p_ != end_ ? *p_++ & 0xFF : 0; }
+	void ignore(std::size_t n) { p_ += std::min<std::size_t>(n, end_ - p_); }
+
+	void read(char *buf, std::size_t n) {
+		std::size_t const avail = std::min<std::size_t>(n, end_ - p_);
+		std::memcpy(buf, p_, avail);
+		std::memset(buf + avail, 0, n - avail);
+		p_ += avail;
+	}
+
+	// Returns the label at the current position and moves past it, or 0 if it is
+	// not terminated.
+	char const * label() {
+		char const *const label = p_;
+		void const *const nul = std::memchr(p_, 0, end_ - p_);
+		if (!nul)
+			return 0;
+
+		p_ = static_cast<char const *>(nul) + 1;
+		return label;
+	}
+
+private:
+	char const *p_;
+	char const *const end_;
+};
+
 struct Saver {
 	char const *label;
-	void (*save)(std::ofstream &file, SaveState const &state);
-	void (*load)(std::ifstream &file, SaveState &state);
+	void (*save)(std::ostream &file, SaveState const &state);
+	void (*load)(StateReader &file, SaveState &state);
 	std::size_t labelsize;
+	uint_least64_t key;
 };
 
+// The characters of a label of at most 7 characters packed into an integer, or
+// 0 for a longer label.
+uint_least64_t labelKey(char const *label) {
+	uint_least64_t key = 0;
+	for (int i = 0; i < 8; ++i) {
+		if (!label[i])
+			return key;
+
+		key = key << 8 | (label[i] & 0xFF);
+	}
+
+	return 0;
+}
+
 inline bool operator<(Saver const &l, Saver const &r) {
 	return std::strcmp(l.label, r.label) < 0;
 }
 
-void put24(std::ofstream &file, unsigned long data) {
+struct LabelEqual {
+	bool operator()(Saver const &l, Saver const &r) const {
+		return std::strcmp(l.label, r.label) == 0;
+	}
+};
+
+void put24(std::ostream &file, unsigned long data) {
 	file.put(data >> 16 & 0xFF);
 	file.put(data >>  8 & 0xFF);
 	file.put(data       & 0xFF);
 }
 
-void put32(std::ofstream &file, unsigned long data) {
+void put32(std::ostream &file, unsigned long data) {
 	file.put(data >> 24 & 0xFF);
 	file.put(data >> 16 & 0xFF);
 	file.put(data >>  8 & 0xFF);
 	file.put(data       & 0xFF);
 }
 
-void write(std::ofstream &file, unsigned char data) {
+void write(std::ostream &file, unsigned char data) {
 	static char const inf[] = { 0x00, 0x00, 0x01 };
 	file.write(inf, sizeof inf);
 	file.put(data & 0xFF);
 }
 
-void write(std::ofstream &file, unsigned short data) {
+void write(std::ostream &file, unsigned short data) {
 	static char const inf[] = { 0x00, 0x00, 0x02 };
 	file.write(inf, sizeof inf);
 	file.put(data >> 8 & 0xFF);
 	file.put(data      & 0xFF);
 }
 
-void write(std::ofstream &file, unsigned long data) {
+void write(std::ostream &file, unsigned long data) {
 	static char const inf[] = { 0x00, 0x00, 0x04 };
 	file.write(inf, sizeof inf);
 	put32(file, data);
 }
 
-void write(std::ofstream &file, unsigned char const *data, std::size_t size) {
+void write(std::ostream &file, unsigned char const *data, std::size_t size) {
 	put24(file, size);
 	file.write(reinterpret_cast<char const *>(data), size);
 }
 
-void write(std::ofstream &file, bool const *data, std::size_t size) {
+void write(std::ostream &file, bool const *data, std::size_t size) {
 	put24(file, size);
 	std::for_each(data, data + size,
-		std::bind1st(std::mem_fun(&std::ofstream::put), &file));
+		std::bind1st(std::mem_fun(&std::ostream::put), &file));
 }
 
-unsigned long get24(std::ifstream &file) {
-	unsigned long tmp = file.get() & 0xFF;
-	tmp =   tmp << 8 | (file.get() & 0xFF);
-	return  tmp << 8 | (file.get() & 0xFF);
+unsigned long get24(StateReader &file) {
+	unsigned long tmp = file.get();
+	tmp =   tmp << 8 | file.get();
+	return  tmp << 8 | file.get();
 }
 
-unsigned long read(std::ifstream &file) {
+unsigned long read(StateReader &file) {
 	unsigned long size = get24(file);
 	if (size > 4) {
 		file.ignore(size - 4);
@@ -98,35 +156,35 @@ unsigned long read(std::ifstream &file) {
 
 	unsigned long out = 0;
 	switch (size) {
-	case 4: out = (out | (file.get() & 0xFF)) << 8; // fall through.
-	case 3: out = (out | (file.get() & 0xFF)) << 8; // fall through.
-	case 2: out = (out | (file.get() & 0xFF)) << 8; // fall through.
-	case 1: out =  out | (file.get() & 0xFF);
+	case 4: out = (out | file.get()) << 8; // fall through.
+	case 3: out = (out | file.get()) << 8; // fall through.
+	case 2: out = (out | file.get()) << 8; // fall through.
+	case 1: out =  out | file.get();
 	}
 
 	return out;
 }
 
-inline void read(std::ifstream &file, unsigned char &data) {
+inline void read(StateReader &file, unsigned char &data) {
 	data = read(file) & 0xFF;
 }
 
-inline void read(std::ifstream &file, unsigned short &data) {
+inline void read(StateReader &file, unsigned short &data) {
 	data = read(file) & 0xFFFF;
 }
 
-inline void read(std::ifstream &file, unsigned long &data) {
+inline void read(StateReader &file, unsigned long &data) {
 	data = read(file);
 }
 
-void read(std::ifstream &file, unsigned char *buf, std::size_t bufsize) {
+void read(StateReader &file, unsigned char *buf, std::size_t bufsize) {
 	std::size_t const size = get24(file);
 	std::size_t const minsize = std::min(size, bufsize);
 	file.read(reinterpret_cast<char*>(buf), minsize);
 	file.ignore(size - minsize);
 }
 
-void read(std::ifstream &file, bool *buf, std::size_t bufsize) {
+void read(StateReader &file, bool *buf, std::size_t bufsize) {
 	std::size_t const size = get24(file);
 	std::size_t const minsize = std::min(size, bufsize);
 	for (std::size_t i = 0; i < minsize; ++i)
@@ -147,36 +205,66 @@ public:
 	SaverList();
 	const_iterator begin() const { return list.begin(); }
 	const_iterator end() const { return list.end(); }
-	std::size_t maxLabelsize() const { return maxLabelsize_; }
+
+	/** Returns the saver with the label packed into key, or end(). */
+	const_iterator find(uint_least64_t key) const {
+		if (!multiplier_) {
+			const_iterator it = begin();
+			while (it != end() && it->key != key)
+				++it;
+
+			return it;
+		}
+
+		const_iterator it = end();
+		if (unsigned char const index = table_[hash(key)])
+			it = begin() + (index - 1);
+
+		return it != end() && it->key == key ? it : end();
+	}
 
 private:
+	enum { table_bits = 12, max_multiplier_tries = 1000 };
 	list_t list;
-	std::size_t maxLabelsize_;
+	// 0 if no multiplier without collisions was found, and find() searches list.
+	uint_least64_t multiplier_;
+	// Index plus one of the saver each label key hashes to, without collisions.
+	unsigned char table_[1 << table_bits];
+
+	std::size_t hash(uint_least64_t key) const {
+		return (key * multiplier_ & 0xFFFFFFFFFFFFFFFFull) >> (64 - table_bits);
+	}
+
+	bool fillTable();
 };
 
 static void pushSaver(SaverList::list_t &list, char const *label,
-		void (*save)(std::ofstream &file, SaveState const &state),
-		void (*load)(std::ifstream &file, SaveState &state),
+		void (*save)(std::ostream &file, SaveState const &state),
+		void (*load)(StateReader &file, SaveState &state),
 		std::size_t labelsize) {
-	Saver saver = { label, save, load, labelsize };
+	Saver saver = { label, save, load, labelsize, labelKey(label) };
+	// The key lookup needs labels of at most 7 characters, and table_ holds
+	// indices plus one in an unsigned char.
+	assert(saver.key != 0);
+	assert(list.size() < 255);
 	list.push_back(saver);
 }
 
 SaverList::SaverList() {
 #define ADD(arg) do { \
 	struct Func { \
-		static void save(std::ofstream &file, SaveState const &state) { write(file, state.arg); } \
-		static void load(std::ifstream &file, SaveState &state) { read(file, state.arg); } \
+		static void save(std::ostream &file, SaveState const &state) { write(file, state.arg); } \
+		static void load(StateReader &file, SaveState &state) { read(file, state.arg); } \
 	}; \
 	pushSaver(list, label, Func::save, Func::load, sizeof label); \
 } while (0)
 
 #define ADDPTR(arg) do { \
 	struct Func { \
-		static void save(std::ofstream &file, SaveState const &state) { \
+		static void save(std::ostream &file, SaveState const &state) { \
 			write(file, state.arg.get(), state.arg.size()); \
 		} \
-		static void load(std::ifstream &file, SaveState &state) { \
+		static void load(StateReader &file, SaveState &state) { \
 			read(file, state.arg.ptr, state.arg.size()); \
 		} \
 	}; \
@@ -185,10 +273,10 @@ SaverList::SaverList() {
 
 #define ADDARRAY(arg) do { \
 	struct Func { \
-		static void save(std::ofstream &file, SaveState const &state) { \
+		static void save(std::ostream &file, SaveState const &state) { \
 			write(file, state.arg, sizeof state.arg); \
 		} \
-		static void load(std::ifstream &file, SaveState &state) { \
+		static void load(StateReader &file, SaveState &state) { \
 			read(file, state.arg, sizeof state.arg); \
 		} \
 	}; \
@@ -304,6 +392,8 @@ SaverList::SaverList() {
 	{ static char const label[] = "c4mastr"; ADD(spu.ch4.master); }
 	{ static char const label[] = "rtcbase"; ADD(rtc.baseTime); }
 	{ static char const label[] = "rtchalt"; ADD(rtc.haltTime); }
+	{ static char const label[] = "rtcetim"; ADD(rtc.emulatedTime); }
+	{ static char const label[] = "rtcetck"; ADD(rtc.emulatedTicks); }
 	{ static char const label[] = "rtcdh";   ADD(rtc.dataDh); }
 	{ static char const label[] = "rtcdl";   ADD(rtc.dataDl); }
 	{ static char const label[] = "rtch";    ADD(rtc.dataH); }
@@ -317,20 +407,42 @@ SaverList::SaverList() {
 
 	list.resize(list.size());
 	std::sort(list.begin(), list.end());
+	// Equal labels have equal keys, which collide under any multiplier.
+	assert(std::adjacent_find(list.begin(), list.end(), LabelEqual()) == list.end());
+
+	// Labels are at most 7 characters, and there are fewer than 255 of them. A
+	// multiplier that hashes every label to its own slot is found by trying odd
+	// multipliers in turn, which takes a few tries with a table this sparse.
+	multiplier_ = 0x9E3779B97F4A7C15ull;
+	for (int tries = 1; !fillTable(); ++tries) {
+		if (tries == max_multiplier_tries) {
+			assert(!"no collision-free label key multiplier");
+			multiplier_ = 0;
+			break;
+		}
 
-	maxLabelsize_ = 0;
+		multiplier_ = (multiplier_ + 0x5851F42D4C957F2Eull) & 0xFFFFFFFFFFFFFFFFull;
+	}
+}
 
+bool SaverList::fillTable() {
+	std::memset(table_, 0, sizeof table_);
 	for (std::size_t i = 0; i < list.size(); ++i) {
-		if (list[i].labelsize > maxLabelsize_)
-			maxLabelsize_ = list[i].labelsize;
+		unsigned char &slot = table_[hash(list[i].key)];
+		if (slot)
+			return false;
+
+		slot = i + 1;
 	}
+
+	return true;
 }
 
 }
 
 namespace {
 
-void writeSnapShot(std::ofstream &file, uint_least32_t const *pixels, std::ptrdiff_t const pitch) {
+void writeSnapShot(std::ostream &file, uint_least32_t const *pixels, std::ptrdiff_t const pitch) {
 	put24(file, pixels ? StateSaver::ss_width * StateSaver::ss_height * sizeof(uint_least32_t) : 0);
 
 	if (pixels) {
@@ -341,48 +453,334 @@ void writeSnapShot(std::ofstream &file, uint_least32_t const *pixels, std::ptrdi
 	}
 }
 
-SaverList list;
+// Built on first use, which is safe from any thread, and never changed after.
+SaverList const & saverList() {
+	static SaverList const list;
+	return list;
+}
 
-} // anon namespace
+// Stream buffer over a fixed memory area. Output beyond the end is counted but
+// discarded, so that the size needed can be reported without allocating.
+class MemStreamBuf : public std::streambuf {
+public:
+	MemStreamBuf(char *buf, std::size_t size) : excess_(0) {
+		setp(buf, buf + size);
+	}
 
-bool StateSaver::saveState(SaveState const &state,
-		uint_least32_t const *const videoBuf,
-		std::ptrdiff_t const pitch, std::string const &filename) {
-	std::ofstream file(filename.c_str(), std::ios_base::binary);
-	if (!file)
+	std::size_t written() const { return pptr() - pbase() + excess_; }
+
+protected:
+	virtual int_type overflow(int_type c) {
+		++excess_;
+		return traits_type::not_eof(c);
+	}
+
+	virtual std::streamsize xsputn(char const *s, std::streamsize n) {
+		std::streamsize const fits = std::min<std::streamsize>(n, epptr() - pptr());
+		std::memcpy(pptr(), s, fits);
+		pbump(fits);
+		excess_ += n - fits;
+		return n;
+	}
+
+private:
+	std::size_t excess_;
+};
+
+// Stream buffer computing the 64-bit xxHash of what is written to it.
+class HashStreamBuf : public std::streambuf {
+public:
+	HashStreamBuf() { setp(buf_, buf_ + sizeof buf_); }
+
+	uint_least64_t digest() {
+		flush();
+		return hash_.digest();
+	}
+
+protected:
+	virtual int_type overflow(int_type c) {
+		flush();
+		if (!traits_type::eq_int_type(c, traits_type::eof()))
+			sputc(traits_type::to_char_type(c));
+
+		return traits_type::not_eof(c);
+	}
+
+	// Hashes large writes in place rather than copying them.
+	virtual std::streamsize xsputn(char const *s, std::streamsize n) {
+		if (n > epptr() - pptr()) {
+			flush();
+			if (n >= std::streamsize(sizeof buf_)) {
+				hash_.update(s, n);
+				return n;
+			}
+		}
+
+		std::memcpy(pptr(), s, n);
+		pbump(n);
+		return n;
+	}
+
+private:
+	char buf_[0x1000];
+	Xxh64 hash_;
+
+	void flush() {
+		hash_.update(pbase(), pptr() - pbase());
+		setp(buf_, buf_ + sizeof buf_);
+	}
+};
+
+// The raw format is a header followed by a memory image of SaveState and the
+// blocks it points to, in RAW_BLOCKS order. Nothing is converted, so it can only
+// be read by a build with the same fingerprint.
+#define RAW_BLOCKS(X) \
+	X(mem.vram) X(mem.sram) X(mem.wram) X(mem.ioamhram) \
+	X(ppu.bgpData) X(ppu.objpData) X(ppu.oamReaderBuf) X(ppu.oamReaderSzbuf) \
+	X(spu.ch3.waveRam)
+
+#define COUNT_BLOCK(member) + 1
+enum { num_raw_blocks = 0 RAW_BLOCKS(COUNT_BLOCK) };
+#undef COUNT_BLOCK
+
+enum { raw_version = 1 };
+char const raw_magic[4] = { 'G', 'B', 'S', 'R' };
+
+struct RawHeader {
+	char magic[sizeof raw_magic];
+	uint_least32_t version;
+	uint_least32_t fingerprint;
+	uint_least32_t blockSizes[num_raw_blocks];
+};
+
+template<class T>
+std::size_t blockSize(SaveState::Ptr<T> const &p) { return p.size() * sizeof(T); }
+
+unsigned long hashBytes(unsigned long h, void const *data, std::size_t size) {
+	for (std::size_t i = 0; i < size; ++i)
+		h = ((h ^ static_cast<unsigned char const *>(data)[i]) * 16777619ul) & 0xFFFFFFFF;
+
+	return h;
+}
+
+// Changes whenever the SaveState layout or the labelled field set is likely to
+// have changed, so that raw states from other builds are rejected rather than
+// misread. Sizes are hashed in native byte order to catch endianness too.
+unsigned long computeRawFingerprint() {
+	std::size_t const layout[] = {
+		raw_version, sizeof(SaveState), sizeof(SaveState::CPU), sizeof(SaveState::Mem),
+		sizeof(SaveState::PPU), sizeof(SaveState::SPU), sizeof(SaveState::RTC),
+		offsetof(SaveState, mem), offsetof(SaveState, ppu), offsetof(SaveState, spu),
+		offsetof(SaveState, rtc), sizeof(long), sizeof(bool)
+	};
+	unsigned long h = hashBytes(2166136261ul, layout, sizeof layout);
+	SaverList const &list = saverList();
+	for (SaverList::const_iterator it = list.begin(); it != list.end(); ++it)
+		h = hashBytes(h, it->label, it->labelsize);
+
+	return h;
+}
+
+unsigned long rawFingerprint() {
+	static unsigned long const fingerprint = computeRawFingerprint();
+	return fingerprint;
+}
+
+RawHeader rawHeader(SaveState const &state) {
+	RawHeader h;
+	std::memcpy(h.magic, raw_magic, sizeof h.magic);
+	h.version = raw_version;
+	h.fingerprint = rawFingerprint();
+	uint_least32_t *size = h.blockSizes;
+#define BLOCK_SIZE(member) *size++ = blockSize(state.member);
+	RAW_BLOCKS(BLOCK_SIZE)
+#undef BLOCK_SIZE
+	return h;
+}
+
+std::size_t rawStateSize(RawHeader const &h) {
+	std::size_t size = sizeof h + sizeof(SaveState);
+	for (std::size_t i = 0; i < num_raw_blocks; ++i)
+		size += h.blockSizes[i];
+
+	return size;
+}
+
+bool isRawState(char const *data, std::size_t size) {
+	return size >= sizeof raw_magic && !std::memcmp(data, raw_magic, sizeof raw_magic);
+}
+
+bool loadRawState(SaveState &state, char const *data, std::size_t size) {
+	RawHeader const expected = rawHeader(state);
+	if (size != rawStateSize(expected) || std::memcmp(data, &expected, sizeof expected))
 		return false;
 
+	data += sizeof expected;
+	SaveState loaded;
+	std::memcpy(&loaded, data, sizeof loaded);
+	data += sizeof loaded;
+
+	// The blocks are copied to the memory the live pointers refer to, which is not
+	// const. The pointers stored in the image are meaningless and are replaced.
+#define LOAD_BLOCK(member) \
+	std::memcpy(const_cast<void *>(static_cast<void const *>(state.member.get())), \
+	            data, blockSize(state.member)); \
+	data += blockSize(state.member); \
+	loaded.member = state.member;
+	RAW_BLOCKS(LOAD_BLOCK)
+#undef LOAD_BLOCK
+
+	state = loaded;
+	state.cpu.cycleCounter &= 0x7FFFFFFF;
+	state.spu.cycleCounter &= 0x7FFFFFFF;
+	return true;
+}
+
+struct ThumbnailSaver {
+	uint_least32_t const *videoBuf;
+	std::ptrdiff_t pitch;
+
+	std::size_t operator()(SaveState const &state, char *buf, std::size_t bufsize) const {
+		return StateSaver::saveState(state, videoBuf, pitch, buf, bufsize);
+	}
+};
+
+template<class SaveFunc>
+void saveToVector(SaveFunc save, SaveState const &state, std::vector<char> &data) {
+	data.resize(data.capacity());
+	std::size_t const size = save(state, data.empty() ? 0 : &data[0], data.size());
+	if (size > data.size()) {
+		data.resize(size);
+		save(state, &data[0], size);
+	} else
+		data.resize(size);
+}
+
+} // anon namespace
+
+void StateSaver::saveState(SaveState const &state,
+		uint_least32_t const *const videoBuf,
+		std::ptrdiff_t const pitch, std::ostream &file) {
 	{ static char const ver[] = { 0, 2 }; file.write(ver, sizeof ver); }
 	writeSnapShot(file, videoBuf, pitch);
 
+	SaverList const &list = saverList();
 	for (SaverList::const_iterator it = list.begin(); it != list.end(); ++it) {
 		file.write(it->label, it->labelsize);
 		(*it->save)(file, state);
 	}
+}
+
+std::size_t StateSaver::saveState(SaveState const &state,
+		uint_least32_t const *const videoBuf, std::ptrdiff_t const pitch,
+		char *const buf, std::size_t const bufsize) {
+	MemStreamBuf sbuf(buf, bufsize);
+	std::ostream out(&sbuf);
+	saveState(state, videoBuf, pitch, out);
+	return sbuf.written();
+}
+
+void StateSaver::saveState(SaveState const &state,
+		uint_least32_t const *const videoBuf, std::ptrdiff_t const pitch,
+		std::vector<char> &data) {
+	ThumbnailSaver const save = { videoBuf, pitch };
+	saveToVector(save, state, data);
+}
 
-	return !file.fail();
+std::size_t StateSaver::saveRawState(SaveState const &state, char *buf, std::size_t bufsize) {
+	RawHeader const h = rawHeader(state);
+	std::size_t const size = rawStateSize(h);
+	if (size > bufsize)
+		return size;
+
+	std::memcpy(buf, &h, sizeof h);
+	buf += sizeof h;
+	std::memcpy(buf, &state, sizeof state);
+	buf += sizeof state;
+#define SAVE_BLOCK(member) \
+	std::memcpy(buf, state.member.get(), blockSize(state.member)); \
+	buf += blockSize(state.member);
+	RAW_BLOCKS(SAVE_BLOCK)
+#undef SAVE_BLOCK
+
+	return size;
+}
+
+void StateSaver::saveRawState(SaveState const &state, std::vector<char> &data) {
+	std::size_t (*const save)(SaveState const &, char *, std::size_t) = saveRawState;
+	saveToVector(save, state, data);
+}
+
+uint_least64_t StateSaver::hashState(SaveState const &state) {
+	// The RTC base and halt times are wall clock times.
+	SaveState s = state;
+	s.rtc.baseTime = 0;
+	s.rtc.haltTime = 0;
+
+	HashStreamBuf sbuf;
+	std::ostream out(&sbuf);
+	saveState(s, 0, 0, out);
+	return sbuf.digest();
 }
 
 bool StateSaver::loadState(SaveState &state, std::string const &filename) {
 	std::ifstream file(filename.c_str(), std::ios_base::binary);
-	if (!file || file.get() != 0)
+	if (!file)
+		return false;
+
+	std::vector<char> data;
+	char buf[0x1000];
+	while (file.read(buf, sizeof buf) || file.gcount())
+		data.insert(data.end(), buf, buf + file.gcount());
+
+	if (data.empty() || !decompressState(data))
+		return false;
+
+	return loadState(state, &data[0], data.size());
+}
+
+bool StateSaver::copyState(SaveState const &from, SaveState &to) {
+#define BLOCK_SIZE_DIFFERS(member) || blockSize(from.member) != blockSize(to.member)
+	if (false RAW_BLOCKS(BLOCK_SIZE_DIFFERS))
 		return false;
+#undef BLOCK_SIZE_DIFFERS
 
-	file.ignore();
+	SaveState copy = from;
+#define COPY_BLOCK(member) \
+	std::memcpy(const_cast<void *>(static_cast<void const *>(to.member.get())), \
+	            from.member.get(), blockSize(from.member)); \
+	copy.member = to.member;
+	RAW_BLOCKS(COPY_BLOCK)
+#undef COPY_BLOCK
+
+	to = copy;
+	return true;
+}
+
+bool StateSaver::loadState(SaveState &state, char const *data, std::size_t size) {
+	if (isRawState(data, size))
+		return loadRawState(state, data, size);
+
+	StateReader file(data, size);
+	if (file.atEnd() || file.get() != 0)
+		return false;
+
+	file.ignore(1);
 	file.ignore(get24(file));
 
-	Array<char> const labelbuf(list.maxLabelsize());
-	Saver const labelbufSaver = { labelbuf, 0, 0, list.maxLabelsize() };
+	// Fields are normally in the order they are saved in, which is checked first.
+	SaverList const &list = saverList();
 	SaverList::const_iterator done = list.begin();
+	while (!file.atEnd() && done != list.end()) {
+		char const *const label = file.label();
+		if (!label)
+			break;
 
-	while (file.good() && done != list.end()) {
-		file.getline(labelbuf, list.maxLabelsize(), '\0');
-
+		uint_least64_t const key = labelKey(label);
 		SaverList::const_iterator it = done;
-		if (std::strcmp(labelbuf, it->label)) {
-			it = std::lower_bound(it + 1, list.end(), labelbufSaver);
-
-			if (it == list.end() || std::strcmp(labelbuf, it->label)) {
+		if (key != it->key) {
+			it = list.find(key);
+			if (it == list.end()) {
 				file.ignore(get24(file));
 				continue;
 			}
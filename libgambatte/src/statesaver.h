@@ -21,7 +21,9 @@
 
 #include "gbint.h"
 #include <cstddef>
+#include <iosfwd>
 #include <string>
+#include <vector>
 
 namespace gambatte {
 
@@ -32,13 +34,64 @@ public:
 	enum { ss_width = 160 };
 	enum { ss_height = 144 };
 
-	static bool saveState(SaveState const &state,
-			uint_least32_t const *videoBuf, std::ptrdiff_t pitch,
-			std::string const &filename);
+	/**
+	  * Loads a state file, which may be compressed (see compressState) or a
+	  * legacy uncompressed one.
+	  */
 	static bool loadState(SaveState &state, std::string const &filename);
 
+	/**
+	  * Saves to buf with a thumbnail of videoBuf, or without one if videoBuf is 0.
+	  * Writes nothing past buf + bufsize.
+	  * @return size of the full state, which is only complete if <= bufsize
+	  */
+	static std::size_t saveState(SaveState const &state,
+			uint_least32_t const *videoBuf, std::ptrdiff_t pitch,
+			char *buf, std::size_t bufsize);
+	static std::size_t saveState(SaveState const &state, char *buf, std::size_t bufsize) {
+		return saveState(state, 0, 0, buf, bufsize);
+	}
+
+	/** Saves to data like the above. Only allocates if data needs to grow. */
+	static void saveState(SaveState const &state,
+			uint_least32_t const *videoBuf, std::ptrdiff_t pitch,
+			std::vector<char> &data);
+	static void saveState(SaveState const &state, std::vector<char> &data) {
+		saveState(state, 0, 0, data);
+	}
+
+	/**
+	  * Saves to buf in the raw format, a fixed-layout memory image that is much
+	  * faster to save and load, but can only be loaded by the same build.
+	  * Writes nothing past buf + bufsize.
+	  * @return size of the full state, which is written only if <= bufsize
+	  */
+	static std::size_t saveRawState(SaveState const &state, char *buf, std::size_t bufsize);
+	static void saveRawState(SaveState const &state, std::vector<char> &data);
+
+	/**
+	  * Returns a 64-bit xxHash of the state as saved without a thumbnail, but
+	  * with the wall clock based RTC times zeroed. Nothing is allocated.
+	  */
+	static uint_least64_t hashState(SaveState const &state);
+
+	/**
+	  * Loads either format. Raw states from a build with a different layout
+	  * fingerprint, or with differently sized memory blocks, are rejected.
+	  */
+	static bool loadState(SaveState &state, char const *data, std::size_t size);
+
+	/**
+	  * Copies from into to, including the blocks it points to, keeping the pointers
+	  * of to. Fails if any block differs in size.
+	  */
+	static bool copyState(SaveState const &from, SaveState &to);
+
 private:
 	StateSaver();
+	static void saveState(SaveState const &state,
+			uint_least32_t const *videoBuf, std::ptrdiff_t pitch,
+			std::ostream &file);
 };
 
 }
@@ -0,0 +1,247 @@
+//
+//   Copyright (C) 2026 by the Gambatte contributors
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License version 2 for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   version 2 along with this program; if not, write to the
+//   Free Software Foundation, Inc.,
+//   51 Franklin St, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+
+#include "stateslotindex.h"
+#include "statecompress.h"
+#include <algorithm>
+#include <ctime>
+#include <fstream>
+
+// Index file layout, all integers big-endian:
+//   "GQI" and a version byte
+//   number of slots (1 byte)
+//   per slot: slot number (1 byte), save time (8 bytes, signed), state size
+//   (4 bytes), state hash (8 bytes), thumbnail offset from the start of the
+//   file (4 bytes) and size (4 bytes, 0 if there is none)
+//   the thumbnails, each 8-bit R, G, B triples compressed like a state file.
+// The file as a whole is not compressed, so that the slot entries can be read
+// without reading or decompressing any thumbnail.
+
+namespace {
+
+using namespace gambatte;
+
+enum { version = 2 };
+enum { header_bytes = 5, entry_bytes = 29 };
+enum { thumb_bytes = StateSlotInfo::thumb_width * StateSlotInfo::thumb_height * 3 };
+
+// The most a thumbnail can take in the index file: stored as is, or compressed,
+// which at worst adds the gzip wrapper and a few bytes per deflate block.
+enum { max_thumb_size = thumb_bytes + thumb_bytes / 1024 + 64 };
+
+char * putBytes(char *p, unsigned long long value, int n) {
+	while (n--)
+		*p++ = value >> (8 * n) & 0xFF;
+
+	return p;
+}
+
+unsigned long long getBytes(char const *p, int n) {
+	unsigned long long value = 0;
+	while (n--)
+		value = value << 8 | (*p++ & 0xFF);
+
+	return value;
+}
+
+// Averages 2x2 blocks of pixels into R, G, B triples.
+void downscale(std::vector<char> &thumb,
+		uint_least32_t const *videoBuf, std::ptrdiff_t const pitch) {
+	thumb.resize(thumb_bytes);
+	char *p = &thumb[0];
+	for (unsigned y = 0; y < StateSlotInfo::thumb_height; ++y) {
+		uint_least32_t const *const line = videoBuf + std::ptrdiff_t(2 * y) * pitch;
+		for (unsigned x = 0; x < StateSlotInfo::thumb_width; ++x) {
+			uint_least32_t const q[] = { line[2 * x], line[2 * x + 1],
+			                             line[2 * x + pitch], line[2 * x + 1 + pitch] };
+			uint_least32_t rb = 0, g = 0;
+			for (int i = 0; i < 4; ++i) {
+				rb += q[i] & 0xFF00FF;
+				g += q[i] & 0x00FF00;
+			}
+
+			p = putBytes(p, (rb >> 2 & 0xFF00FF) | (g >> 2 & 0x00FF00), 3);
+		}
+	}
+}
+
+struct SlotLess {
+	bool operator()(StateSlotInfo const &l, StateSlotInfo const &r) const { return l.slot < r.slot; }
+};
+
+} // anon namespace
+
+namespace gambatte {
+
+void StateSlotIndex::load(std::string const &filepath) {
+	if (loaded_ && filepath == filepath_)
+		return;
+
+	filepath_ = filepath;
+	loaded_ = true;
+	thumbsLoaded_ = false;
+	slots_.clear();
+	thumbs_.clear();
+
+	std::ifstream file(filepath.c_str(), std::ios_base::binary);
+	char header[header_bytes];
+	if (!file.read(header, header_bytes)
+			|| std::string(header, 3) != "GQI" || header[3] != version) {
+		return;
+	}
+
+	std::vector<char> entries((header[4] & 0xFF) * entry_bytes);
+	if (entries.empty() || !file.read(&entries[0], entries.size()))
+		return;
+
+	file.seekg(0, std::ios_base::end);
+	unsigned long long const fileSize = file.tellg();
+
+	// Entries with thumbnails outside the file are dropped, and so are entries
+	// for slots that already have one, keeping slots_ sorted for lookups.
+	for (char const *p = &entries[0]; p != &entries[0] + entries.size(); p += entry_bytes) {
+		StateSlotInfo info = StateSlotInfo();
+		info.slot = *p & 0xFF;
+		info.saveTime = static_cast<long long>(getBytes(p + 1, 8));
+		info.stateSize = getBytes(p + 9, 4);
+		info.stateHash = getBytes(p + 13, 8);
+		Thumb thumb;
+		thumb.offset = getBytes(p + 21, 4);
+		thumb.size = getBytes(p + 25, 4);
+		info.hasThumbnail = thumb.size != 0;
+		if (thumb.size > max_thumb_size
+				|| (thumb.size && thumb.offset + thumb.size > fileSize)) {
+			continue;
+		}
+
+		std::vector<StateSlotInfo>::iterator const it =
+			std::lower_bound(slots_.begin(), slots_.end(), info, SlotLess());
+		if (it != slots_.end() && it->slot == info.slot)
+			continue;
+
+		thumbs_.insert(thumbs_.begin() + (it - slots_.begin()), thumb);
+		slots_.insert(it, info);
+	}
+}
+
+bool StateSlotIndex::readThumb(std::istream &file, std::size_t const i,
+		std::vector<char> &data) const {
+	data.resize(thumbs_[i].size);
+	return file.seekg(thumbs_[i].offset) && file.read(&data[0], data.size());
+}
+
+// Reads the thumbnails that are only in the index file, so that it can be
+// written again.
+void StateSlotIndex::loadThumbs() {
+	if (thumbsLoaded_)
+		return;
+
+	thumbsLoaded_ = true;
+	std::ifstream file(filepath_.c_str(), std::ios_base::binary);
+	for (std::size_t i = 0; i < slots_.size(); ++i) {
+		if (slots_[i].hasThumbnail && !readThumb(file, i, thumbs_[i].data)) {
+			slots_[i].hasThumbnail = false;
+			thumbs_[i].data.clear();
+			file.clear();
+		}
+	}
+}
+
+bool StateSlotIndex::thumbnail(int const slot, std::vector<uint_least32_t> &thumb) const {
+	StateSlotInfo key = StateSlotInfo();
+	key.slot = slot;
+	std::vector<StateSlotInfo>::const_iterator const it =
+		std::lower_bound(slots_.begin(), slots_.end(), key, SlotLess());
+	if (it == slots_.end() || it->slot != slot || !it->hasThumbnail)
+		return false;
+
+	std::size_t const i = it - slots_.begin();
+	std::vector<char> data;
+	if (thumbsLoaded_) {
+		data = thumbs_[i].data;
+	} else {
+		std::ifstream file(filepath_.c_str(), std::ios_base::binary);
+		if (!readThumb(file, i, data))
+			return false;
+	}
+
+	if (!decompressState(data) || data.size() != thumb_bytes)
+		return false;
+
+	thumb.resize(StateSlotInfo::thumb_width * StateSlotInfo::thumb_height);
+	for (std::size_t j = 0; j < thumb.size(); ++j)
+		thumb[j] = getBytes(&data[3 * j], 3);
+
+	return true;
+}
+
+void StateSlotIndex::update(int const slot, std::size_t const stateSize,
+		uint_least64_t const stateHash,
+		uint_least32_t const *const videoBuf, std::ptrdiff_t const pitch) {
+	loadThumbs();
+
+	StateSlotInfo info = StateSlotInfo();
+	info.slot = slot;
+	std::vector<StateSlotInfo>::iterator it =
+		std::lower_bound(slots_.begin(), slots_.end(), info, SlotLess());
+	std::vector<Thumb>::iterator thumb = thumbs_.begin() + (it - slots_.begin());
+	if (it == slots_.end() || it->slot != slot) {
+		thumb = thumbs_.insert(thumb, Thumb());
+		it = slots_.insert(it, info);
+	}
+
+	it->saveTime = std::time(0);
+	it->stateSize = stateSize;
+	it->stateHash = stateHash;
+	it->hasThumbnail = videoBuf != 0;
+	thumb->data.clear();
+	if (videoBuf) {
+		std::vector<char> raw;
+		downscale(raw, videoBuf, pitch);
+		if (!compressState(raw, thumb->data))
+			thumb->data.swap(raw);
+	}
+}
+
+void StateSlotIndex::save(std::vector<char> &data) const {
+	std::size_t size = header_bytes + slots_.size() * entry_bytes;
+	for (std::size_t i = 0; i < thumbs_.size(); ++i)
+		size += thumbs_[i].data.size();
+
+	data.resize(size);
+	char *p = &data[0];
+	p = std::copy("GQI", "GQI" + 3, p);
+	*p++ = version;
+	*p++ = slots_.size();
+	unsigned long offset = header_bytes + slots_.size() * entry_bytes;
+	for (std::size_t i = 0; i < slots_.size(); ++i) {
+		StateSlotInfo const &info = slots_[i];
+		*p++ = info.slot;
+		p = putBytes(p, info.saveTime, 8);
+		p = putBytes(p, info.stateSize, 4);
+		p = putBytes(p, info.stateHash, 8);
+		p = putBytes(p, offset, 4);
+		p = putBytes(p, thumbs_[i].data.size(), 4);
+		offset += thumbs_[i].data.size();
+	}
+
+	for (std::size_t i = 0; i < thumbs_.size(); ++i)
+		p = std::copy(thumbs_[i].data.begin(), thumbs_[i].data.end(), p);
+}
+
+}
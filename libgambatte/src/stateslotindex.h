@@ -0,0 +1,88 @@
+//
+//   Copyright (C) 2026 by the Gambatte contributors
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License version 2 for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   version 2 along with this program; if not, write to the
+//   Free Software Foundation, Inc.,
+//   51 Franklin St, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+
+#ifndef STATESLOTINDEX_H
+#define STATESLOTINDEX_H
+
+#include "gambatte.h"
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace gambatte {
+
+/**
+  * In-memory copy of a per-ROM index of state slots, which records when each
+  * slot was saved, the size and hash of its state and a downscaled thumbnail,
+  * so that slot menus need not open every state file. The index file starts
+  * with a fixed-size entry per slot, so listing the slots reads only those.
+  * Thumbnails follow, each compressed on its own (see compressState), and are
+  * read when asked for.
+  */
+class StateSlotIndex {
+public:
+	StateSlotIndex() : loaded_(false), thumbsLoaded_(false) {}
+
+	/**
+	  * Makes this the index stored at filepath, reading its slot entries unless
+	  * it was the last one read. A missing or unreadable index file gives an
+	  * empty index.
+	  */
+	void load(std::string const &filepath);
+
+	std::string const & filepath() const { return filepath_; }
+	std::vector<StateSlotInfo> const & slots() const { return slots_; }
+
+	/**
+	  * Replaces the contents of thumb with the thumbnail of slot.
+	  * @return false if slot has no thumbnail or it could not be read
+	  */
+	bool thumbnail(int slot, std::vector<uint_least32_t> &thumb) const;
+
+	/**
+	  * Records that slot was saved with a state of stateSize bytes and the given
+	  * hash and thumbnail.
+	  */
+	void update(int slot, std::size_t stateSize, uint_least64_t stateHash,
+			uint_least32_t const *videoBuf, std::ptrdiff_t pitch);
+
+	/** Replaces the contents of data with the index file contents. */
+	void save(std::vector<char> &data) const;
+
+private:
+	// Where the compressed thumbnail of the slot at the same position in slots_
+	// is in the index file, and once thumbsLoaded_ is set, the thumbnail itself.
+	struct Thumb {
+		unsigned long offset;
+		unsigned long size;
+		std::vector<char> data;
+	};
+
+	std::vector<StateSlotInfo> slots_;
+	std::vector<Thumb> thumbs_;
+	std::string filepath_;
+	bool loaded_;
+	bool thumbsLoaded_;
+
+	bool readThumb(std::istream &file, std::size_t i, std::vector<char> &data) const;
+	void loadThumbs();
+};
+
+}
+
+#endif
@@ -19,6 +19,7 @@
 #include "video.h"
 #include "savestate.h"
 #include <algorithm>
+#include <cstring>
 
 using namespace gambatte;
 
@@ -844,3 +845,8 @@ void LCD::setDmgPaletteColor(unsigned palNum, unsigned colorNum, unsigned long r
 		refreshPalettes();
 	}
 }
+
+void LCD::setDmgPalettes(LCD const &other) {
+	std::memcpy(dmgColorsRgb32_, other.dmgColorsRgb32_, sizeof dmgColorsRgb32_);
+	refreshPalettes();
+}
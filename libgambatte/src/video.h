@@ -54,6 +54,7 @@ public:
 	void saveState(SaveState &state) const;
 	void loadState(SaveState const &state, unsigned char const *oamram);
 	void setDmgPaletteColor(unsigned palNum, unsigned colorNum, unsigned long rgb32);
+	void setDmgPalettes(LCD const &other);
 	void setVideoBuffer(uint_least32_t *videoBuf, std::ptrdiff_t pitch);
 
 	void dmgBgPaletteChange(unsigned data, unsigned long cycleCounter) {
@@ -34,19 +34,23 @@ enum {
 
 class PPUFrameBuf {
 public:
-	PPUFrameBuf() : buf_(0), fbline_(nullfbline()), pitch_(0) {}
+	PPUFrameBuf() : buf_(0), fbline_(nullfbline_), pitch_(0) {}
 	uint_least32_t * fb() const { return buf_; }
 	uint_least32_t * fbline() const { return fbline_; }
 	std::ptrdiff_t pitch() const { return pitch_; }
-	void setBuf(uint_least32_t *buf, std::ptrdiff_t pitch) { buf_ = buf; pitch_ = pitch; fbline_ = nullfbline(); }
-	void setFbline(unsigned ly) { fbline_ = buf_ ? buf_ + std::ptrdiff_t(ly) * pitch_ : nullfbline(); }
+	void setBuf(uint_least32_t *buf, std::ptrdiff_t pitch) { buf_ = buf; pitch_ = pitch; fbline_ = nullfbline_; }
+	void setFbline(unsigned ly) { fbline_ = buf_ ? buf_ + std::ptrdiff_t(ly) * pitch_ : nullfbline_; }
 
 private:
 	uint_least32_t *buf_;
 	uint_least32_t *fbline_;
 	std::ptrdiff_t pitch_;
+	// Lines are drawn here when there is no video buffer. Each instance has its
+	// own, so that instances on different threads do not write to the same one.
+	uint_least32_t nullfbline_[lcd_hres];
 
-	static uint_least32_t * nullfbline() { static uint_least32_t nullfbline_[160]; return nullfbline_; }
+	PPUFrameBuf(PPUFrameBuf const &);
+	PPUFrameBuf & operator=(PPUFrameBuf const &);
 };
 
 struct PPUPriv;
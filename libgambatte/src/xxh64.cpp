@@ -0,0 +1,127 @@
+//
+//   Copyright (C) 2026 by the Gambatte contributors
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License version 2 for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   version 2 along with this program; if not, write to the
+//   Free Software Foundation, Inc.,
+//   51 Franklin St, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+
+#include "xxh64.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+using gambatte::uint_least64_t;
+
+uint_least64_t const prime1 = 11400714785074694791ull;
+uint_least64_t const prime2 = 14029467366897019727ull;
+uint_least64_t const prime3 = 1609587929392839161ull;
+uint_least64_t const prime4 = 9650029242287828579ull;
+uint_least64_t const prime5 = 2870177450012600261ull;
+
+inline uint_least64_t rotl(uint_least64_t x, int r) {
+	return x << r | x >> (64 - r);
+}
+
+inline uint_least64_t round(uint_least64_t acc, uint_least64_t input) {
+	return rotl(acc + input * prime2, 31) * prime1;
+}
+
+inline uint_least64_t get32(unsigned char const *p) {
+	return p[0] | p[1] << 8 | uint_least64_t(p[2]) << 16 | uint_least64_t(p[3]) << 24;
+}
+
+inline uint_least64_t get64(unsigned char const *p) {
+	return get32(p) | get32(p + 4) << 32;
+}
+
+} // anon namespace
+
+namespace gambatte {
+
+Xxh64::Xxh64()
+: length_(0)
+, tailSize_(0)
+{
+	v_[0] = prime1 + prime2;
+	v_[1] = prime2;
+	v_[2] = 0;
+	v_[3] = 0 - prime1;
+}
+
+// Hashes the whole stripes in [p, end), and returns where the rest starts.
+unsigned char const * Xxh64::hashStripes(unsigned char const *p, unsigned char const *end) {
+	uint_least64_t v0 = v_[0], v1 = v_[1], v2 = v_[2], v3 = v_[3];
+	for (; end - p >= stripe_size; p += stripe_size) {
+		v0 = round(v0, get64(p));
+		v1 = round(v1, get64(p + 8));
+		v2 = round(v2, get64(p + 16));
+		v3 = round(v3, get64(p + 24));
+	}
+
+	v_[0] = v0;
+	v_[1] = v1;
+	v_[2] = v2;
+	v_[3] = v3;
+	return p;
+}
+
+void Xxh64::update(void const *const data, std::size_t const size) {
+	unsigned char const *p = static_cast<unsigned char const *>(data);
+	unsigned char const *const end = p + size;
+	length_ += size;
+	if (tailSize_) {
+		std::size_t const fill = std::min<std::size_t>(size, stripe_size - tailSize_);
+		std::memcpy(tail_ + tailSize_, p, fill);
+		tailSize_ += fill;
+		p += fill;
+		if (tailSize_ < stripe_size)
+			return;
+
+		hashStripes(tail_, tail_ + stripe_size);
+		tailSize_ = 0;
+	}
+
+	p = hashStripes(p, end);
+	std::memcpy(tail_, p, end - p);
+	tailSize_ = end - p;
+}
+
+uint_least64_t Xxh64::digest() const {
+	uint_least64_t h = prime5;
+	if (length_ >= stripe_size) {
+		h = rotl(v_[0], 1) + rotl(v_[1], 7) + rotl(v_[2], 12) + rotl(v_[3], 18);
+		for (int i = 0; i < 4; ++i)
+			h = (h ^ round(0, v_[i])) * prime1 + prime4;
+	}
+
+	h += length_;
+	unsigned char const *p = tail_;
+	unsigned char const *const end = tail_ + tailSize_;
+	for (; end - p >= 8; p += 8)
+		h = rotl(h ^ round(0, get64(p)), 27) * prime1 + prime4;
+	if (end - p >= 4) {
+		h = rotl(h ^ get32(p) * prime1, 23) * prime2 + prime3;
+		p += 4;
+	}
+
+	for (; p != end; ++p)
+		h = rotl(h ^ *p * prime5, 11) * prime1;
+
+	h = (h ^ h >> 33) * prime2;
+	h = (h ^ h >> 29) * prime3;
+	return h ^ h >> 32;
+}
+
+}
@@ -0,0 +1,51 @@
+//
+//   Copyright (C) 2026 by the Gambatte contributors
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License version 2 for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   version 2 along with this program; if not, write to the
+//   Free Software Foundation, Inc.,
+//   51 Franklin St, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+
+#ifndef XXH64_H
+#define XXH64_H
+
+#include "gbint.h"
+#include <cstddef>
+
+namespace gambatte {
+
+/**
+  * Computes the 64-bit xxHash (XXH64, seed 0) of the data passed to update, in
+  * any number of pieces. Input is read as little-endian words, so the hash of
+  * the same bytes is the same on every host.
+  */
+class Xxh64 {
+public:
+	Xxh64();
+	void update(void const *data, std::size_t size);
+	uint_least64_t digest() const;
+
+private:
+	enum { stripe_size = 32 };
+
+	uint_least64_t v_[4];
+	uint_least64_t length_;
+	unsigned char tail_[stripe_size];
+	std::size_t tailSize_;
+
+	unsigned char const * hashStripes(unsigned char const *p, unsigned char const *end);
+};
+
+}
+
+#endif
@@ -0,0 +1,124 @@
+#include "batchrunner.h"
+#include "benchutil.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Hashes {
+	gambatte::uint_least64_t audio;
+	gambatte::uint_least64_t state;
+	gambatte::uint_least32_t pixel;
+
+	bool operator==(Hashes const &h) const {
+		return audio == h.audio && state == h.state && pixel == h.pixel;
+	}
+};
+
+class Collector : public gambatte::BatchListener {
+public:
+	explicit Collector(std::size_t jobs) : hashes_(jobs), done_(0) {}
+	std::vector<Hashes> const & hashes() const { return hashes_; }
+	std::size_t done() const { return done_; }
+
+	virtual void jobDone(gambatte::BatchResult const &result) {
+		Hashes &h = hashes_[result.job];
+		h.audio = result.audioHash;
+		h.state = result.stateHash;
+		h.pixel = result.videoBuf[0];
+		std::lock_guard<std::mutex> lock(mut_);
+		++done_;
+	}
+
+private:
+	std::vector<Hashes> hashes_;
+	std::mutex mut_;
+	std::size_t done_;
+};
+
+} // anon ns
+
+int main(int const argc, char *argv[]) {
+	unsigned numJobs = 64;
+	unsigned maxThreads = std::max(std::thread::hardware_concurrency(), 1u);
+	std::vector<char const *> romfiles;
+
+	for (int i = 1; i < argc; ++i) {
+		if (!std::strcmp(argv[i], "-n") && i + 1 < argc) {
+			numJobs = std::max(std::atoi(argv[++i]), 1);
+		} else if (!std::strcmp(argv[i], "-t") && i + 1 < argc) {
+			maxThreads = std::max(std::atoi(argv[++i]), 1);
+		} else if (argv[i][0] != '-') {
+			romfiles.push_back(argv[i]);
+		} else {
+			std::puts("Usage: batchbench [-n jobs] [-t maxthreads] [romfile]...\n"
+			          "  Runs a batch of jobs with BatchRunner on 1 thread, then on 2, 4 and so\n"
+			          "  on up to maxthreads, which defaults to the number of hardware threads,\n"
+			          "  and reports throughput and speedup over 1 thread. Jobs run 60 to 600\n"
+			          "  frames each, so that workers run out of jobs at different times, with\n"
+			          "  a different input script each. Checks that every job gives the same\n"
+			          "  results on any number of threads. Uses a ROM image that reads the\n"
+			          "  joypad, and the given ROM images in turn.");
+			return EXIT_FAILURE;
+		}
+	}
+
+	std::string const tmprom = tempPath("batchbench.gb");
+	if (!writeRom(tmprom, makeJoypadRom()))
+		return EXIT_FAILURE;
+
+	romfiles.insert(romfiles.begin(), tmprom.c_str());
+	std::vector<gambatte::BatchJob> jobs(numJobs);
+	unsigned long frames = 0;
+	for (unsigned i = 0; i < numJobs; ++i) {
+		gambatte::BatchJob &job = jobs[i];
+		job.romfile = romfiles[i % romfiles.size()];
+		job.frames = 60 + (i * 7 % 10) * 60;
+		for (unsigned long f = 0; f < job.frames; f += 30) {
+			gambatte::InputChange const input = { f, unsigned((i + f / 30) * 37 & 0xFF) };
+			job.input.push_back(input);
+		}
+
+		frames += job.frames;
+	}
+
+	std::printf("%u jobs, %lu frames\n", numJobs, frames);
+	std::printf("%-8s %9s %10s %8s %10s\n", "threads", "secs", "frames/s", "speedup",
+	            "same");
+	std::vector<Hashes> reference;
+	double baseSecs = 0;
+	bool ok = true;
+	for (unsigned threads = 1;; threads = std::min(threads * 2, maxThreads)) {
+		gambatte::BatchRunner runner(threads);
+		Collector collector(jobs.size());
+		double const t0 = secondsNow();
+		runner.run(jobs, collector);
+		double const secs = secondsNow() - t0;
+		if (threads == 1) {
+			reference = collector.hashes();
+			baseSecs = secs;
+		}
+
+		bool const same = collector.done() == jobs.size() && collector.hashes() == reference;
+		ok &= same;
+		std::printf("%-8u %9.2f %10.0f %8.2f %10s\n", threads, secs, frames / secs,
+		            baseSecs / secs, same ? "yes" : "NO");
+		if (threads == maxThreads)
+			break;
+	}
+
+	// Different input must give different results, or the check above is void.
+	bool diverged = false;
+	for (std::size_t i = romfiles.size(); i < jobs.size(); i += romfiles.size())
+		diverged |= !(reference[i] == reference[0]);
+
+	std::printf("input affects results: %s\n", diverged ? "yes" : "NO");
+	std::remove(tmprom.c_str());
+	return ok && diverged ? 0 : EXIT_FAILURE;
+}
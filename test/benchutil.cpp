@@ -0,0 +1,117 @@
+#include "benchutil.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+double secondsNow() {
+	return std::chrono::duration<double>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+std::string tempPath(std::string const &name) {
+	char const *const tmpdir = std::getenv("TMPDIR");
+	return std::string(tmpdir ? tmpdir : "/tmp") + '/' + name;
+}
+
+bool writeFile(std::string const &path, void const *data, std::size_t size) {
+	std::FILE *const f = std::fopen(path.c_str(), "wb");
+	if (!f)
+		return false;
+
+	bool const ok = std::fwrite(data, 1, size, f) == size;
+	return std::fclose(f) == 0 && ok;
+}
+
+bool writeRom(std::string const &path, std::vector<unsigned char> const &rom) {
+	if (!writeFile(path, &rom[0], rom.size())) {
+		std::fprintf(stderr, "Failed to write %s\n", path.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+bool check(char const *what, bool ok) {
+	std::printf("%-58s %s\n", what, ok ? "ok" : "FAILED");
+	return ok;
+}
+
+std::vector<unsigned char> makeRom(unsigned char const *code, std::size_t codeSize,
+                                   std::size_t romSize) {
+	std::vector<unsigned char> rom(romSize);
+	unsigned char const entry[] = { 0x00, 0xC3, 0x50, 0x01 }; // nop; jp $150
+	std::memcpy(&rom[0x100], entry, sizeof entry);
+	if (codeSize)
+		std::memcpy(&rom[0x150], code, codeSize);
+
+	return rom;
+}
+
+std::vector<unsigned char> makeIdleRom() {
+	unsigned char const code[] = { 0x18, 0xFE }; // jr -2
+	return makeRom(code, sizeof code);
+}
+
+std::vector<unsigned char> makeJoypadRom() {
+	unsigned char const code[] = {
+		0xF3,             // di
+		0x3E, 0x10,       // ld a, $10
+		0xE0, 0x00,       // ldh ($00), a
+		0xF0, 0x00,       // ldh a, ($00)
+		0xEA, 0x00, 0xC0, // ld ($C000), a
+		0xE0, 0x47,       // ldh ($47), a
+		0x18, 0xF3        // jr -13
+	};
+	return makeRom(code, sizeof code);
+}
+
+std::vector<unsigned char> makeDualJoypadRom() {
+	unsigned char const code[] = {
+		0xF3,             // di
+		0x3E, 0x20,       // ld a, $20
+		0xE0, 0x00,       // ldh ($00), a
+		0xF0, 0x00,       // ldh a, ($00)
+		0xEA, 0x00, 0xC0, // ld ($C000), a
+		0x3E, 0x10,       // ld a, $10
+		0xE0, 0x00,       // ldh ($00), a
+		0xF0, 0x00,       // ldh a, ($00)
+		0xEA, 0x01, 0xC0, // ld ($C001), a
+		0x18, 0xEC        // jr -20
+	};
+	return makeRom(code, sizeof code);
+}
+
+unsigned long fnv1a(unsigned long hash, gambatte::uint_least32_t const *words, std::size_t n) {
+	for (std::size_t i = 0; i < n; ++i)
+		hash = ((hash ^ words[i]) * 16777619ul) & 0xFFFFFFFF;
+
+	return hash;
+}
+
+unsigned ScriptedInput::operator()() {
+	unsigned long x = (seed_ + frame_) * 2654435761ul & 0xFFFFFFFF;
+	x ^= x >> 15;
+	return x & 0xFF;
+}
+
+void FrameRunner::runFrame(gambatte::GB &gb) {
+	for (;;) {
+		std::size_t samples = samples_per_frame;
+		if (gb.runFor(&videobuf_[0], gb_width, &audiobuf_[0], samples) >= 0)
+			return;
+	}
+}
+
+unsigned long FrameRunner::runFrameHashed(gambatte::GB &gb) {
+	unsigned long hash = fnv1a_basis;
+	for (;;) {
+		std::size_t samples = samples_per_frame;
+		bool const done = gb.runFor(&videobuf_[0], gb_width, &audiobuf_[0], samples) >= 0;
+		hash = fnv1a(hash, &audiobuf_[0], samples);
+		if (done)
+			break;
+	}
+
+	return fnv1a(hash, &videobuf_[0], videobuf_.size());
+}
@@ -0,0 +1,80 @@
+#ifndef BENCHUTIL_H
+#define BENCHUTIL_H
+
+// Helpers shared by the benchmark and check programs in this directory.
+
+#include "gambatte.h"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+std::size_t const samples_per_frame = 35112;
+std::size_t const audiobuf_size = samples_per_frame + 2064;
+unsigned const gb_width = 160, gb_height = 144;
+
+double secondsNow();
+
+// name in $TMPDIR, or in /tmp if TMPDIR is not set.
+std::string tempPath(std::string const &name);
+
+// Writes size bytes of data to path. Returns false on failure.
+bool writeFile(std::string const &path, void const *data, std::size_t size);
+
+// Like writeFile, but reports failure on stderr.
+bool writeRom(std::string const &path, std::vector<unsigned char> const &rom);
+
+// Prints a row of the table of checks, and returns ok.
+bool check(char const *what, bool ok);
+
+// A ROM image of romSize bytes that jumps from the entry point to code at $150.
+std::vector<unsigned char> makeRom(unsigned char const *code, std::size_t codeSize,
+                                   std::size_t romSize = 0x8000);
+
+// A ROM image that spins.
+std::vector<unsigned char> makeIdleRom();
+
+// A ROM image that keeps reading the action buttons, and writes what it read to
+// $C000 and to the background palette.
+std::vector<unsigned char> makeJoypadRom();
+
+// A ROM image that keeps reading the direction keys to $C000 and the action
+// buttons to $C001.
+std::vector<unsigned char> makeDualJoypadRom();
+
+// Continues the 32-bit FNV-1a hash of words.
+unsigned long fnv1a(unsigned long hash, gambatte::uint_least32_t const *words, std::size_t n);
+unsigned long const fnv1a_basis = 2166136261ul;
+
+// Input that is a hash of a seed and the frame number set with setFrame, so
+// that instances with the same seed see the same input.
+class ScriptedInput : public gambatte::InputGetter {
+public:
+	explicit ScriptedInput(unsigned long seed) : seed_(seed), frame_(0) {}
+	unsigned long seed() const { return seed_; }
+	void setFrame(unsigned long frame) { frame_ = frame; }
+	virtual unsigned operator()();
+
+private:
+	unsigned long seed_;
+	unsigned long frame_;
+};
+
+// Video and audio buffers to run a GB instance a video frame at a time with.
+class FrameRunner {
+public:
+	FrameRunner() : videobuf_(gb_width * gb_height), audiobuf_(audiobuf_size) {}
+
+	// Runs gb until it draws a video frame.
+	void runFrame(gambatte::GB &gb);
+
+	// Like runFrame, and returns the FNV-1a hash of the audio and the video frame.
+	unsigned long runFrameHashed(gambatte::GB &gb);
+
+	std::vector<gambatte::uint_least32_t> const & videoBuf() const { return videobuf_; }
+
+private:
+	std::vector<gambatte::uint_least32_t> videobuf_;
+	std::vector<gambatte::uint_least32_t> audiobuf_;
+};
+
+#endif
@@ -0,0 +1,143 @@
+#include "benchutil.h"
+#include "gambatte.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+class Emulator {
+public:
+	Emulator(gambatte::GB *gb, unsigned long seed, unsigned long frame = 0)
+	: gb_(gb), input_(seed), frame_(frame)
+	{
+		gb_->setInputGetter(&input_);
+	}
+
+	~Emulator() { delete gb_; }
+	gambatte::GB & gb() { return *gb_; }
+	Emulator * clone() { return new Emulator(gb_->clone(), input_.seed(), frame_); }
+
+	// Runs one video frame and returns a hash of the video and audio output.
+	unsigned long runFrame() {
+		input_.setFrame(frame_++);
+		return runner_.runFrameHashed(*gb_);
+	}
+
+private:
+	gambatte::GB *const gb_;
+	ScriptedInput input_;
+	FrameRunner runner_;
+	unsigned long frame_;
+
+	Emulator(Emulator const &);
+	Emulator & operator=(Emulator const &);
+};
+
+bool bench(char const *romfile, char const *desc, unsigned frames, unsigned clones) {
+	Emulator a(new gambatte::GB, 1), ref(new gambatte::GB, 1);
+	if (a.gb().load(romfile) || ref.gb().load(romfile)) {
+		std::fprintf(stderr, "Failed to load ROM image file %s\n", romfile);
+		return false;
+	}
+
+	unsigned const half = frames / 2;
+	for (unsigned i = 0; i < half; ++i) {
+		a.runFrame();
+		ref.runFrame();
+	}
+
+	// Cloning, against branching by loading the ROM image and a raw state into a
+	// new instance.
+	std::vector<gambatte::GB *> gbs(clones);
+	double t0 = secondsNow();
+	for (unsigned i = 0; i < clones; ++i)
+		gbs[i] = a.gb().clone();
+
+	double const cloneUsecs = (secondsNow() - t0) * 1e6 / clones;
+	t0 = secondsNow();
+	for (unsigned i = 0; i < clones; ++i)
+		delete gbs[i];
+
+	double const deleteUsecs = (secondsNow() - t0) * 1e6 / clones;
+	std::vector<char> state;
+	t0 = secondsNow();
+	for (unsigned i = 0; i < clones; ++i) {
+		a.gb().saveStateRaw(state);
+		gbs[i] = new gambatte::GB;
+		gbs[i]->load(romfile);
+		gbs[i]->loadState(&state[0], state.size());
+	}
+
+	double const reloadUsecs = (secondsNow() - t0) * 1e6 / clones;
+	for (unsigned i = 0; i < clones; ++i)
+		delete gbs[i];
+
+	// The clone must run exactly like the instance it was cloned from, which in
+	// turn must run exactly like one that was never cloned. A clone with
+	// different input must diverge, which checks that they do not share RAM.
+	Emulator *const b = a.clone();
+	Emulator c(a.gb().clone(), 2, half);
+	unsigned mismatches = 0;
+	bool diverged = false;
+	for (unsigned i = half; i < frames; ++i) {
+		unsigned long const hash = ref.runFrame();
+		mismatches += a.runFrame() != hash;
+		mismatches += b->runFrame() != hash;
+		c.runFrame();
+		gambatte::uint_least64_t const stateHash = ref.gb().stateHash();
+		mismatches += a.gb().stateHash() != stateHash;
+		mismatches += b->gb().stateHash() != stateHash;
+		diverged |= c.gb().stateHash() != stateHash;
+	}
+
+	delete b;
+	bool const ok = !mismatches && diverged;
+	std::printf("%-28s %9.1f %9.1f %9.1f %10u %9s  %s\n", desc, cloneUsecs, deleteUsecs,
+	            reloadUsecs, mismatches, diverged ? "yes" : "NO", ok ? "ok" : "FAILED");
+	return ok;
+}
+
+} // anon ns
+
+int main(int const argc, char *argv[]) {
+	unsigned frames = 600;
+	unsigned clones = 1000;
+	std::vector<char const *> romfiles;
+
+	for (int i = 1; i < argc; ++i) {
+		if (!std::strcmp(argv[i], "-f") && i + 1 < argc) {
+			frames = std::max(std::atoi(argv[++i]), 2);
+		} else if (!std::strcmp(argv[i], "-n") && i + 1 < argc) {
+			clones = std::max(std::atoi(argv[++i]), 1);
+		} else if (argv[i][0] != '-') {
+			romfiles.push_back(argv[i]);
+		} else {
+			std::puts("Usage: clonebench [-f frames] [-n clones] [romfile]...\n"
+			          "  Measures GB::clone and deleting a clone, against loading the ROM\n"
+			          "  image and a raw state into a new instance. Checks that clones\n"
+			          "  made half-way through a run produce the same video, audio and\n"
+			          "  state hashes as the original and as a run that was never cloned,\n"
+			          "  and that a clone given different input diverges. Runs a ROM image\n"
+			          "  that reads the joypad, and the given ROM images with pseudo-random\n"
+			          "  input.");
+			return EXIT_FAILURE;
+		}
+	}
+
+	std::string const tmprom = tempPath("clonebench.gb");
+	if (!writeRom(tmprom, makeDualJoypadRom()))
+		return EXIT_FAILURE;
+
+	std::printf("%-28s %9s %9s %9s %10s %9s\n", "rom", "clone_us", "delete_us",
+	            "reload_us", "mismatches", "diverged");
+	bool ok = bench(tmprom.c_str(), "joypad to WRAM", frames, clones);
+	std::remove(tmprom.c_str());
+
+	for (std::size_t i = 0; i < romfiles.size(); ++i)
+		ok &= bench(romfiles[i], romfiles[i], frames, clones);
+
+	return ok ? 0 : EXIT_FAILURE;
+}
@@ -0,0 +1,167 @@
+#include "benchutil.h"
+#include "gambatte.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::size_t const page_size = 0x100;
+
+void runFrame(gambatte::GB &gb, std::vector<gambatte::uint_least32_t> &audiobuf) {
+	for (;;) {
+		std::size_t samples = samples_per_frame;
+		if (gb.runFor(0, gb_width, &audiobuf[0], samples) >= 0)
+			break;
+	}
+}
+
+// A ROM image that increments the bytes of 0x400 bytes of WRAM bank 0 over and
+// over, so that a few pages change every frame.
+std::vector<unsigned char> makeBusyRom() {
+	unsigned char const code[] = {
+		0xF3,             // di
+		0x21, 0x00, 0xC1, // ld hl, $C100
+		0x34,             // inc (hl)
+		0x23,             // inc hl
+		0x7C,             // ld a, h
+		0xFE, 0xC5,       // cp $C5
+		0x20, 0xF9,       // jr nz, -7
+		0x18, 0xF4        // jr -12
+	};
+	return makeRom(code, sizeof code);
+}
+
+unsigned long get24(std::vector<char> const &s, std::size_t pos) {
+	return (s[pos] & 0xFFul) << 16 | (s[pos + 1] & 0xFFul) << 8 | (s[pos + 2] & 0xFFul);
+}
+
+// VRAM, SRAM and WRAM back to back, extracted from a labelled state.
+std::vector<char> ramOf(std::vector<char> const &state) {
+	std::vector<char> vram, sram, wram;
+	std::size_t pos = 2;
+	pos += 3 + get24(state, pos);
+	while (pos < state.size()) {
+		std::string const label(&state[pos]);
+		pos += label.size() + 1;
+		std::size_t const size = get24(state, pos);
+		pos += 3;
+
+		std::vector<char> *const dst = label == "vram" ? &vram
+		                             : label == "sram" ? &sram
+		                             : label == "wram" ? &wram : 0;
+		if (dst)
+			dst->assign(state.begin() + pos, state.begin() + pos + size);
+
+		pos += size;
+	}
+
+	vram.insert(vram.end(), sram.begin(), sram.end());
+	vram.insert(vram.end(), wram.begin(), wram.end());
+	return vram;
+}
+
+// Checks that every page that differs between prev and cur is in dirty.
+bool covered(std::vector<char> const &prev, std::vector<char> const &cur,
+		std::vector<unsigned> const &dirty) {
+	std::vector<bool> isDirty(cur.size() / page_size);
+	for (std::size_t i = 0; i < dirty.size(); ++i)
+		isDirty.at(dirty[i]) = true;
+
+	for (std::size_t i = 0; i < cur.size(); ++i) {
+		if (prev[i] != cur[i] && !isDirty[i / page_size])
+			return false;
+	}
+
+	return true;
+}
+
+bool bench(char const *romfile, char const *desc, unsigned frames) {
+	gambatte::GB gb;
+	if (gb.load(romfile)) {
+		std::fprintf(stderr, "Failed to load ROM image file %s\n", romfile);
+		return false;
+	}
+
+	std::vector<gambatte::uint_least32_t> audiobuf(audiobuf_size);
+	std::vector<char> start;
+	gb.saveStateRaw(start);
+
+	double t0 = secondsNow();
+	for (unsigned i = 0; i < frames; ++i)
+		runFrame(gb, audiobuf);
+
+	double const offUsecs = (secondsNow() - t0) * 1e6 / frames;
+
+	gb.loadState(&start[0], start.size());
+	gb.setDirtyTracking(true);
+	gb.clearDirtyPages();
+	t0 = secondsNow();
+	for (unsigned i = 0; i < frames; ++i)
+		runFrame(gb, audiobuf);
+
+	double const onUsecs = (secondsNow() - t0) * 1e6 / frames;
+
+	gb.loadState(&start[0], start.size());
+	std::vector<char> state;
+	gb.saveState(state);
+	std::vector<char> prev = ramOf(state);
+	std::vector<unsigned> dirty;
+	unsigned long dirtySum = 0;
+	bool ok = true;
+	gb.clearDirtyPages();
+	for (unsigned i = 0; i < frames; ++i) {
+		runFrame(gb, audiobuf);
+		gb.dirtyPages(dirty);
+		gb.clearDirtyPages();
+		gb.saveState(state);
+		std::vector<char> const cur = ramOf(state);
+		ok &= covered(prev, cur, dirty);
+		dirtySum += dirty.size();
+		prev = cur;
+	}
+
+	std::printf("%-36s %9.1f %9.1f %9.1f %9lu  %s\n", desc, offUsecs, onUsecs,
+	            double(dirtySum) / frames, static_cast<unsigned long>(prev.size() / page_size),
+	            ok ? "yes" : "NO");
+	return ok;
+}
+
+} // anon ns
+
+int main(int const argc, char *argv[]) {
+	unsigned frames = 1200;
+	std::vector<char const *> romfiles;
+
+	for (int i = 1; i < argc; ++i) {
+		if (!std::strcmp(argv[i], "-f") && i + 1 < argc) {
+			frames = std::max(std::atoi(argv[++i]), 1);
+		} else if (argv[i][0] != '-') {
+			romfiles.push_back(argv[i]);
+		} else {
+			std::puts("Usage: dirtybench [-f frames] [romfile]...\n"
+			          "  Measures emulation speed with dirty page tracking off and on, and\n"
+			          "  the number of 256-byte pages written per frame, for a ROM image\n"
+			          "  that keeps writing to WRAM and for the given ROM images run without\n"
+			          "  input. Checks that every page that changed between frames was\n"
+			          "  reported dirty.");
+			return EXIT_FAILURE;
+		}
+	}
+
+	std::string const tmprom = tempPath("dirtybench.gb");
+	if (!writeRom(tmprom, makeBusyRom()))
+		return EXIT_FAILURE;
+
+	std::printf("%-36s %9s %9s %9s %9s  %s\n", "rom", "off_us", "on_us", "dirty",
+	            "pages", "covered");
+	bool ok = bench(tmprom.c_str(), "1 KiB of WRAM changing", frames);
+	std::remove(tmprom.c_str());
+
+	for (std::size_t i = 0; i < romfiles.size(); ++i)
+		ok &= bench(romfiles[i], romfiles[i], frames);
+
+	return ok ? 0 : EXIT_FAILURE;
+}
@@ -0,0 +1,165 @@
+#include "benchutil.h"
+#include "gambatte.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+// A ROM image that switches the LCD off in the middle of every eighth frame and
+// back on right away, which makes the next frame last about three times as
+// long, and otherwise counts frames into the background palette.
+std::vector<unsigned char> makeLcdToggleRom() {
+	unsigned char const code[] = {
+		0xF3,             // di
+		0x06, 0x00,       // ld b, 0
+		0xF0, 0x44,       // ldh a, ($44)    ; wait for line 72
+		0xFE, 0x48,       // cp 72
+		0x20, 0xFA,       // jr nz, -6
+		0x04,             // inc b
+		0x78,             // ld a, b
+		0xE0, 0x47,       // ldh ($47), a
+		0xE6, 0x07,       // and 7
+		0x20, 0x08,       // jr nz, +8
+		0x3E, 0x11,       // ld a, $11       ; lcd off
+		0xE0, 0x40,       // ldh ($40), a
+		0x3E, 0x91,       // ld a, $91       ; lcd on
+		0xE0, 0x40,       // ldh ($40), a
+		0xF0, 0x44,       // ldh a, ($44)    ; wait for line 73
+		0xFE, 0x49,       // cp 73
+		0x20, 0xFA,       // jr nz, -6
+		0x18, 0xE2        // jr -30
+	};
+	return makeRom(code, sizeof code);
+}
+
+struct Run {
+	double secs;
+	unsigned long audioHash;
+	unsigned long videoHash;
+	gambatte::uint_least64_t stateHash;
+	std::size_t maxFrameSamples;
+
+	Run() : secs(0), audioHash(fnv1a_basis), videoHash(fnv1a_basis), stateHash(0),
+	        maxFrameSamples(0) {}
+
+	bool operator==(Run const &r) const {
+		return audioHash == r.audioHash && videoHash == r.videoHash
+		    && stateHash == r.stateHash;
+	}
+
+	void hashAudio(gambatte::uint_least32_t const *buf, std::size_t samples) {
+		audioHash = fnv1a(audioHash, buf, samples);
+	}
+
+	void hashVideo(std::vector<gambatte::uint_least32_t> const &buf) {
+		for (std::size_t i = 0; i < buf.size(); i += 7)
+			videoHash = ((videoHash ^ buf[i]) * 16777619ul) & 0xFFFFFFFF;
+	}
+};
+
+enum Method { method_runfor, method_runframe, method_runframe_noaudio };
+
+// With runFor, a frame's audio is whatever was produced until runFor reports the
+// frame done, which the caller collects across calls, as frontends do.
+Run runFrames(char const *romfile, Method method, unsigned frames, bool hash) {
+	Run run;
+	gambatte::GB gb;
+	if (gb.load(romfile, gambatte::GB::NO_SAVEDATA))
+		return run;
+
+	std::vector<gambatte::uint_least32_t> videobuf(gb_width * gb_height);
+	std::vector<gambatte::uint_least32_t> audiobuf(method == method_runfor
+		? audiobuf_size
+		: std::size_t(gambatte::GB::max_frame_samples));
+	double const t0 = secondsNow();
+	for (unsigned frame = 0; frame < frames; ++frame) {
+		std::size_t frameSamples = 0;
+		if (method == method_runfor) {
+			for (;;) {
+				std::size_t samples = samples_per_frame;
+				bool const done = gb.runFor(&videobuf[0], gb_width, &audiobuf[0], samples) >= 0;
+				frameSamples += samples;
+				if (hash)
+					run.hashAudio(&audiobuf[0], samples);
+				if (done)
+					break;
+			}
+		} else if (method == method_runframe) {
+			for (bool done = false; !done;) {
+				std::size_t samples;
+				done = gb.runFrame(&videobuf[0], gb_width, &audiobuf[0], samples);
+				frameSamples += samples;
+				if (hash)
+					run.hashAudio(&audiobuf[0], samples);
+			}
+		} else
+			gb.runFrame(&videobuf[0], gb_width);
+
+		run.maxFrameSamples = std::max(run.maxFrameSamples, frameSamples);
+		if (hash)
+			run.hashVideo(videobuf);
+	}
+
+	run.secs = secondsNow() - t0;
+	run.stateHash = gb.stateHash();
+	return run;
+}
+
+} // anon ns
+
+int main(int const argc, char *argv[]) {
+	unsigned frames = 600;
+	std::vector<char const *> romfiles;
+
+	for (int i = 1; i < argc; ++i) {
+		if (!std::strcmp(argv[i], "-f") && i + 1 < argc) {
+			frames = std::max(std::atoi(argv[++i]), 1);
+		} else if (argv[i][0] != '-') {
+			romfiles.push_back(argv[i]);
+		} else {
+			std::puts("Usage: framebench [-f frames] [romfile]...\n"
+			          "  Runs frames video frames with runFor, collecting each frame's audio\n"
+			          "  across calls, with runFrame and with runFrame discarding audio, and\n"
+			          "  reports the time per frame of each. Checks that runFrame gives the\n"
+			          "  same video, audio and state as runFor, frame for frame, and that no\n"
+			          "  frame has more than GB::max_frame_samples samples. Uses a ROM image\n"
+			          "  that switches the LCD off and on mid-frame, and the given ROM images.");
+			return EXIT_FAILURE;
+		}
+	}
+
+	std::string const tmprom = tempPath("framebench.gb");
+	if (!writeRom(tmprom, makeLcdToggleRom()))
+		return EXIT_FAILURE;
+
+	romfiles.insert(romfiles.begin(), tmprom.c_str());
+	std::printf("%-12s %10s %10s %12s %11s %6s\n", "romfile", "runFor", "runFrame",
+	            "no audio", "max frame", "same");
+
+	bool ok = true;
+	for (std::size_t i = 0; i < romfiles.size(); ++i) {
+		Run const runFor = runFrames(romfiles[i], method_runfor, frames, true);
+		Run const runFrame = runFrames(romfiles[i], method_runframe, frames, true);
+		Run const noAudio = runFrames(romfiles[i], method_runframe_noaudio, frames, false);
+		Run const runForTimed = runFrames(romfiles[i], method_runfor, frames, false);
+		Run const runFrameTimed = runFrames(romfiles[i], method_runframe, frames, false);
+		bool const same = runFrame == runFor && noAudio.stateHash == runFor.stateHash
+		               && runFrame.maxFrameSamples == runFor.maxFrameSamples
+		               && runFrame.maxFrameSamples <= gambatte::GB::max_frame_samples;
+		ok &= same;
+
+		std::string name = romfiles[i];
+		name = name.substr(name.find_last_of('/') + 1).substr(0, 12);
+		std::printf("%-12s %7.1f us %7.1f us %9.1f us %11lu %6s\n", name.c_str(),
+		            runForTimed.secs / frames * 1e6, runFrameTimed.secs / frames * 1e6,
+		            noAudio.secs / frames * 1e6,
+		            static_cast<unsigned long>(runFrame.maxFrameSamples), same ? "yes" : "NO");
+	}
+
+	std::remove(tmprom.c_str());
+	return ok ? 0 : EXIT_FAILURE;
+}
@@ -0,0 +1,136 @@
+#include "benchutil.h"
+#include "gambatte.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+class Emulator {
+public:
+	Emulator(char const *romfile, unsigned long seed)
+	: input_(seed), frame_(0)
+	{
+		gb_.setInputGetter(&input_);
+		loaded_ = !gb_.load(romfile);
+	}
+
+	bool loaded() const { return loaded_; }
+	gambatte::GB & gb() { return gb_; }
+
+	void runFrame() {
+		input_.setFrame(frame_++);
+		runner_.runFrame(gb_);
+	}
+
+	void setFrame(unsigned long frame) { frame_ = frame; }
+
+private:
+	gambatte::GB gb_;
+	ScriptedInput input_;
+	FrameRunner runner_;
+	unsigned long frame_;
+	bool loaded_;
+};
+
+bool bench(char const *romfile, char const *desc, unsigned frames) {
+	Emulator a(romfile, 1), b(romfile, 1), c(romfile, 2);
+	if (!a.loaded() || !b.loaded() || !c.loaded()) {
+		std::fprintf(stderr, "Failed to load ROM image file %s\n", romfile);
+		return false;
+	}
+
+	// Identical runs, a run with different input, and a run that is only hashed
+	// at the end, which checks that hashing does not affect emulation.
+	std::vector<gambatte::uint_least64_t> hashes(frames);
+	unsigned mismatches = 0;
+	bool diverged = false;
+	double hashSecs = 0;
+	for (unsigned i = 0; i < frames; ++i) {
+		a.runFrame();
+		b.runFrame();
+		c.runFrame();
+		double const t0 = secondsNow();
+		hashes[i] = a.gb().stateHash();
+		hashSecs += secondsNow() - t0;
+		mismatches += b.gb().stateHash() != hashes[i];
+		diverged |= c.gb().stateHash() != hashes[i];
+	}
+
+	Emulator d(romfile, 1);
+	for (unsigned i = 0; i < frames; ++i)
+		d.runFrame();
+
+	bool const unhashedMatches = d.gb().stateHash() == hashes[frames - 1];
+
+	// Replaying from a state loaded halfway must give the same hashes. Loading
+	// recomputes some PPU fields, so the hash right after loading can differ.
+	unsigned const half = frames / 2;
+	Emulator e(romfile, 1);
+	for (unsigned i = 0; i < half; ++i)
+		e.runFrame();
+
+	std::vector<char> state;
+	e.gb().saveState(state);
+	Emulator f(romfile, 1);
+	f.gb().loadState(&state[0], state.size());
+	f.setFrame(half);
+	bool replayMatches = true;
+	for (unsigned i = half; i < frames; ++i) {
+		f.runFrame();
+		replayMatches &= f.gb().stateHash() == hashes[i];
+	}
+
+	double t0 = secondsNow();
+	for (unsigned i = 0; i < frames; ++i)
+		a.gb().saveState(state);
+
+	double const saveUsecs = (secondsNow() - t0) * 1e6 / frames;
+	bool const ok = !mismatches && unhashedMatches && replayMatches;
+	std::printf("%-28s %9.1f %9.1f %10u %9s %9s %9s  %s\n", desc,
+	            hashSecs * 1e6 / frames, saveUsecs, mismatches,
+	            unhashedMatches ? "yes" : "NO", replayMatches ? "yes" : "NO",
+	            diverged ? "yes" : "no", ok ? "ok" : "FAILED");
+	return ok;
+}
+
+} // anon ns
+
+int main(int const argc, char *argv[]) {
+	unsigned frames = 600;
+	std::vector<char const *> romfiles;
+
+	for (int i = 1; i < argc; ++i) {
+		if (!std::strcmp(argv[i], "-f") && i + 1 < argc) {
+			frames = std::max(std::atoi(argv[++i]), 1);
+		} else if (argv[i][0] != '-') {
+			romfiles.push_back(argv[i]);
+		} else {
+			std::puts("Usage: hashbench [-f frames] [romfile]...\n"
+			          "  Checks that two runs with identical input have identical state\n"
+			          "  hashes after every frame, that hashing does not affect emulation,\n"
+			          "  and that replaying from a loaded state reproduces the hashes.\n"
+			          "  Measures the cost of stateHash against saving state to memory,\n"
+			          "  and reports whether a run with different input diverged. Runs a\n"
+			          "  ROM image that reads the joypad, and the given ROM images with\n"
+			          "  pseudo-random input.");
+			return EXIT_FAILURE;
+		}
+	}
+
+	std::string const tmprom = tempPath("hashbench.gb");
+	if (!writeRom(tmprom, makeDualJoypadRom()))
+		return EXIT_FAILURE;
+
+	std::printf("%-28s %9s %9s %10s %9s %9s %9s\n", "rom", "hash_us", "save_us",
+	            "mismatches", "unhashed", "replay", "diverged");
+	bool ok = bench(tmprom.c_str(), "joypad to WRAM", frames);
+	std::remove(tmprom.c_str());
+
+	for (std::size_t i = 0; i < romfiles.size(); ++i)
+		ok &= bench(romfiles[i], romfiles[i], frames);
+
+	return ok ? 0 : EXIT_FAILURE;
+}
@@ -0,0 +1,36 @@
+.size 8000
+
+.text@100
+	jp lbegin
+
+.data@143
+	80
+
+.text@150
+lbegin:
+	xor a, a
+	ldff(1a), a
+	ld hl, ff30
+	ld b, 08
+lfillwaveram:
+	ld a, 01
+	ld(hl++), a
+	ld a, 23
+	ld(hl++), a
+	dec b
+	jrnz lfillwaveram
+	ld a, 77
+	ldff(24), a
+	ld a, 44
+	ldff(25), a
+	ld a, 80
+	ldff(1a), a
+	ld a, 60
+	ldff(1c), a
+	ld a, ff
+	ldff(1d), a
+	ld a, 87
+	ldff(1e), a
+limbo:
+	jr limbo
+
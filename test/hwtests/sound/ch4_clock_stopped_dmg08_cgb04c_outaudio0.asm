@@ -0,0 +1,23 @@
+.size 8000
+
+.text@100
+	jp lbegin
+
+.data@143
+	80
+
+.text@150
+lbegin:
+	ld a, 77
+	ldff(24), a
+	ld a, 88
+	ldff(25), a
+	ld a, f0
+	ldff(21), a
+	ld a, e0
+	ldff(22), a
+	ld a, 80
+	ldff(23), a
+limbo:
+	jr limbo
+
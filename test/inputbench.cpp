@@ -0,0 +1,214 @@
+#include "benchutil.h"
+#include "gambatte.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+unsigned long const cycles_per_frame = 70224;
+
+// A ROM image that does nothing but read the joypad, selecting the direction
+// keys and the action buttons in turn, and adds what it reads up at $C000.
+// That is four polls every 112 cycles.
+std::vector<unsigned char> makePollingRom() {
+	unsigned char const code[] = {
+		0xF3,             // di
+		0x3E, 0x20,       // ld a, $20
+		0xE0, 0x00,       // ldh ($00), a    ; direction keys
+		0xF0, 0x00,       // ldh a, ($00)
+		0x47,             // ld b, a
+		0x3E, 0x10,       // ld a, $10
+		0xE0, 0x00,       // ldh ($00), a    ; action buttons
+		0xF0, 0x00,       // ldh a, ($00)
+		0xA8,             // xor b
+		0x21, 0x00, 0xC0, // ld hl, $C000
+		0x86,             // add (hl)
+		0x77,             // ld (hl), a
+		0x18, 0xEB        // jr -21
+	};
+	return makeRom(code, sizeof code);
+}
+
+// Changes every few frames, all eight buttons.
+std::vector<gambatte::InputChange> makeScript(unsigned long frames) {
+	std::vector<gambatte::InputChange> script;
+	unsigned long rng = 1;
+	for (unsigned long frame = 0; frame < frames; frame += 1 + rng % 5) {
+		rng = (rng * 1103515245 + 12345) & 0x7FFFFFFF;
+		gambatte::InputChange const in = { frame, static_cast<unsigned>(rng >> 16 & 0xFF) };
+		script.push_back(in);
+	}
+
+	return script;
+}
+
+// Plays a script through the input getter, as the caller would without an input
+// timeline.
+class ScriptInput : public gambatte::InputGetter {
+public:
+	explicit ScriptInput(std::vector<gambatte::InputChange> const &script)
+	: polls(0), script_(script), next_(script.begin()), frame_(0), buttons_(0)
+	{
+		advance();
+	}
+
+	virtual unsigned operator()() { ++polls; return buttons_; }
+
+	void frameDone() {
+		++frame_;
+		advance();
+	}
+
+	unsigned long polls;
+
+private:
+	std::vector<gambatte::InputChange> const &script_;
+	std::vector<gambatte::InputChange>::const_iterator next_;
+	unsigned long frame_;
+	unsigned buttons_;
+
+	void advance() {
+		for (; next_ != script_.end() && next_->frame <= frame_; ++next_)
+			buttons_ = next_->buttons;
+	}
+};
+
+gambatte::uint_least64_t runCallback(char const *romfile,
+		std::vector<gambatte::InputChange> const &script, unsigned long frames,
+		unsigned long *polls = 0) {
+	gambatte::GB gb;
+	ScriptInput input(script);
+	gb.setInputGetter(&input);
+	gb.load(romfile, gambatte::GB::NO_SAVEDATA);
+	for (unsigned long f = 0; f < frames; ++f) {
+		gb.runFrame(0, gb_width);
+		input.frameDone();
+	}
+
+	if (polls)
+		*polls = input.polls;
+
+	return gb.stateHash();
+}
+
+gambatte::uint_least64_t runTimeline(char const *romfile,
+		std::vector<gambatte::InputChange> const &script, unsigned long frames) {
+	gambatte::GB gb;
+	gb.setInputTimeline(script);
+	gb.load(romfile, gambatte::GB::NO_SAVEDATA);
+	for (unsigned long f = 0; f < frames; ++f)
+		gb.runFrame(0, gb_width);
+
+	return gb.stateHash();
+}
+
+// Runs with runFor calls of uneven lengths until frames frames are done.
+void runForFrames(gambatte::GB &gb, unsigned long frames) {
+	std::vector<gambatte::uint_least32_t> audiobuf(audiobuf_size);
+	unsigned long rng = 2;
+	for (unsigned long done = 0; done < frames;) {
+		rng = (rng * 1103515245 + 12345) & 0x7FFFFFFF;
+		std::size_t samples = 100 + (rng >> 8) % 12000;
+		if (gb.runFor(0, gb_width, &audiobuf[0], samples) >= 0)
+			++done;
+	}
+}
+
+} // anon ns
+
+int main(int const argc, char *argv[]) {
+	unsigned frames = 600;
+
+	for (int i = 1; i < argc; ++i) {
+		if (!std::strcmp(argv[i], "-f") && i + 1 < argc) {
+			frames = std::max(std::atoi(argv[++i]), 1);
+		} else {
+			std::puts("Usage: inputbench [-f frames]\n"
+			          "  Checks GB::setInputTimeline on a ROM image that polls the joypad\n"
+			          "  thousands of times a frame: that a timeline gives the same states as\n"
+			          "  an input getter playing the same script, with runFrame, runFor and\n"
+			          "  runUntil, and that runAhead, clone and setInputGetter treat it as\n"
+			          "  documented. Then reports the time per frame of both.");
+			return EXIT_FAILURE;
+		}
+	}
+
+	std::string const tmprom = tempPath("inputbench.gb");
+	if (!writeRom(tmprom, makePollingRom()))
+		return EXIT_FAILURE;
+
+	using gambatte::GB;
+	char const *const romfile = tmprom.c_str();
+	std::vector<gambatte::InputChange> const script = makeScript(frames);
+	bool ok = true;
+	unsigned long polls = 0;
+	gambatte::uint_least64_t const callbackHash = runCallback(romfile, script, frames, &polls);
+	ok &= check("runFrame: same state as with an input getter",
+		runTimeline(romfile, script, frames) == callbackHash);
+	{
+		GB gb;
+		gb.setInputTimeline(script);
+		gb.load(romfile, GB::NO_SAVEDATA);
+		runForFrames(gb, frames);
+		ok &= check("runFor in uneven calls: same state, frames counted",
+			gb.stateHash() == callbackHash && gb.inputTimelineFrame() == frames);
+	}
+	{
+		// runUntil goes on past frames, which still count.
+		GB gb;
+		gb.setInputTimeline(script);
+		gb.load(romfile, GB::NO_SAVEDATA);
+		gb.runFrame(0, gb_width);
+		gambatte::RunCondition const none = { gambatte::RunCondition::none, 0, 0 };
+		std::vector<gambatte::uint_least32_t> audiobuf(audiobuf_size);
+		for (unsigned long f = 1; f + 1 < frames; ++f) {
+			std::size_t samples;
+			gb.runUntil(none, cycles_per_frame, 0, gb_width, &audiobuf[0], samples);
+		}
+
+		gb.runFrame(0, gb_width);
+		ok &= check("runUntil: same state, frames counted",
+			gb.stateHash() == callbackHash && gb.inputTimelineFrame() == frames);
+	}
+	{
+		GB gb;
+		gb.setInputTimeline(script);
+		gb.load(romfile, GB::NO_SAVEDATA);
+		runForFrames(gb, frames / 2);
+		gb.runAhead(3, 0, gb_width);
+		bool const runAheadKept = gb.inputTimelineFrame() == frames / 2;
+		GB *const clone = gb.clone();
+		runForFrames(gb, frames - frames / 2);
+		runForFrames(*clone, frames - frames / 2);
+		ok &= check("runAhead keeps the frame count, clone the timeline",
+			runAheadKept && gb.stateHash() == callbackHash
+			&& clone->stateHash() == callbackHash);
+		delete clone;
+
+		ScriptInput counter(script);
+		gb.setInputGetter(&counter);
+		gb.runFrame(0, gb_width);
+		unsigned long const getterPolls = counter.polls;
+		gb.setInputTimeline(script);
+		gb.runFrame(0, gb_width);
+		ok &= check("setInputGetter and setInputTimeline replace each other",
+			getterPolls > 0 && counter.polls == getterPolls && gb.inputTimelineFrame() == 1);
+	}
+
+	std::printf("\n%lu polls a frame\n", polls / frames);
+	std::printf("\n%-36s %12s\n", "", "us/frame");
+	double t0 = secondsNow();
+	runCallback(romfile, script, frames);
+	std::printf("%-36s %12.1f\n", "input getter", (secondsNow() - t0) / frames * 1e6);
+
+	t0 = secondsNow();
+	runTimeline(romfile, script, frames);
+	std::printf("%-36s %12.1f\n", "input timeline", (secondsNow() - t0) / frames * 1e6);
+
+	std::remove(tmprom.c_str());
+	return ok ? 0 : EXIT_FAILURE;
+}
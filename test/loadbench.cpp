@@ -0,0 +1,110 @@
+#include "benchutil.h"
+#include "gambatte.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+unsigned long get24(std::vector<char> const &s, std::size_t pos) {
+	return (s[pos] & 0xFFul) << 16 | (s[pos + 1] & 0xFFul) << 8 | (s[pos + 2] & 0xFFul);
+}
+
+// The labelled state with its fields in reverse order, which is what a state
+// from a version that orders them differently costs to load at worst.
+std::vector<char> reversed(std::vector<char> const &state) {
+	std::size_t pos = 2;
+	pos += 3 + get24(state, pos);
+	std::vector<std::size_t> fields;
+	while (pos < state.size()) {
+		fields.push_back(pos);
+		pos += std::strlen(&state[pos]) + 1;
+		pos += 3 + get24(state, pos);
+	}
+
+	fields.push_back(state.size());
+	std::vector<char> out(state.begin(), state.begin() + fields[0]);
+	for (std::size_t i = fields.size() - 1; i--;)
+		out.insert(out.end(), state.begin() + fields[i], state.begin() + fields[i + 1]);
+
+	return out;
+}
+
+double loadUsecs(gambatte::GB &gb, std::vector<char> const &state, unsigned loads, bool &ok) {
+	double const t0 = secondsNow();
+	for (unsigned i = 0; i < loads; ++i)
+		ok &= gb.loadState(&state[0], state.size());
+
+	return (secondsNow() - t0) * 1e6 / loads;
+}
+
+bool bench(char const *romfile, char const *desc, unsigned loads) {
+	gambatte::GB gb;
+	if (gb.load(romfile)) {
+		std::fprintf(stderr, "Failed to load ROM image file %s\n", romfile);
+		return false;
+	}
+
+	FrameRunner runner;
+	for (int i = 0; i < 60; ++i)
+		runner.runFrame(gb);
+
+	std::vector<char> labelled, raw;
+	gb.saveState(labelled);
+	gb.saveStateRaw(raw);
+	std::vector<char> const reordered = reversed(labelled);
+
+	// Every way of loading must give the same state.
+	bool ok = true;
+	double const inOrderUsecs = loadUsecs(gb, labelled, loads, ok);
+	gambatte::uint_least64_t const hash = gb.stateHash();
+	double const reorderedUsecs = loadUsecs(gb, reordered, loads, ok);
+	ok &= gb.stateHash() == hash;
+	double const rawUsecs = loadUsecs(gb, raw, loads, ok);
+	ok &= gb.stateHash() == hash;
+
+	std::printf("%-28s %9lu %10.2f %10.2f %10.2f  %s\n", desc,
+	            static_cast<unsigned long>(labelled.size()), inOrderUsecs, reorderedUsecs,
+	            rawUsecs, ok ? "ok" : "FAILED");
+	return ok;
+}
+
+} // anon ns
+
+int main(int const argc, char *argv[]) {
+	unsigned loads = 10000;
+	std::vector<char const *> romfiles;
+
+	for (int i = 1; i < argc; ++i) {
+		if (!std::strcmp(argv[i], "-n") && i + 1 < argc) {
+			loads = std::max(std::atoi(argv[++i]), 1);
+		} else if (argv[i][0] != '-') {
+			romfiles.push_back(argv[i]);
+		} else {
+			std::puts("Usage: loadbench [-n loads] [romfile]...\n"
+			          "  Measures GB::loadState from memory for a labelled state with its\n"
+			          "  fields in the order they are saved in, for the same state with its\n"
+			          "  fields in reverse order, and for a raw state. Checks that all three\n"
+			          "  give the same state. Runs a ROM image that spins, and the given ROM\n"
+			          "  images, for a second before saving.");
+			return EXIT_FAILURE;
+		}
+	}
+
+	std::string const tmprom = tempPath("loadbench.gb");
+	if (!writeRom(tmprom, makeIdleRom()))
+		return EXIT_FAILURE;
+
+	std::printf("%-28s %9s %10s %10s %10s\n", "rom", "bytes", "inorder_us",
+	            "reverse_us", "raw_us");
+	bool ok = bench(tmprom.c_str(), "idle", loads);
+	std::remove(tmprom.c_str());
+
+	for (std::size_t i = 0; i < romfiles.size(); ++i)
+		ok &= bench(romfiles[i], romfiles[i], loads);
+
+	return ok ? 0 : EXIT_FAILURE;
+}
@@ -0,0 +1,235 @@
+#include "benchutil.h"
+#include "gambatte.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+// A CGB ROM image with an MBC5 and four banks of cartridge RAM, that writes a
+// marker to VRAM bank 1, WRAM bank 3, cartridge RAM bank 2 and OAM, leaving
+// those banks mapped, and then increments the bytes at $C000 and $FF80 every
+// vblank interrupt.
+std::vector<unsigned char> makeMarkerRom() {
+	unsigned char const code[] = {
+		0xF3,             // di
+		0xAF,             // xor a
+		0xE0, 0x40,       // ldh ($40), a    ; lcd off
+		0x3C,             // inc a
+		0xE0, 0x4F,       // ldh ($4F), a    ; VRAM bank 1
+		0x3E, 0x5A,       // ld a, $5A
+		0xEA, 0x10, 0x80, // ld ($8010), a
+		0x3E, 0x03,       // ld a, 3
+		0xE0, 0x70,       // ldh ($70), a    ; WRAM bank 3
+		0x3E, 0xA5,       // ld a, $A5
+		0xEA, 0x20, 0xD0, // ld ($D020), a
+		0x3E, 0x0A,       // ld a, $0A
+		0xEA, 0x00, 0x00, // ld ($0000), a   ; enable cartridge RAM
+		0x3E, 0x02,       // ld a, 2
+		0xEA, 0x00, 0x40, // ld ($4000), a   ; cartridge RAM bank 2
+		0x3E, 0xC3,       // ld a, $C3
+		0xEA, 0x30, 0xA0, // ld ($A030), a
+		0x3E, 0x77,       // ld a, $77
+		0xEA, 0x40, 0xFE, // ld ($FE40), a
+		0x3E, 0x91,       // ld a, $91
+		0xE0, 0x40,       // ldh ($40), a    ; lcd on
+		0x3E, 0x01,       // ld a, $01
+		0xE0, 0xFF,       // ldh ($FF), a    ; enable the vblank interrupt
+		0xAF,             // xor a
+		0xE0, 0x0F,       // ldh ($0F), a
+		0xFB,             // ei
+		0x76,             // halt
+		0x00,             // nop
+		0x21, 0x00, 0xC0, // ld hl, $C000
+		0x34,             // inc (hl)
+		0xF0, 0x80,       // ldh a, ($80)
+		0x3C,             // inc a
+		0xE0, 0x80,       // ldh ($80), a
+		0x18, 0xF3        // jr -13
+	};
+	std::vector<unsigned char> rom = makeRom(code, sizeof code);
+	rom[0x40] = 0xD9; // reti
+	rom[0x143] = 0x80; // CGB
+	rom[0x147] = 0x1B; // MBC5+RAM+BATTERY
+	rom[0x149] = 0x03; // 4 RAM banks
+	return rom;
+}
+
+// Whether the size bytes from address on, as peek reads them, are the bytes
+// from data on.
+bool matchesPeek(gambatte::GB const &gb, unsigned address, unsigned char const *data,
+		std::size_t size) {
+	for (std::size_t i = 0; i < size; ++i) {
+		if (gb.peek(address + i) != data[i])
+			return false;
+	}
+
+	return true;
+}
+
+// Whether the switchable part of each area's address range, and the fixed part
+// where there is one, read through peek as the view says.
+bool viewsMatchPeek(gambatte::GB const &gb) {
+	using gambatte::GB;
+	gambatte::MemoryView const wram = gb.memoryView(GB::WRAM);
+	gambatte::MemoryView const vram = gb.memoryView(GB::VRAM);
+	gambatte::MemoryView const sram = gb.memoryView(GB::SRAM);
+	gambatte::MemoryView const oam = gb.memoryView(GB::OAM);
+	gambatte::MemoryView const hram = gb.memoryView(GB::HRAM);
+	return matchesPeek(gb, 0xC000, wram.data, wram.bankSize)
+	    && matchesPeek(gb, 0xD000, wram.data + wram.bank * wram.bankSize, wram.bankSize)
+	    && matchesPeek(gb, 0x8000, vram.data + vram.bank * vram.bankSize, vram.bankSize)
+	    && (sram.bank < 0
+	        || matchesPeek(gb, 0xA000, sram.data + sram.bank * sram.bankSize, sram.bankSize))
+	    && matchesPeek(gb, 0xFE00, oam.data, oam.size)
+	    && matchesPeek(gb, 0xFF80, hram.data, hram.size);
+}
+
+bool sameView(gambatte::MemoryView const &a, gambatte::MemoryView const &b) {
+	return a.data == b.data && a.size == b.size && a.bankSize == b.bankSize && a.bank == b.bank;
+}
+
+} // anon ns
+
+int main(int const argc, char *argv[]) {
+	unsigned frames = 600;
+
+	for (int i = 1; i < argc; ++i) {
+		if (!std::strcmp(argv[i], "-f") && i + 1 < argc) {
+			frames = std::max(std::atoi(argv[++i]), 1);
+		} else {
+			std::puts("Usage: memviewbench [-f frames]\n"
+			          "  Checks GB::memoryView on a ROM image that writes to switched banks of\n"
+			          "  each memory area: the sizes and banks of the views, that they read\n"
+			          "  as GB::peek does, and that they follow the emulation without being\n"
+			          "  asked for again. Then reports the time per frame of copying out WRAM,\n"
+			          "  VRAM, cartridge RAM, OAM and HRAM through the views and through peek.");
+			return EXIT_FAILURE;
+		}
+	}
+
+	std::string const tmprom = tempPath("memviewbench.gb");
+	if (!writeRom(tmprom, makeMarkerRom()))
+		return EXIT_FAILURE;
+
+	using gambatte::GB;
+	using gambatte::MemoryView;
+	char const *const romfile = tmprom.c_str();
+	bool ok = true;
+	{
+		GB gb;
+		MemoryView const none = gb.memoryView(GB::WRAM);
+		ok &= check("no ROM image: null, empty, no bank",
+			!none.data && none.size == 0 && none.bank == -1);
+
+		gb.load(romfile, GB::NO_SAVEDATA);
+		for (unsigned f = 0; f < 10; ++f)
+			gb.runFrame(0, gb_width);
+
+		MemoryView const wram = gb.memoryView(GB::WRAM);
+		MemoryView const vram = gb.memoryView(GB::VRAM);
+		MemoryView const sram = gb.memoryView(GB::SRAM);
+		MemoryView const oam = gb.memoryView(GB::OAM);
+		MemoryView const hram = gb.memoryView(GB::HRAM);
+		ok &= check("WRAM: 8 banks, bank 3 at $D000, marker in bank 3",
+			wram.size == 0x8000 && wram.bankSize == 0x1000 && wram.bank == 3
+			&& wram.data[0x3020] == 0xA5);
+		ok &= check("VRAM: 2 banks, bank 1 at $8000, marker in bank 1",
+			vram.size == 0x4000 && vram.bankSize == 0x2000 && vram.bank == 1
+			&& vram.data[0x2010] == 0x5A);
+		ok &= check("SRAM: 4 banks, bank 2 at $A000, marker in bank 2",
+			sram.size == 0x8000 && sram.bankSize == 0x2000 && sram.bank == 2
+			&& sram.data[0x4030] == 0xC3);
+		ok &= check("OAM and HRAM: sizes, OAM marker",
+			oam.size == 0xA0 && hram.size == 0x7F && oam.data[0x40] == 0x77);
+		ok &= check("views read as peek does", viewsMatchPeek(gb));
+
+		unsigned const counter = wram.data[0];
+		for (unsigned f = 0; f < 5; ++f)
+			gb.runFrame(0, gb_width);
+
+		ok &= check("views follow the emulation after runFrame",
+			wram.data[0] == ((counter + 5) & 0xFF) && gb.peek(0xC000) == wram.data[0]
+			&& hram.data[0] == gb.peek(0xFF80) && viewsMatchPeek(gb));
+
+		std::vector<char> state;
+		gb.saveState(state);
+		gb.reset(false);
+		gb.loadState(&state[0], state.size());
+		ok &= check("views stay the same across reset and loadState",
+			sameView(gb.memoryView(GB::WRAM), wram) && sameView(gb.memoryView(GB::VRAM), vram)
+			&& sameView(gb.memoryView(GB::SRAM), sram) && wram.data[0] == ((counter + 5) & 0xFF));
+
+		gb.load(romfile, GB::NO_SAVEDATA | GB::FORCE_DMG);
+		for (unsigned f = 0; f < 10; ++f)
+			gb.runFrame(0, gb_width);
+
+		MemoryView const dmgWram = gb.memoryView(GB::WRAM);
+		MemoryView const dmgVram = gb.memoryView(GB::VRAM);
+		ok &= check("DMG: 2 WRAM banks, bank 1; 1 VRAM bank, bank 0",
+			dmgWram.size == 0x2000 && dmgWram.bank == 1
+			&& dmgVram.size == 0x2000 && dmgVram.bank == 0);
+		ok &= check("DMG: views read as peek does", viewsMatchPeek(gb));
+	}
+
+	std::printf("\n%-36s %12s\n", "", "us/frame");
+	{
+		GB gb;
+		gb.load(romfile, GB::NO_SAVEDATA);
+		GB::MemoryArea const areas[] = { GB::WRAM, GB::VRAM, GB::SRAM, GB::OAM, GB::HRAM };
+		std::size_t const num_areas = sizeof areas / sizeof areas[0];
+		std::vector<unsigned char> out(0x8000 + 0x4000 + 0x8000 + 0xA0 + 0x7F);
+		unsigned long sum = 0;
+
+		double t0 = secondsNow();
+		for (unsigned f = 0; f < frames; ++f)
+			gb.runFrame(0, gb_width);
+
+		double const frameSecs = secondsNow() - t0;
+		std::printf("%-36s %12.1f\n", "runFrame", frameSecs / frames * 1e6);
+
+		MemoryView views[num_areas];
+		for (std::size_t a = 0; a < num_areas; ++a)
+			views[a] = gb.memoryView(areas[a]);
+
+		t0 = secondsNow();
+		for (unsigned f = 0; f < frames; ++f) {
+			gb.runFrame(0, gb_width);
+			unsigned char *o = &out[0];
+			for (std::size_t a = 0; a < num_areas; ++a) {
+				std::memcpy(o, views[a].data, views[a].size);
+				o += views[a].size;
+			}
+
+			sum += out[f % out.size()];
+		}
+
+		std::printf("%-36s %12.1f\n", "copy all banks from views",
+		            (secondsNow() - t0 - frameSecs) / frames * 1e6);
+
+		// peek only sees the mapped banks, so this copies less than the views do.
+		t0 = secondsNow();
+		for (unsigned f = 0; f < frames; ++f) {
+			gb.runFrame(0, gb_width);
+			unsigned char *o = &out[0];
+			for (unsigned p = 0x8000; p < 0xE000; ++p)
+				*o++ = gb.peek(p);
+			for (unsigned p = 0xFE00; p < 0xFEA0; ++p)
+				*o++ = gb.peek(p);
+			for (unsigned p = 0xFF80; p < 0xFFFF; ++p)
+				*o++ = gb.peek(p);
+
+			sum += out[f % out.size()];
+		}
+
+		std::printf("%-36s %12.1f\n", "copy mapped banks with peek",
+		            (secondsNow() - t0 - frameSecs) / frames * 1e6);
+		std::printf("(checksum %lu)\n", sum);
+	}
+
+	std::remove(tmprom.c_str());
+	return ok ? 0 : EXIT_FAILURE;
+}
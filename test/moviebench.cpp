@@ -0,0 +1,258 @@
+#include "batchrunner.h"
+#include "benchutil.h"
+#include "gambatte.h"
+#include "inputmovie.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+// A ROM image that keeps reading the action buttons, storing them at $C000 and
+// in the background palette, and adding them up at $C001, so that its state
+// depends on when each change of input is seen.
+std::vector<unsigned char> makeSummingJoypadRom() {
+	unsigned char const code[] = {
+		0xF3,             // di
+		0x3E, 0x10,       // ld a, $10
+		0xE0, 0x00,       // ldh ($00), a
+		0xF0, 0x00,       // ldh a, ($00)
+		0xEA, 0x00, 0xC0, // ld ($C000), a
+		0xE0, 0x47,       // ldh ($47), a
+		0x47,             // ld b, a
+		0xFA, 0x01, 0xC0, // ld a, ($C001)
+		0x80,             // add b
+		0xEA, 0x01, 0xC0, // ld ($C001), a
+		0x18, 0xEF        // jr -17
+	};
+	return makeRom(code, sizeof code);
+}
+
+long fileSize(std::string const &path) {
+	std::FILE *const f = std::fopen(path.c_str(), "rb");
+	if (!f)
+		return -1;
+
+	std::fseek(f, 0, SEEK_END);
+	long const size = std::ftell(f);
+	std::fclose(f);
+	return size;
+}
+
+// Input as a frontend sees it, changing whenever it likes.
+class LiveInput : public gambatte::InputGetter {
+public:
+	LiveInput() : buttons(0) {}
+	virtual unsigned operator()() { return buttons; }
+
+	unsigned buttons;
+};
+
+// Runs gb with runFor calls of uneven lengths until frameDone has been called
+// for frames frames. When live is given, its buttons change every few calls,
+// mid-frame.
+template<class Input>
+void runForFrames(gambatte::GB &gb, Input &input, unsigned long frames, LiveInput *live,
+		unsigned seed) {
+	std::vector<gambatte::uint_least32_t> audiobuf(audiobuf_size);
+	unsigned long rng = seed;
+	for (unsigned long done = 0, call = 0; done < frames; ++call) {
+		rng = (rng * 1103515245 + 12345) & 0x7FFFFFFF;
+		if (live && call % 11 == 0)
+			live->buttons = rng >> 16 & 0x0F;
+
+		std::size_t samples = 100 + (rng >> 8) % 12000;
+		if (gb.runFor(0, gb_width, &audiobuf[0], samples) >= 0) {
+			input.frameDone();
+			++done;
+		}
+	}
+}
+
+template<class Input>
+void runFrames(gambatte::GB &gb, Input &input, unsigned long frames) {
+	for (unsigned long f = 0; f < frames; ++f) {
+		gb.runFrame(0, gb_width);
+		input.frameDone();
+	}
+}
+
+class HashListener : public gambatte::BatchListener {
+public:
+	HashListener() : stateHash(0), romHash(0), ok(false) {}
+
+	virtual void jobDone(gambatte::BatchResult const &result) {
+		stateHash = result.stateHash;
+		romHash = result.romHash;
+		ok = result.loadres == gambatte::LOADRES_OK;
+	}
+
+	gambatte::uint_least64_t stateHash;
+	gambatte::uint_least64_t romHash;
+	bool ok;
+};
+
+} // anon ns
+
+int main(int const argc, char *argv[]) {
+	unsigned frames = 3000;
+
+	for (int i = 1; i < argc; ++i) {
+		if (!std::strcmp(argv[i], "-f") && i + 1 < argc) {
+			frames = std::max(std::atoi(argv[++i]), 1);
+		} else {
+			std::puts("Usage: moviebench [-f frames]\n"
+			          "  Records input that changes between uneven runFor calls on a ROM image\n"
+			          "  that adds up the buttons it reads, saves and loads the movie, and\n"
+			          "  checks that playing it back with runFor, runFrame and BatchRunner ends\n"
+			          "  in the state recording did. Then reports the movie file size and the\n"
+			          "  time per frame of playing it back.");
+			return EXIT_FAILURE;
+		}
+	}
+
+	std::string const romfile = tempPath("moviebench.gb");
+	std::string const otherRomfile = tempPath("moviebench_other.gb");
+	std::string const moviefile = tempPath("moviebench.gbm");
+	{
+		std::vector<unsigned char> rom = makeSummingJoypadRom();
+		if (!writeRom(romfile, rom))
+			return EXIT_FAILURE;
+
+		rom[0x7FFF] = 1;
+		if (!writeRom(otherRomfile, rom))
+			return EXIT_FAILURE;
+	}
+
+	using gambatte::GB;
+	using gambatte::InputMovie;
+	bool ok = true;
+	InputMovie recorded;
+	gambatte::uint_least64_t recordedHash = 0;
+	{
+		GB gb;
+		gb.load(romfile, GB::NO_SAVEDATA);
+		for (unsigned f = 0; f < 30; ++f)
+			gb.runFrame(0, gb_width);
+
+		LiveInput live;
+		gambatte::InputMovieRecorder recorder(live);
+		ok &= check("recorder starts from a running instance", recorder.start(gb, GB::NO_SAVEDATA));
+		runForFrames(gb, recorder, frames, &live, 1);
+		recordedHash = gb.stateHash();
+		recorded = recorder.movie();
+		ok &= check("recorder counts frames and keeps only changes",
+			recorded.frames == frames && recorded.input.size() > 1
+			&& recorded.input.size() < frames && recorded.romHash == gb.romHash());
+	}
+
+	InputMovie loaded;
+	ok &= check("movie saves and loads back unchanged",
+		gambatte::saveInputMovie(recorded, moviefile)
+		&& gambatte::loadInputMovie(loaded, moviefile)
+		&& loaded.romHash == recorded.romHash && loaded.loadFlags == recorded.loadFlags
+		&& loaded.frames == recorded.frames && loaded.startState == recorded.startState
+		&& loaded.input.size() == recorded.input.size()
+		&& std::equal(loaded.input.begin(), loaded.input.end(), recorded.input.begin(),
+		              [](gambatte::InputChange const &a, gambatte::InputChange const &b) {
+		                  return a.frame == b.frame && a.buttons == b.buttons; }));
+	{
+		std::string const truncated = tempPath("moviebench_truncated.gbm");
+		std::FILE *const in = std::fopen(moviefile.c_str(), "rb");
+		std::vector<char> data(fileSize(moviefile));
+		bool const read = in && std::fread(&data[0], 1, data.size(), in) == data.size();
+		if (in)
+			std::fclose(in);
+
+		std::FILE *const out = std::fopen(truncated.c_str(), "wb");
+		if (out) {
+			std::fwrite(&data[0], 1, data.size() - 1, out);
+			std::fclose(out);
+		}
+
+		InputMovie m;
+		ok &= check("truncated movie fails to load",
+			read && out && !gambatte::loadInputMovie(m, truncated));
+		std::remove(truncated.c_str());
+	}
+
+	{
+		GB gb;
+		gb.load(romfile, loaded.loadFlags);
+		gambatte::InputMoviePlayer player(loaded);
+		bool const started = player.start(gb);
+		runFrames(gb, player, loaded.frames);
+		ok &= check("runFrame playback ends in the recorded state",
+			started && player.done() && gb.stateHash() == recordedHash);
+
+		gb.load(romfile, loaded.loadFlags);
+		bool const restarted = player.start(gb);
+		runForFrames(gb, player, loaded.frames, 0, 2);
+		ok &= check("runFor playback, split differently, ends there too",
+			restarted && gb.stateHash() == recordedHash);
+
+		gb.load(otherRomfile, loaded.loadFlags);
+		ok &= check("playback does not start on another ROM image", !player.start(gb));
+	}
+
+	{
+		std::vector<gambatte::BatchJob> jobs(1);
+		jobs[0].romfile = romfile;
+		jobs[0].loadFlags = loaded.loadFlags;
+		jobs[0].frames = loaded.frames;
+		jobs[0].input = loaded.input;
+		jobs[0].startState = loaded.startState;
+		gambatte::BatchRunner runner(1);
+		HashListener listener;
+		runner.run(jobs, listener);
+		ok &= check("BatchRunner playback ends in the recorded state",
+			listener.ok && listener.stateHash == recordedHash
+			&& listener.romHash == loaded.romHash);
+	}
+
+	long const movieSize = fileSize(moviefile);
+	long const inputSize = movieSize - long(loaded.startState.size());
+	std::printf("\n%lu frames, %lu input changes: movie file %ld bytes, of which %ld input\n",
+	            loaded.frames, static_cast<unsigned long>(loaded.input.size()),
+	            movieSize, inputSize);
+	ok &= check("input takes at most 2 bytes a change, after a 29 byte header",
+		inputSize <= 29 + 2 * long(loaded.input.size()));
+
+	std::printf("\n%-36s %12s\n", "", "us/frame");
+	{
+		GB gb;
+		gb.load(romfile, loaded.loadFlags);
+		gambatte::InputMoviePlayer player(loaded);
+		player.start(gb);
+		double t0 = secondsNow();
+		runFrames(gb, player, loaded.frames);
+		std::printf("%-36s %12.1f\n", "play back with runFrame", (secondsNow() - t0) / frames * 1e6);
+
+		player.start(gb);
+		t0 = secondsNow();
+		runForFrames(gb, player, loaded.frames, 0, 2);
+		std::printf("%-36s %12.1f\n", "play back with runFor", (secondsNow() - t0) / frames * 1e6);
+	}
+
+	{
+		std::vector<gambatte::BatchJob> jobs(1);
+		jobs[0].romfile = romfile;
+		jobs[0].loadFlags = loaded.loadFlags;
+		jobs[0].frames = loaded.frames;
+		jobs[0].input = loaded.input;
+		jobs[0].startState = loaded.startState;
+		gambatte::BatchRunner runner(1);
+		HashListener listener;
+		double const t0 = secondsNow();
+		runner.run(jobs, listener);
+		std::printf("%-36s %12.1f\n", "play back with BatchRunner", (secondsNow() - t0) / frames * 1e6);
+	}
+
+	std::remove(romfile.c_str());
+	std::remove(otherRomfile.c_str());
+	std::remove(moviefile.c_str());
+	return ok ? 0 : EXIT_FAILURE;
+}
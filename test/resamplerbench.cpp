@@ -0,0 +1,300 @@
+#include "benchutil.h"
+#include "gambatte.h"
+#include "resample/resampler.h"
+#include "resample/resamplerinfo.h"
+#include "scoped_ptr.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+long const gb_native_rate = 2097152;
+long const out_rates[] = { 32000, 44100, 48000, 96000 };
+std::size_t const num_out_rates = sizeof out_rates / sizeof out_rates[0];
+double const PI = 3.14159265358979323846;
+
+// Interleaved stereo samples at the native rate.
+typedef std::vector<short> Signal;
+
+void makeSine(Signal &out, std::size_t len, double freq) {
+	out.resize(len * 2);
+	double const w = 2 * PI * freq / gb_native_rate;
+	for (std::size_t i = 0; i < len; ++i)
+		out[i * 2] = out[i * 2 + 1] = static_cast<short>(std::floor(16384 * std::sin(w * i) + 0.5));
+}
+
+// Approximates what the PSG produces: two unfiltered pulse channels and a noise channel
+// clocked by a 15-bit LFSR, all stepping at native rate with no band limitation.
+void makeSynthPsg(Signal &out, std::size_t len) {
+	out.resize(len * 2);
+	unsigned long const period1 = 2 * 4 * (0x800 - 0x783); // ~1 kHz, 12.5% duty
+	unsigned long const period2 = 2 * 4 * (0x800 - 0x6D6); // ~440 Hz, 50% duty
+	unsigned long const noisePeriod = 2 * 8 << 2;
+	unsigned lfsr = 0x7FFF;
+	for (std::size_t i = 0; i < len; ++i) {
+		if (i % noisePeriod == 0) {
+			unsigned const xored = (lfsr ^ lfsr >> 1) & 1;
+			lfsr = lfsr >> 1 | xored << 14;
+		}
+
+		int const ch1 = i % period1 < period1 / 8 ? 15 : -15;
+		int const ch2 = i % period2 < period2 / 2 ? 15 : -15;
+		int const ch4 = lfsr & 1 ? -7 : 7;
+		out[i * 2    ] = (ch1 + ch4) * 512;
+		out[i * 2 + 1] = (ch2 + ch4) * 512;
+	}
+}
+
+// Real PSG output from the first frames of a ROM image, played without input.
+bool makeRomPsg(Signal &out, std::size_t len, char const *romfile) {
+	gambatte::GB gb;
+	if (gb.load(romfile))
+		return false;
+
+	std::vector<gambatte::uint_least32_t> audiobuf(audiobuf_size);
+	out.clear();
+	out.reserve(len * 2 + audiobuf.size() * 2);
+	while (out.size() < len * 2) {
+		std::size_t samples = samples_per_frame;
+		gb.runFor(0, gb_width, &audiobuf[0], samples);
+		short const *const s = reinterpret_cast<short const *>(&audiobuf[0]);
+		out.insert(out.end(), s, s + samples * 2);
+	}
+
+	out.resize(len * 2);
+	return true;
+}
+
+struct ThroughputResult {
+	double constructUsecs;
+	double reconstructUsecs;
+	double inSamplesPerSec;
+	double avgCallUsecs;
+	double maxCallUsecs;
+	std::size_t maxOut;
+	std::size_t maxProduced;
+	std::size_t maxOutViolations;
+};
+
+ThroughputResult measureThroughput(ResamplerInfo const &info, long outRate,
+                                   Signal const &in, std::size_t periodSize) {
+	ThroughputResult r = ThroughputResult();
+	double const t0 = secondsNow();
+	scoped_ptr<Resampler> const resampler(info.create(gb_native_rate, outRate, periodSize));
+	r.constructUsecs = (secondsNow() - t0) * 1e6;
+	r.maxOut = resampler->maxOut(periodSize);
+
+	std::vector<short> outbuf((r.maxOut + 1) * 2);
+	std::size_t const len = in.size() / 2;
+	std::size_t calls = 0;
+	double total = 0;
+	for (std::size_t pos = 0; pos < len; pos += periodSize) {
+		std::size_t const inlen = std::min(periodSize, len - pos);
+		double const start = secondsNow();
+		std::size_t const produced = resampler->resample(&outbuf[0], &in[pos * 2], inlen);
+		double const t = secondsNow() - start;
+		total += t;
+		r.maxCallUsecs = std::max(r.maxCallUsecs, t * 1e6);
+		r.maxProduced = std::max(r.maxProduced, produced);
+		r.maxOutViolations += produced > resampler->maxOut(inlen);
+		++calls;
+	}
+
+	r.inSamplesPerSec = total > 0 ? len / total : 0;
+	r.avgCallUsecs = calls ? total * 1e6 / calls : 0;
+	return r;
+}
+
+// Construction time of a resampler with the same parameters as one that was just
+// destroyed, as happens on audio reconfiguration.
+double measureReconstruction(ResamplerInfo const &info, long outRate, std::size_t periodSize) {
+	delete info.create(gb_native_rate, outRate, periodSize);
+	double const t0 = secondsNow();
+	scoped_ptr<Resampler> const resampler(info.create(gb_native_rate, outRate, periodSize));
+	return (secondsNow() - t0) * 1e6;
+}
+
+std::size_t resampleAll(std::vector<short> &out, Resampler &resampler,
+                        Signal const &in, std::size_t periodSize) {
+	std::size_t const len = in.size() / 2;
+	out.resize((len / periodSize + 1) * (resampler.maxOut(periodSize) + 1) * 2);
+	std::size_t outlen = 0;
+	for (std::size_t pos = 0; pos < len; pos += periodSize) {
+		outlen += resampler.resample(&out[outlen * 2], &in[pos * 2],
+		                             std::min(periodSize, len - pos));
+	}
+
+	out.resize(outlen * 2);
+	return outlen;
+}
+
+double signalPower(std::vector<short> const &s, std::size_t begin) {
+	double sum = 0;
+	std::size_t const len = s.size() / 2;
+	for (std::size_t i = begin; i < len; ++i)
+		sum += double(s[i * 2]) * s[i * 2];
+
+	return len > begin ? sum / (len - begin) : 0;
+}
+
+// Least squares fit of a*sin(wn) + b*cos(wn) + c to the left channel, starting at
+// 'begin' to skip the filter transient. Returns the SNR in dB of the fitted tone
+// versus the residual.
+double toneSnr(std::vector<short> const &s, std::size_t begin, double w) {
+	double m[3][3] = { { 0 } };
+	double v[3] = { 0 };
+	std::size_t const len = s.size() / 2;
+	for (std::size_t i = begin; i < len; ++i) {
+		double const basis[3] = { std::sin(w * i), std::cos(w * i), 1 };
+		for (int r = 0; r < 3; ++r) {
+			v[r] += basis[r] * s[i * 2];
+			for (int c = 0; c < 3; ++c)
+				m[r][c] += basis[r] * basis[c];
+		}
+	}
+
+	double coef[3];
+	double const det = m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1])
+	                 - m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0])
+	                 + m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+	for (int k = 0; k < 3; ++k) {
+		double a[3][3];
+		std::memcpy(a, m, sizeof a);
+		for (int r = 0; r < 3; ++r)
+			a[r][k] = v[r];
+
+		coef[k] = (a[0][0] * (a[1][1] * a[2][2] - a[1][2] * a[2][1])
+		         - a[0][1] * (a[1][0] * a[2][2] - a[1][2] * a[2][0])
+		         + a[0][2] * (a[1][0] * a[2][1] - a[1][1] * a[2][0])) / det;
+	}
+
+	double sig = 0, noise = 0;
+	for (std::size_t i = begin; i < len; ++i) {
+		double const fit = coef[0] * std::sin(w * i) + coef[1] * std::cos(w * i) + coef[2];
+		double const err = s[i * 2] - fit;
+		sig += fit * fit;
+		noise += err * err;
+	}
+
+	return 10 * std::log10(sig / std::max(noise, 1e-9));
+}
+
+double exactOutRate(Resampler const &resampler) {
+	unsigned long mul, div;
+	resampler.exactRatio(mul, div);
+	return double(gb_native_rate) * mul / div;
+}
+
+struct QualityResult {
+	double snr1k;
+	double snrHigh;
+	double aliasRejection;
+};
+
+QualityResult measureQuality(ResamplerInfo const &info, long outRate, std::size_t periodSize) {
+	QualityResult q;
+	std::size_t const len = gb_native_rate / 2;
+	std::size_t const skip = outRate / 20;
+	Signal in;
+	std::vector<short> out;
+
+	{
+		makeSine(in, len, 1000);
+		scoped_ptr<Resampler> const r(info.create(gb_native_rate, outRate, periodSize));
+		resampleAll(out, *r, in, periodSize);
+		q.snr1k = toneSnr(out, skip, 2 * PI * 1000 / exactOutRate(*r));
+	}
+	{
+		double const freq = std::min(0.4 * outRate, 16000.0);
+		makeSine(in, len, freq);
+		scoped_ptr<Resampler> const r(info.create(gb_native_rate, outRate, periodSize));
+		resampleAll(out, *r, in, periodSize);
+		q.snrHigh = toneSnr(out, skip, 2 * PI * freq / exactOutRate(*r));
+	}
+	{
+		// A tone above the output Nyquist frequency that would alias down into the
+		// audible band. Rejection is the output power relative to the input power.
+		double const freq = 0.75 * outRate;
+		makeSine(in, len, freq);
+		scoped_ptr<Resampler> const r(info.create(gb_native_rate, outRate, periodSize));
+		resampleAll(out, *r, in, periodSize);
+		double const inPower = 16384.0 * 16384.0 / 2;
+		q.aliasRejection = -10 * std::log10(std::max(signalPower(out, skip), 1e-9) / inPower);
+	}
+
+	return q;
+}
+
+void printUsage() {
+	std::puts("Usage: resamplerbench [-p period_samples] [-t seconds] [romfile]\n"
+	          "  Measures throughput, per-call latency, maxOut() headroom and tone\n"
+	          "  SNR/aliasing of each resampler at common output rates. PSG input is\n"
+	          "  taken from romfile if given, and synthesized otherwise. Fails if any\n"
+	          "  resampler produces more samples than maxOut() reports.");
+}
+
+} // anon ns
+
+int main(int const argc, char *argv[]) {
+	std::size_t periodSize = samples_per_frame;
+	double seconds = 5;
+	char const *romfile = 0;
+
+	for (int i = 1; i < argc; ++i) {
+		if (!std::strcmp(argv[i], "-p") && i + 1 < argc) {
+			periodSize = std::max(std::strtoul(argv[++i], 0, 0), 1ul);
+		} else if (!std::strcmp(argv[i], "-t") && i + 1 < argc) {
+			seconds = std::max(std::atof(argv[++i]), 0.1);
+		} else if (argv[i][0] != '-' && !romfile) {
+			romfile = argv[i];
+		} else {
+			printUsage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	Signal psg;
+	std::size_t const psgLen = static_cast<std::size_t>(seconds * gb_native_rate);
+	if (romfile) {
+		if (!makeRomPsg(psg, psgLen, romfile)) {
+			std::fprintf(stderr, "Failed to load ROM image file %s\n", romfile);
+			return EXIT_FAILURE;
+		}
+	} else
+		makeSynthPsg(psg, psgLen);
+
+	std::printf("input: %s, %.1f s at %ld Hz, period %lu samples\n\n",
+	            romfile ? romfile : "synthesized PSG", seconds, gb_native_rate,
+	            static_cast<unsigned long>(periodSize));
+	std::printf("%-34s %6s %9s %9s %9s %9s %9s %7s %7s %4s %7s %7s %7s\n",
+	            "resampler", "rate", "ctor_us", "rector_us", "Msmp/s", "avg_us", "max_us",
+	            "maxOut", "maxGot", "viol", "snr1k", "snrHi", "alias");
+
+	bool ok = true;
+	for (std::size_t n = 0; n < ResamplerInfo::num(); ++n) {
+		ResamplerInfo const &info = ResamplerInfo::get(n);
+		for (std::size_t i = 0; i < num_out_rates; ++i) {
+			ThroughputResult t = measureThroughput(info, out_rates[i], psg, periodSize);
+			t.reconstructUsecs = measureReconstruction(info, out_rates[i], periodSize);
+			QualityResult const q = measureQuality(info, out_rates[i], periodSize);
+			std::printf("%-34s %6ld %9.1f %9.1f %9.2f %9.1f %9.1f %7lu %7lu %4lu %7.1f %7.1f %7.1f\n",
+			            info.desc, out_rates[i], t.constructUsecs, t.reconstructUsecs,
+			            t.inSamplesPerSec / 1e6,
+			            t.avgCallUsecs, t.maxCallUsecs,
+			            static_cast<unsigned long>(t.maxOut),
+			            static_cast<unsigned long>(t.maxProduced),
+			            static_cast<unsigned long>(t.maxOutViolations),
+			            q.snr1k, q.snrHigh, q.aliasRejection);
+			ok &= t.maxOutViolations == 0;
+		}
+	}
+
+	if (!ok)
+		std::puts("\nFAILED: a resampler produced more samples than maxOut() reported");
+
+	return ok ? 0 : EXIT_FAILURE;
+}
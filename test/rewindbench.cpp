@@ -0,0 +1,112 @@
+#include "benchutil.h"
+#include "gambatte.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+double const frames_per_sec = 59.73;
+
+// A ROM image that increments every byte of WRAM bank 0 over and over, so that
+// all of it changes between frames.
+std::vector<unsigned char> makeBusyRom() {
+	unsigned char const code[] = {
+		0xF3,             // di
+		0x21, 0x00, 0xC0, // ld hl, $C000
+		0x34,             // inc (hl)
+		0x23,             // inc hl
+		0x7C,             // ld a, h
+		0xFE, 0xD0,       // cp $D0
+		0x20, 0xF9,       // jr nz, -7
+		0x18, 0xF4        // jr -12
+	};
+	return makeRom(code, sizeof code);
+}
+
+bool bench(char const *romfile, char const *desc, unsigned frames, std::size_t maxBytes) {
+	gambatte::GB gb;
+	if (gb.load(romfile)) {
+		std::fprintf(stderr, "Failed to load ROM image file %s\n", romfile);
+		return false;
+	}
+
+	FrameRunner runner;
+	std::vector<char> start;
+	gb.saveStateRaw(start);
+
+	double t0 = secondsNow();
+	for (unsigned i = 0; i < frames; ++i)
+		runner.runFrameHashed(gb);
+
+	double const frameUsecs = (secondsNow() - t0) * 1e6 / frames;
+
+	gb.loadState(&start[0], start.size());
+	gb.setRewindBufferSize(maxBytes);
+	std::vector<unsigned long> hashes(frames);
+	double pushSecs = 0;
+	for (unsigned i = 0; i < frames; ++i) {
+		t0 = secondsNow();
+		gb.rewindPush();
+		pushSecs += secondsNow() - t0;
+		hashes[i] = runner.runFrameHashed(gb);
+	}
+
+	std::size_t const depth = gb.rewindDepth();
+	double popSecs = 0;
+	bool replayOk = depth > 0;
+	for (unsigned i = frames; i-- > frames - depth;) {
+		t0 = secondsNow();
+		replayOk &= gb.rewindPop();
+		popSecs += secondsNow() - t0;
+		replayOk &= runner.runFrameHashed(gb) == hashes[i];
+	}
+
+	std::printf("%-28s %9.1f %9.1f %9.1f %9lu %9.1f  %s\n", desc, frameUsecs,
+	            pushSecs * 1e6 / frames, depth ? popSecs * 1e6 / depth : 0.0,
+	            static_cast<unsigned long>(depth), depth / frames_per_sec,
+	            replayOk ? "yes" : "NO");
+	return replayOk;
+}
+
+} // anon ns
+
+int main(int const argc, char *argv[]) {
+	unsigned frames = 3600;
+	std::size_t maxBytes = 16 << 20;
+	std::vector<char const *> romfiles;
+
+	for (int i = 1; i < argc; ++i) {
+		if (!std::strcmp(argv[i], "-f") && i + 1 < argc) {
+			frames = std::max(std::atoi(argv[++i]), 1);
+		} else if (!std::strcmp(argv[i], "-m") && i + 1 < argc) {
+			maxBytes = std::size_t(std::max(std::atoi(argv[++i]), 1)) << 10;
+		} else if (argv[i][0] != '-') {
+			romfiles.push_back(argv[i]);
+		} else {
+			std::puts("Usage: rewindbench [-f frames] [-m max_kib] [romfile]...\n"
+			          "  Measures the per-frame cost of pushing rewind snapshots and of\n"
+			          "  popping them, how many frames fit in the rewind buffer, and\n"
+			          "  checks that every popped snapshot replays identically. Runs a\n"
+			          "  ROM image that changes all of WRAM every frame, and the given\n"
+			          "  ROM images without input.");
+			return EXIT_FAILURE;
+		}
+	}
+
+	std::string const tmprom = tempPath("rewindbench.gb");
+	if (!writeRom(tmprom, makeBusyRom()))
+		return EXIT_FAILURE;
+
+	std::printf("%-28s %9s %9s %9s %9s %9s  %s\n", "rom", "frame_us", "push_us",
+	            "pop_us", "depth", "depth_s", "replay");
+	bool ok = bench(tmprom.c_str(), "all of WRAM changing", frames, maxBytes);
+	std::remove(tmprom.c_str());
+
+	for (std::size_t i = 0; i < romfiles.size(); ++i)
+		ok &= bench(romfiles[i], romfiles[i], frames, maxBytes);
+
+	return ok ? 0 : EXIT_FAILURE;
+}
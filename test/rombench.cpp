@@ -0,0 +1,219 @@
+#include "batchrunner.h"
+#include "benchutil.h"
+#include "gambatte.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+unsigned const check_frames = 30;
+
+// Patches $0150, the first instruction, with $3E.
+char const game_genie_code[] = "3E1-50F";
+
+// A 1 MiB CGB MBC5 ROM image with 32 KiB of cartridge RAM, or a 32 KiB DMG one
+// without an MBC, that keeps counting at $C000, switching to the ROM bank the
+// count selects and adding up the bank numbers stored at the start of each bank
+// at $A000.
+std::vector<unsigned char> makeBankingRom(bool mbc5) {
+	unsigned char const code[] = {
+		0xF3,             // di
+		0x3E, 0x0A,       // ld a, $0A
+		0xEA, 0x00, 0x00, // ld ($0000), a   ; enable RAM
+		0x21, 0x00, 0xC0, // ld hl, $C000    ; loop
+		0x7E,             // ld a, (hl)
+		0x3C,             // inc a
+		0x77,             // ld (hl), a
+		0xE6, 0x3F,       // and $3F
+		0xEA, 0x00, 0x20, // ld ($2000), a   ; ROM bank
+		0xFA, 0x00, 0x40, // ld a, ($4000)
+		0x47,             // ld b, a
+		0xFA, 0x00, 0xA0, // ld a, ($A000)
+		0x80,             // add b
+		0xEA, 0x00, 0xA0, // ld ($A000), a
+		0x18, 0xE8        // jr -24
+	};
+	std::vector<unsigned char> rom = makeRom(code, sizeof code, mbc5 ? 0x100000 : 0x8000);
+	for (std::size_t bank = 1; bank < rom.size() / 0x4000; ++bank)
+		rom[bank * 0x4000] = bank;
+
+	if (mbc5) {
+		rom[0x143] = 0x80;
+		rom[0x147] = 0x1B; // MBC5+RAM+BATTERY
+		rom[0x148] = 0x05; // 64 ROM banks
+		rom[0x149] = 0x03; // 4 RAM banks
+	}
+
+	return rom;
+}
+
+void runFrames(gambatte::GB &gb, unsigned frames) {
+	for (unsigned f = 0; f < frames; ++f)
+		gb.runFrame(0, gb_width);
+}
+
+bool loadAndRun(gambatte::GB &gb, std::string const &romfile, unsigned flags, unsigned frames) {
+	if (gb.load(romfile, gambatte::GB::NO_SAVEDATA | flags) != gambatte::LOADRES_OK)
+		return false;
+
+	runFrames(gb, frames);
+	return true;
+}
+
+gambatte::uint_least64_t freshHash(std::string const &romfile, unsigned frames) {
+	gambatte::GB gb;
+	return loadAndRun(gb, romfile, 0, frames) ? gb.stateHash() : 0;
+}
+
+class HashListener : public gambatte::BatchListener {
+public:
+	explicit HashListener(std::size_t jobs) : stateHashes(jobs) {}
+
+	virtual void jobDone(gambatte::BatchResult const &result) {
+		stateHashes[result.job] = result.loadres == gambatte::LOADRES_OK ? result.stateHash : 0;
+	}
+
+	std::vector<gambatte::uint_least64_t> stateHashes;
+};
+
+// Seconds a load and its first frame take on average, over loads loads of
+// romfiles in turn into gb, or into a new instance each time if gb is null.
+double loadToFirstFrame(gambatte::GB *gb, std::string const *romfiles, std::size_t numRomfiles,
+		unsigned flags, unsigned loads) {
+	double const t0 = secondsNow();
+	for (unsigned i = 0; i < loads; ++i) {
+		std::string const &romfile = romfiles[i % numRomfiles];
+		if (gb) {
+			loadAndRun(*gb, romfile, flags, 1);
+		} else {
+			gambatte::GB fresh;
+			loadAndRun(fresh, romfile, flags, 1);
+		}
+	}
+
+	return (secondsNow() - t0) / loads;
+}
+
+} // anon ns
+
+int main(int const argc, char *argv[]) {
+	unsigned loads = 200;
+
+	for (int i = 1; i < argc; ++i) {
+		if (!std::strcmp(argv[i], "-n") && i + 1 < argc) {
+			loads = std::max(std::atoi(argv[++i]), 1);
+		} else {
+			std::puts("Usage: rombench [-n loads]\n"
+			          "  Checks that reloading ROM images into a GB instance, which reuses its\n"
+			          "  memory and MBC, and with GB::REUSE_ROM the resident ROM image, gives\n"
+			          "  the same states as fresh instances, alternating between an MBC5 and a\n"
+			          "  plain ROM image, with Game Genie codes, clones and BatchRunner. Then\n"
+			          "  reports the time from load to the end of the first frame.");
+			return EXIT_FAILURE;
+		}
+	}
+
+	std::string const romfiles[] = { tempPath("rombench.gbc"), tempPath("rombench.gb") };
+	std::string const &mbc5Rom = romfiles[0];
+	std::string const &plainRom = romfiles[1];
+	if (!writeRom(mbc5Rom, makeBankingRom(true)) || !writeRom(plainRom, makeBankingRom(false)))
+		return EXIT_FAILURE;
+
+	using gambatte::GB;
+	bool ok = true;
+	gambatte::uint_least64_t const mbc5Hash = freshHash(mbc5Rom, check_frames);
+	gambatte::uint_least64_t const plainHash = freshHash(plainRom, check_frames);
+	ok &= check("fresh instances load and run both ROM images",
+		mbc5Hash && plainHash && mbc5Hash != plainHash);
+	{
+		GB gb;
+		loadAndRun(gb, mbc5Rom, 0, check_frames);
+		gambatte::MemoryView const wram = gb.memoryView(GB::WRAM);
+		gambatte::MemoryView const sram = gb.memoryView(GB::SRAM);
+		bool const reloaded = loadAndRun(gb, mbc5Rom, 0, check_frames)
+			&& gb.stateHash() == mbc5Hash;
+		ok &= check("reload: same state as a fresh instance", reloaded);
+		ok &= check("reload keeps WRAM and cartridge RAM in place",
+			gb.memoryView(GB::WRAM).data == wram.data && gb.memoryView(GB::SRAM).data == sram.data);
+
+		ok &= check("REUSE_ROM reload: same state as a fresh instance",
+			loadAndRun(gb, mbc5Rom, GB::REUSE_ROM, check_frames) && gb.stateHash() == mbc5Hash);
+
+		bool alternated = true;
+		for (unsigned i = 0; i < 4; ++i) {
+			unsigned const flags = i < 2 ? 0 : GB::REUSE_ROM;
+			alternated &= loadAndRun(gb, plainRom, flags, check_frames) && gb.stateHash() == plainHash;
+			alternated &= loadAndRun(gb, mbc5Rom, flags, check_frames) && gb.stateHash() == mbc5Hash;
+		}
+
+		ok &= check("alternating ROM images: same states as fresh instances", alternated);
+	}
+	{
+		GB gb;
+		gb.load(mbc5Rom, GB::NO_SAVEDATA);
+		gambatte::uint_least64_t const romHash = gb.romHash();
+		gb.setGameGenie(game_genie_code);
+		bool const patched = gb.romHash() != romHash;
+		ok &= check("REUSE_ROM reload undoes Game Genie codes",
+			patched && loadAndRun(gb, mbc5Rom, GB::REUSE_ROM, check_frames)
+			&& gb.romHash() == romHash && gb.stateHash() == mbc5Hash);
+
+		std::vector<unsigned char> changed = makeBankingRom(true);
+		changed[0x150] = 0x00;
+		writeRom(mbc5Rom, changed);
+		gb.load(mbc5Rom, GB::NO_SAVEDATA | GB::REUSE_ROM);
+		bool const kept = gb.romHash() == romHash;
+		gb.load(mbc5Rom, GB::NO_SAVEDATA);
+		ok &= check("a changed file is read by load, not by REUSE_ROM load",
+			kept && gb.romHash() != romHash);
+		writeRom(mbc5Rom, makeBankingRom(true));
+	}
+	{
+		GB gb;
+		loadAndRun(gb, mbc5Rom, 0, check_frames / 2);
+		GB *const clone = gb.clone();
+		gb.setGameGenie(game_genie_code);
+		bool const reloaded = loadAndRun(gb, mbc5Rom, GB::REUSE_ROM, check_frames)
+			&& gb.stateHash() == mbc5Hash;
+		runFrames(*clone, check_frames - check_frames / 2);
+		ok &= check("clone keeps its ROM image as the original reloads",
+			reloaded && clone->stateHash() == mbc5Hash);
+		delete clone;
+	}
+	{
+		std::vector<gambatte::BatchJob> jobs(4);
+		for (std::size_t i = 0; i < jobs.size(); ++i) {
+			jobs[i].romfile = i == 2 ? plainRom : mbc5Rom;
+			jobs[i].frames = check_frames;
+		}
+
+		gambatte::BatchRunner runner(1);
+		HashListener listener(jobs.size());
+		runner.run(jobs, listener);
+		ok &= check("BatchRunner reloads: same states as fresh instances",
+			listener.stateHashes[0] == mbc5Hash && listener.stateHashes[1] == mbc5Hash
+			&& listener.stateHashes[2] == plainHash && listener.stateHashes[3] == mbc5Hash);
+	}
+
+	std::printf("\n%-36s %12s\n", "load to first frame", "us/load");
+	std::printf("%-36s %12.1f\n", "new instance",
+		loadToFirstFrame(0, romfiles, 1, 0, loads) * 1e6);
+	{
+		GB gb;
+		gb.load(mbc5Rom, GB::NO_SAVEDATA);
+		std::printf("%-36s %12.1f\n", "reload",
+			loadToFirstFrame(&gb, romfiles, 1, 0, loads) * 1e6);
+		std::printf("%-36s %12.1f\n", "reload, REUSE_ROM",
+			loadToFirstFrame(&gb, romfiles, 1, GB::REUSE_ROM, loads) * 1e6);
+		std::printf("%-36s %12.1f\n", "alternate two ROM images",
+			loadToFirstFrame(&gb, romfiles, 2, 0, loads) * 1e6);
+	}
+
+	std::remove(mbc5Rom.c_str());
+	std::remove(plainRom.c_str());
+	return ok ? 0 : EXIT_FAILURE;
+}
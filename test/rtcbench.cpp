@@ -0,0 +1,149 @@
+#include "benchutil.h"
+#include "gambatte.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+// 125.5 seconds of frames, at 70224 cycles a frame and 2^22 cycles a second.
+unsigned const frames_125s = 7496;
+
+// An MBC3 ROM image with a clock, that keeps latching the clock and copying its
+// seconds, minutes and hours to $C000-$C002. The CGB version switches to double
+// speed first.
+std::vector<unsigned char> makeClockRom(bool doubleSpeed) {
+	unsigned char const speedSwitch[] = {
+		0x3E, 0x01,       // ld a, 1
+		0xE0, 0x4D,       // ldh ($4D), a
+		0x10, 0x00        // stop
+	};
+	unsigned char const code[] = {
+		0x3E, 0x0A,       // ld a, $0A
+		0xEA, 0x00, 0x00, // ld ($0000), a   ; enable RAM and clock
+		0xAF,             // xor a           ; loop
+		0xEA, 0x00, 0x60, // ld ($6000), a
+		0x3C,             // inc a
+		0xEA, 0x00, 0x60, // ld ($6000), a   ; latch
+		0x3E, 0x08,       // ld a, $08
+		0xEA, 0x00, 0x40, // ld ($4000), a   ; seconds
+		0xFA, 0x00, 0xA0, // ld a, ($A000)
+		0xEA, 0x00, 0xC0, // ld ($C000), a
+		0x3E, 0x09,       // ld a, $09
+		0xEA, 0x00, 0x40, // ld ($4000), a   ; minutes
+		0xFA, 0x00, 0xA0, // ld a, ($A000)
+		0xEA, 0x01, 0xC0, // ld ($C001), a
+		0x3E, 0x0A,       // ld a, $0A
+		0xEA, 0x00, 0x40, // ld ($4000), a   ; hours
+		0xFA, 0x00, 0xA0, // ld a, ($A000)
+		0xEA, 0x02, 0xC0, // ld ($C002), a
+		0x18, 0xD5        // jr -43
+	};
+	std::vector<unsigned char> prog(1, 0xF3); // di
+	if (doubleSpeed)
+		prog.insert(prog.end(), speedSwitch, speedSwitch + sizeof speedSwitch);
+
+	prog.insert(prog.end(), code, code + sizeof code);
+	std::vector<unsigned char> rom = makeRom(&prog[0], prog.size());
+	rom[0x143] = doubleSpeed ? 0x80 : 0x00;
+	rom[0x147] = 0x10; // MBC3+TIMER+RAM+BATTERY
+	rom[0x149] = 0x02; // 1 RAM bank
+	return rom;
+}
+
+void runFrames(gambatte::GB &gb, unsigned frames) {
+	for (unsigned f = 0; f < frames; ++f)
+		gb.runFrame(0, gb_width);
+}
+
+// Seconds since 00:00:00 as last copied out by the ROM image.
+unsigned long clockSeconds(gambatte::GB const &gb) {
+	return gb.peek(0xC002) * 3600ul + gb.peek(0xC001) * 60ul + gb.peek(0xC000);
+}
+
+unsigned long clockAfter(char const *romfile, gambatte::GB::RtcMode mode, unsigned frames) {
+	gambatte::GB gb;
+	gb.setRtcMode(mode, 1000000000);
+	gb.load(romfile, gambatte::GB::NO_SAVEDATA);
+	runFrames(gb, frames);
+	return clockSeconds(gb);
+}
+
+} // anon ns
+
+int main(int const argc, char *argv[]) {
+	unsigned frames = 600;
+
+	for (int i = 1; i < argc; ++i) {
+		if (!std::strcmp(argv[i], "-f") && i + 1 < argc) {
+			frames = std::max(std::atoi(argv[++i]), 1);
+		} else {
+			std::puts("Usage: rtcbench [-f frames]\n"
+			          "  Checks GB::RTC_EMULATED_TIME on MBC3 ROM images that keep reading the\n"
+			          "  cartridge clock, at normal and double speed: that the clock advances\n"
+			          "  with emulated time from 0 at load, and that states and clones carry\n"
+			          "  it over. Then reports the time per frame of running with emulated and\n"
+			          "  real time.");
+			return EXIT_FAILURE;
+		}
+	}
+
+	std::string const normalRom = tempPath("rtcbench.gb");
+	std::string const doubleRom = tempPath("rtcbench.gbc");
+	if (!writeRom(normalRom, makeClockRom(false)) || !writeRom(doubleRom, makeClockRom(true)))
+		return EXIT_FAILURE;
+
+	using gambatte::GB;
+	bool ok = true;
+	ok &= check("emulated time: 0:02:05 after 125.5 emulated seconds",
+		clockAfter(normalRom.c_str(), GB::RTC_EMULATED_TIME, frames_125s) == 125);
+	ok &= check("emulated time, double speed: 0:02:05 after 125.5 seconds",
+		clockAfter(doubleRom.c_str(), GB::RTC_EMULATED_TIME, frames_125s) == 125);
+	ok &= check("real time: less than a minute after 125.5 emulated seconds",
+		clockAfter(normalRom.c_str(), GB::RTC_REAL_TIME, frames_125s) < 60);
+
+	{
+		GB gb;
+		gb.setRtcMode(GB::RTC_EMULATED_TIME);
+		gb.load(doubleRom.c_str(), GB::NO_SAVEDATA);
+		runFrames(gb, frames_125s / 2);
+		std::vector<char> state;
+		gb.saveState(state);
+		GB *const clone = gb.clone();
+		runFrames(gb, frames_125s / 2);
+		unsigned long const clock = clockSeconds(gb);
+		gambatte::uint_least64_t const hash = gb.stateHash();
+
+		gb.reset(false);
+		runFrames(gb, 90);
+		bool const restarted = clockSeconds(gb) == 1;
+		gb.loadState(&state[0], state.size());
+		runFrames(gb, frames_125s / 2);
+		ok &= check("reset restarts emulated time, loadState resumes it",
+			restarted && clockSeconds(gb) == clock && gb.stateHash() == hash);
+
+		runFrames(*clone, frames_125s / 2);
+		ok &= check("clone carries emulated time over",
+			clockSeconds(*clone) == clock && clone->stateHash() == hash);
+		delete clone;
+	}
+
+	std::printf("\n%-36s %12s\n", "", "us/frame");
+	GB::RtcMode const modes[] = { GB::RTC_EMULATED_TIME, GB::RTC_REAL_TIME };
+	char const *const modeNames[] = { "emulated time", "real time" };
+	for (std::size_t m = 0; m < sizeof modes / sizeof modes[0]; ++m) {
+		GB gb;
+		gb.setRtcMode(modes[m]);
+		gb.load(normalRom.c_str(), GB::NO_SAVEDATA);
+		double const t0 = secondsNow();
+		runFrames(gb, frames);
+		std::printf("%-36s %12.1f\n", modeNames[m], (secondsNow() - t0) / frames * 1e6);
+	}
+
+	std::remove(normalRom.c_str());
+	std::remove(doubleRom.c_str());
+	return ok ? 0 : EXIT_FAILURE;
+}
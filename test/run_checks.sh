@@ -0,0 +1,41 @@
+#!/bin/sh
+# Runs each benchmark briefly and counts the ones whose checks fail.
+# statebench needs a ROM image, which make test assembles.
+failures=0
+
+run() {
+	echo "== $*"
+	if ! "$@"; then
+		echo "== $1 FAILED"
+		failures=$((failures + 1))
+	fi
+}
+
+run ./batchbench -n 4 -t 2
+run ./clonebench -f 60 -n 10
+run ./dirtybench -f 60
+run ./framebench -f 60
+run ./hashbench -f 60
+run ./inputbench -f 30
+run ./loadbench -n 100
+run ./memviewbench -f 10
+run ./moviebench -f 60
+run ./resamplerbench -t 1
+run ./rewindbench -f 120
+run ./rombench -n 10
+run ./rtcbench -f 60
+run ./runaheadbench -f 60
+run ./slotbench -n 5
+run ./soundbench -t 1
+run ./stepbench -n 8 -s 60 -t 2
+run ./threadstress -t 2 -n 2 -f 60
+run ./untilbench -f 30
+
+if [ -f hwtests/cgb_bgp_dumper.gbc ]; then
+	run ./statebench -n 10 -f 60 hwtests/cgb_bgp_dumper.gbc
+else
+	echo "== statebench skipped: no ROM image, run make test first"
+fi
+
+echo "$failures failures."
+[ "$failures" -eq 0 ]
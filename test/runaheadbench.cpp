@@ -0,0 +1,194 @@
+#include "benchutil.h"
+#include "gambatte.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+unsigned const max_run_ahead = 4;
+
+struct HeldInput : gambatte::InputGetter {
+	unsigned is;
+	HeldInput() : is(0) {}
+	virtual unsigned operator()() { return is; }
+};
+
+// Runs host frames like a frontend does: a frame of emulation, then run-ahead
+// into the displayed buffer.
+class Frontend {
+public:
+	explicit Frontend(unsigned runAheadFrames)
+	: videobuf_(gb_width * gb_height), audiobuf_(audiobuf_size)
+	, aheadbuf_(gb_width * gb_height), runAheadFrames_(runAheadFrames)
+	, outputHash_(fnv1a_basis)
+	{
+		gb_.setInputGetter(&input_);
+	}
+
+	bool load(char const *romfile) { return !gb_.load(romfile); }
+	gambatte::GB & gb() { return gb_; }
+	void setInput(unsigned is) { input_.is = is; }
+	void setRunAheadFrames(unsigned n) { runAheadFrames_ = n; }
+
+	// Returns a hash of the displayed frame. Accumulates a hash of the emulated
+	// video and audio, which running ahead must not change.
+	unsigned long hostFrame() {
+		for (;;) {
+			std::size_t samples = samples_per_frame;
+			bool const done = gb_.runFor(&videobuf_[0], gb_width, &audiobuf_[0], samples) >= 0;
+			outputHash_ = fnv1a(outputHash_, &audiobuf_[0], samples);
+			if (done)
+				break;
+		}
+
+		outputHash_ = fnv1a(outputHash_, &videobuf_[0], videobuf_.size());
+		if (!runAheadFrames_)
+			return fnv1a(fnv1a_basis, &videobuf_[0], videobuf_.size());
+
+		gb_.runAhead(runAheadFrames_, &aheadbuf_[0], gb_width);
+		return fnv1a(fnv1a_basis, &aheadbuf_[0], aheadbuf_.size());
+	}
+
+	unsigned long outputHash() const { return outputHash_; }
+
+private:
+	gambatte::GB gb_;
+	HeldInput input_;
+	std::vector<gambatte::uint_least32_t> videobuf_;
+	std::vector<gambatte::uint_least32_t> audiobuf_;
+	std::vector<gambatte::uint_least32_t> aheadbuf_;
+	unsigned runAheadFrames_;
+	unsigned long outputHash_;
+};
+
+// A ROM image that, like many games, reads the joypad once per frame at the
+// start of vblank and shows the result some frames later: it writes the buttons
+// read two vblanks earlier to the background palette.
+std::vector<unsigned char> makeLaggyRom() {
+	unsigned char const code[] = {
+		0xF3,             // di
+		0xF0, 0x44,       // ldh a, ($44)
+		0xFE, 0x90,       // cp $90
+		0x20, 0xFA,       // jr nz, -6
+		0xFA, 0x01, 0xC0, // ld a, ($C001)
+		0xE0, 0x47,       // ldh ($47), a
+		0xFA, 0x00, 0xC0, // ld a, ($C000)
+		0xEA, 0x01, 0xC0, // ld ($C001), a
+		0x3E, 0x10,       // ld a, $10
+		0xE0, 0x00,       // ldh ($00), a
+		0xF0, 0x00,       // ldh a, ($00)
+		0xEA, 0x00, 0xC0, // ld ($C000), a
+		0xF0, 0x44,       // ldh a, ($44)
+		0xFE, 0x90,       // cp $90
+		0x28, 0xFA,       // jr z, -6
+		0x18, 0xDE        // jr -34
+	};
+	return makeRom(code, sizeof code);
+}
+
+// Host frames from the first frame emulated with a button held until the
+// displayed frame changes, or -1 if it does not within a second.
+int latency(char const *romfile, unsigned runAheadFrames) {
+	Frontend f(runAheadFrames);
+	if (!f.load(romfile))
+		return -1;
+
+	unsigned long released = 0;
+	for (int i = 0; i < 10; ++i)
+		released = f.hostFrame();
+
+	f.setInput(gambatte::InputGetter::A);
+	for (int i = 0; i < 60; ++i) {
+		if (f.hostFrame() != released)
+			return i;
+	}
+
+	return -1;
+}
+
+bool bench(char const *romfile, char const *desc, unsigned frames, bool measureLatency) {
+	std::printf("%s\n", desc);
+	double baseUsecs = 0;
+	unsigned long baseOutputHash = 0;
+	gambatte::uint_least64_t baseStateHash = 0;
+	bool ok = true;
+	for (unsigned n = 0; n <= max_run_ahead; ++n) {
+		Frontend f(n);
+		if (!f.load(romfile)) {
+			std::fprintf(stderr, "Failed to load ROM image file %s\n", romfile);
+			return false;
+		}
+
+		double const t0 = secondsNow();
+		for (unsigned i = 0; i < frames; ++i) {
+			f.setInput(i / 30 % 2 ? gambatte::InputGetter::A : 0);
+			f.hostFrame();
+		}
+
+		double const usecs = (secondsNow() - t0) * 1e6 / frames;
+
+		// Running ahead must not change the emulated output, nor where the
+		// emulation ends up. Loading state recomputes some PPU fields, so the
+		// state is compared a frame after the last run-ahead.
+		f.setRunAheadFrames(0);
+		f.hostFrame();
+		gambatte::uint_least64_t const stateHash = f.gb().stateHash();
+		if (n == 0) {
+			baseUsecs = usecs;
+			baseOutputHash = f.outputHash();
+			baseStateHash = stateHash;
+		}
+
+		bool const unchanged = f.outputHash() == baseOutputHash && stateHash == baseStateHash;
+		ok &= unchanged;
+		std::printf("  %-10u %12.1f %15.1f %9s %9s\n", n, usecs,
+		            n ? (usecs - baseUsecs) / n : 0.0,
+		            measureLatency ? std::to_string(latency(romfile, n)).c_str() : "-",
+		            unchanged ? "yes" : "NO");
+	}
+
+	return ok;
+}
+
+} // anon ns
+
+int main(int const argc, char *argv[]) {
+	unsigned frames = 600;
+	std::vector<char const *> romfiles;
+
+	for (int i = 1; i < argc; ++i) {
+		if (!std::strcmp(argv[i], "-f") && i + 1 < argc) {
+			frames = std::max(std::atoi(argv[++i]), 1);
+		} else if (argv[i][0] != '-') {
+			romfiles.push_back(argv[i]);
+		} else {
+			std::puts("Usage: runaheadbench [-f frames] [romfile]...\n"
+			          "  Measures the cost of GB::runAhead per host frame and per frame run\n"
+			          "  ahead, for 0 to 4 frames of run-ahead, and checks that running\n"
+			          "  ahead leaves the emulation where it would otherwise be. For a ROM\n"
+			          "  image that shows joypad input with two frames of lag, measures how many\n"
+			          "  host frames pass between pressing a button and the display changing.\n"
+			          "  Runs that ROM image and the given ROM images, with a button toggled\n"
+			          "  every 30 frames.");
+			return EXIT_FAILURE;
+		}
+	}
+
+	std::string const tmprom = tempPath("runaheadbench.gb");
+	if (!writeRom(tmprom, makeLaggyRom()))
+		return EXIT_FAILURE;
+
+	std::printf("  %-10s %12s %15s %9s %9s\n", "run-ahead", "us/host frame",
+	            "us/ahead frame", "latency", "unchanged");
+	bool ok = bench(tmprom.c_str(), "joypad to palette, 2 frames late", frames, true);
+	std::remove(tmprom.c_str());
+
+	for (std::size_t i = 0; i < romfiles.size(); ++i)
+		ok &= bench(romfiles[i], romfiles[i], frames, false);
+
+	return ok ? 0 : EXIT_FAILURE;
+}
@@ -0,0 +1,170 @@
+#include "benchutil.h"
+#include "gambatte.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+int const num_slots = 10;
+int const resaved_slot = 3;
+
+std::string slotPath(int slot) {
+	return tempPath("slotbench_") + char('0' + slot) + ".gqs";
+}
+
+std::size_t readFile(std::string const &path, std::vector<char> &data) {
+	data.clear();
+	if (std::FILE *const f = std::fopen(path.c_str(), "rb")) {
+		char buf[0x1000];
+		while (std::size_t const n = std::fread(buf, 1, sizeof buf, f))
+			data.insert(data.end(), buf, buf + n);
+
+		std::fclose(f);
+	}
+
+	return data.size();
+}
+
+// A video frame that differs per slot, with 2x2 blocks of one color so that
+// the expected thumbnail is easy to compute.
+gambatte::uint_least32_t pixel(int slot, unsigned x, unsigned y) {
+	return ((x / 2 * 3 + slot) & 0xFF) << 16 | ((y / 2 * 5) & 0xFF) << 8 | (slot * 20 & 0xFF);
+}
+
+bool thumbnailOk(std::vector<gambatte::uint_least32_t> const &thumb, int frameSlot) {
+	typedef gambatte::StateSlotInfo Info;
+	if (thumb.size() != std::size_t(Info::thumb_width) * Info::thumb_height)
+		return false;
+
+	for (unsigned y = 0; y < Info::thumb_height; ++y) {
+		for (unsigned x = 0; x < Info::thumb_width; ++x) {
+			if (thumb[y * Info::thumb_width + x] != pixel(frameSlot, 2 * x, 2 * y))
+				return false;
+		}
+	}
+
+	return true;
+}
+
+} // anon ns
+
+int main(int const argc, char *argv[]) {
+	unsigned iterations = 100;
+
+	for (int i = 1; i < argc; ++i) {
+		if (!std::strcmp(argv[i], "-n") && i + 1 < argc) {
+			iterations = std::max(std::atoi(argv[++i]), 1);
+		} else {
+			std::puts("Usage: slotbench [-n iterations]\n"
+			          "  Saves all state slots of a generated ROM image, and measures\n"
+			          "  enumerating them through the slot index against reading and against\n"
+			          "  loading every state file, and reading one thumbnail from the index. Checks\n"
+			          "  that the index reports every slot with its state size, hash and thumbnail,\n"
+			          "  also from a fresh instance.");
+			return EXIT_FAILURE;
+		}
+	}
+
+	std::string const romfile = tempPath("slotbench.gb");
+	if (!writeRom(romfile, makeIdleRom()))
+		return EXIT_FAILURE;
+
+	std::vector<gambatte::uint_least32_t> videobuf(gb_width * gb_height);
+	std::vector<std::size_t> stateSizes(num_slots);
+	std::vector<gambatte::uint_least64_t> stateHashes(num_slots);
+	bool ok = true;
+	{
+		gambatte::GB gb;
+		ok &= !gb.load(romfile);
+		std::vector<gambatte::uint_least32_t> audiobuf(audiobuf_size);
+		std::vector<char> state;
+		for (int slot = 0; slot < num_slots; ++slot) {
+			std::size_t samples = samples_per_frame;
+			gb.runFor(&videobuf[0], gb_width, &audiobuf[0], samples);
+			for (unsigned y = 0; y < gb_height; ++y) {
+				for (unsigned x = 0; x < gb_width; ++x)
+					videobuf[y * gb_width + x] = pixel(slot, x, y);
+			}
+
+			gb.selectState(slot);
+			ok &= gb.saveState(&videobuf[0], gb_width);
+			gb.saveState(state);
+			stateSizes[slot] = state.size() + gb_width * gb_height * 4;
+			stateHashes[slot] = gb.stateHash();
+		}
+
+		// Saving a slot again replaces its entry.
+		gb.selectState(resaved_slot);
+		ok &= gb.saveState(&videobuf[0], gb_width);
+		stateHashes[resaved_slot] = gb.stateHash();
+		std::vector<gambatte::uint_least32_t> thumb;
+		ok &= gb.stateSlotThumbnail(0, thumb) && thumbnailOk(thumb, 0);
+		ok &= gb.flushStateFiles();
+	}
+
+	double enumSecs = 0, readSecs = 0, loadSecs = 0, thumbSecs = 0;
+	std::vector<gambatte::StateSlotInfo> slots;
+	std::vector<gambatte::uint_least32_t> thumb;
+	std::size_t bytesRead = 0;
+	for (unsigned i = 0; i < iterations; ++i) {
+		gambatte::GB gb;
+		gb.load(romfile);
+
+		double t0 = secondsNow();
+		gb.stateSlots(slots);
+		enumSecs += secondsNow() - t0;
+
+		t0 = secondsNow();
+		ok &= gb.stateSlotThumbnail(0, thumb);
+		thumbSecs += secondsNow() - t0;
+
+		t0 = secondsNow();
+		std::vector<char> data;
+		bytesRead = 0;
+		for (int slot = 0; slot < num_slots; ++slot)
+			bytesRead += readFile(slotPath(slot), data);
+
+		readSecs += secondsNow() - t0;
+
+		t0 = secondsNow();
+		for (int slot = 0; slot < num_slots; ++slot)
+			ok &= gb.loadState(slotPath(slot));
+
+		loadSecs += secondsNow() - t0;
+	}
+
+	bool slotsOk = slots.size() == std::size_t(num_slots);
+	{
+		gambatte::GB gb;
+		gb.load(romfile);
+		for (int slot = 0; slotsOk && slot < num_slots; ++slot) {
+			gambatte::StateSlotInfo const &info = slots[slot];
+			int const frameSlot = slot == resaved_slot ? num_slots - 1 : slot;
+			slotsOk = info.slot == slot && info.stateSize == stateSizes[slot] && info.saveTime
+			       && info.stateHash == stateHashes[slot] && info.hasThumbnail
+			       && gb.stateSlotThumbnail(slot, thumb) && thumbnailOk(thumb, frameSlot);
+		}
+	}
+
+	std::vector<char> index;
+	std::printf("slot index size: %lu bytes, state files: %lu bytes\n",
+	            static_cast<unsigned long>(readFile(tempPath("slotbench.gqi"), index)),
+	            static_cast<unsigned long>(bytesRead));
+	std::printf("%-28s %10s\n", "operation", "usecs");
+	std::printf("%-28s %10.1f\n", "enumerate slot index", enumSecs * 1e6 / iterations);
+	std::printf("%-28s %10.1f\n", "read one thumbnail", thumbSecs * 1e6 / iterations);
+	std::printf("%-28s %10.1f\n", "read all state files", readSecs * 1e6 / iterations);
+	std::printf("%-28s %10.1f\n", "load all state files", loadSecs * 1e6 / iterations);
+	std::printf("slots saved and loaded: %s\n", ok ? "yes" : "NO");
+	std::printf("index lists every slot with size, hash and thumbnail: %s\n", slotsOk ? "yes" : "NO");
+
+	for (int slot = 0; slot < num_slots; ++slot)
+		std::remove(slotPath(slot).c_str());
+
+	std::remove(tempPath("slotbench.gqi").c_str());
+	std::remove(romfile.c_str());
+	return ok && slotsOk ? 0 : EXIT_FAILURE;
+}
@@ -0,0 +1,178 @@
+#include "benchutil.h"
+#include "gambatte.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+long const frames_per_sec = 60;
+
+struct RegWrite {
+	unsigned char reg;
+	unsigned char data;
+};
+
+struct Scenario {
+	char const *desc;
+	RegWrite const *writes;
+	std::size_t numWrites;
+	// Hash of the first second of audio, as produced before wave and noise
+	// clocks that cannot change the output were skipped, so that the channel
+	// state those skips leave behind is checked for exactness.
+	unsigned long firstSecondHash;
+};
+
+#define WAVE_RAM(b0, b1, b2, b3, b4, b5, b6, b7, b8, b9, bA, bB, bC, bD, bE, bF) \
+	{ 0x30, b0 }, { 0x31, b1 }, { 0x32, b2 }, { 0x33, b3 }, \
+	{ 0x34, b4 }, { 0x35, b5 }, { 0x36, b6 }, { 0x37, b7 }, \
+	{ 0x38, b8 }, { 0x39, b9 }, { 0x3A, bA }, { 0x3B, bB }, \
+	{ 0x3C, bC }, { 0x3D, bD }, { 0x3E, bE }, { 0x3F, bF }
+
+RegWrite const silence[] = { { 0x25, 0x00 } };
+RegWrite const noise15[] = { { 0x21, 0xF0 }, { 0x22, 0x00 }, { 0x23, 0x80 } };
+RegWrite const noise7[] = { { 0x21, 0xF0 }, { 0x22, 0x08 }, { 0x23, 0x80 } };
+RegWrite const noise15Slow[] = { { 0x21, 0xF0 }, { 0x22, 0x31 }, { 0x23, 0x80 } };
+RegWrite const noiseNoClock[] = { { 0x21, 0xF0 }, { 0x22, 0xE0 }, { 0x23, 0x80 } };
+RegWrite const waveFlat[] = {
+	WAVE_RAM(0x88, 0x88, 0x88, 0x88, 0x88, 0x88, 0x88, 0x88,
+	         0x88, 0x88, 0x88, 0x88, 0x88, 0x88, 0x88, 0x88),
+	{ 0x1A, 0x80 }, { 0x1C, 0x20 }, { 0x1D, 0xFF }, { 0x1E, 0x87 }
+};
+RegWrite const waveFlatShifted[] = {
+	WAVE_RAM(0x01, 0x23, 0x01, 0x23, 0x01, 0x23, 0x01, 0x23,
+	         0x01, 0x23, 0x01, 0x23, 0x01, 0x23, 0x01, 0x23),
+	{ 0x1A, 0x80 }, { 0x1C, 0x60 }, { 0x1D, 0xFF }, { 0x1E, 0x87 }
+};
+RegWrite const waveSaw[] = {
+	WAVE_RAM(0x01, 0x23, 0x45, 0x67, 0x89, 0xAB, 0xCD, 0xEF,
+	         0xFE, 0xDC, 0xBA, 0x98, 0x76, 0x54, 0x32, 0x10),
+	{ 0x1A, 0x80 }, { 0x1C, 0x20 }, { 0x1D, 0xFF }, { 0x1E, 0x87 }
+};
+
+#define SCENARIO(desc, writes, hash) { desc, writes, sizeof writes / sizeof writes[0], hash }
+
+Scenario const scenarios[] = {
+	SCENARIO("silence", silence, 0x5BAD27ADul),
+	SCENARIO("noise, 15-bit, fastest clock", noise15, 0xCB35A6DDul),
+	SCENARIO("noise, 7-bit, fastest clock", noise7, 0xD0B95EDDul),
+	SCENARIO("noise, 15-bit, slow clock", noise15Slow, 0xC28856DDul),
+	SCENARIO("noise, clock stopped", noiseNoClock, 0xD8CA36DDul),
+	SCENARIO("wave, flat, fastest clock", waveFlat, 0x90034AA5ul),
+	SCENARIO("wave, flat after shift, fastest", waveFlatShifted, 0xCAEC8AA5ul),
+	SCENARIO("wave, sawtooth, fastest clock", waveSaw, 0x1E4A5AA5ul),
+};
+
+#undef SCENARIO
+#undef WAVE_RAM
+
+// A ROM image that turns on the APU, does the scenario's register writes and then
+// spins in a tight loop with interrupts disabled.
+std::vector<unsigned char> makeScenarioRom(Scenario const &s) {
+	std::vector<unsigned char> code(1, 0xF3); // di
+	RegWrite const init[] = { { 0x26, 0x80 }, { 0x24, 0x77 }, { 0x25, 0xFF } };
+	for (std::size_t i = 0; i < sizeof init / sizeof init[0] + s.numWrites; ++i) {
+		RegWrite const &w = i < sizeof init / sizeof init[0]
+		                  ? init[i]
+		                  : s.writes[i - sizeof init / sizeof init[0]];
+		code.push_back(0x3E); // ld a, data
+		code.push_back(w.data);
+		code.push_back(0xE0); // ldh (reg), a
+		code.push_back(w.reg);
+	}
+
+	code.push_back(0x18); // jr -2
+	code.push_back(0xFE);
+	return makeRom(&code[0], code.size());
+}
+
+struct Result {
+	double wallSecs;
+	unsigned long audioHash;
+	unsigned long firstSecondHash;
+};
+
+// Emulates the given number of seconds. The audio hash lets optimizations of the sound
+// channels be checked for exactness against a previous build.
+bool run(Result &r, char const *romfile, long seconds) {
+	gambatte::GB gb;
+	if (gb.load(romfile))
+		return false;
+
+	std::vector<gambatte::uint_least32_t> audiobuf(audiobuf_size);
+	unsigned long hash = fnv1a_basis;
+	double const t0 = secondsNow();
+	for (long frame = 0; frame < seconds * frames_per_sec; ++frame) {
+		std::size_t samples = samples_per_frame;
+		gb.runFor(0, gb_width, &audiobuf[0], samples);
+		hash = fnv1a(hash, &audiobuf[0], samples);
+		if (frame == frames_per_sec - 1)
+			r.firstSecondHash = hash;
+	}
+
+	r.wallSecs = secondsNow() - t0;
+	r.audioHash = hash;
+	return true;
+}
+
+void printResult(char const *desc, long seconds, Result const &r, char const *status) {
+	std::printf("%-36s %9.3f %9.1f  %08lx  %s\n", desc, r.wallSecs, seconds / r.wallSecs,
+	            r.audioHash, status);
+}
+
+} // anon ns
+
+int main(int const argc, char *argv[]) {
+	long seconds = 20;
+	std::vector<char const *> romfiles;
+
+	for (int i = 1; i < argc; ++i) {
+		if (!std::strcmp(argv[i], "-t") && i + 1 < argc) {
+			seconds = std::max(std::atol(argv[++i]), 1l);
+		} else if (argv[i][0] != '-') {
+			romfiles.push_back(argv[i]);
+		} else {
+			std::puts("Usage: soundbench [-t emulated_seconds] [romfile]...\n"
+			          "  Measures emulation speed with the sound channels in various\n"
+			          "  states, and for the given ROM images played without input. Checks\n"
+			          "  the first second of audio of each state against the output of the\n"
+			          "  sound channels before their optimizations.");
+			return EXIT_FAILURE;
+		}
+	}
+
+	std::printf("%-36s %9s %9s  %8s\n", "scenario", "wall_s", "speed_x", "audio");
+	std::string const tmprom = tempPath("soundbench.gb");
+	bool ok = true;
+	for (std::size_t i = 0; i < sizeof scenarios / sizeof scenarios[0]; ++i) {
+		if (!writeRom(tmprom, makeScenarioRom(scenarios[i])))
+			return EXIT_FAILURE;
+
+		Result r;
+		if (!run(r, tmprom.c_str(), seconds)) {
+			std::fprintf(stderr, "Failed to load %s\n", tmprom.c_str());
+			return EXIT_FAILURE;
+		}
+
+		bool const match = r.firstSecondHash == scenarios[i].firstSecondHash;
+		printResult(scenarios[i].desc, seconds, r, match ? "ok" : "FAILED");
+		ok &= match;
+	}
+
+	std::remove(tmprom.c_str());
+
+	for (std::size_t i = 0; i < romfiles.size(); ++i) {
+		Result r;
+		if (!run(r, romfiles[i], seconds)) {
+			std::fprintf(stderr, "Failed to load ROM image file %s\n", romfiles[i]);
+			return EXIT_FAILURE;
+		}
+
+		printResult(romfiles[i], seconds, r, "");
+	}
+
+	return ok ? 0 : EXIT_FAILURE;
+}
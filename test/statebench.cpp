@@ -0,0 +1,199 @@
+#include "benchutil.h"
+#include "gambatte.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+class Emulator {
+public:
+	explicit Emulator(gambatte::GB &gb) : gb_(gb) {}
+
+	// Runs the given number of frames and returns a hash of the video and audio output.
+	unsigned long runFrames(unsigned frames) {
+		unsigned long hash = fnv1a_basis;
+		while (frames--) {
+			gambatte::uint_least32_t const frameHash = runner_.runFrameHashed(gb_);
+			hash = fnv1a(hash, &frameHash, 1);
+		}
+
+		return hash;
+	}
+
+private:
+	gambatte::GB &gb_;
+	FrameRunner runner_;
+};
+
+template<class F>
+double usecsPerCall(F f, unsigned iterations) {
+	double const t0 = secondsNow();
+	for (unsigned i = 0; i < iterations; ++i)
+		f();
+
+	return (secondsNow() - t0) * 1e6 / iterations;
+}
+
+// Time spent in saveState(videoBuf, pitch, filepath), which leaves writing the
+// file to a background thread. Waiting for each write outside the timed call
+// keeps queued writes from competing with the next save.
+double usecsPerSaveToFile(gambatte::GB &gb, std::string const &path, unsigned iterations) {
+	double secs = 0;
+	for (unsigned i = 0; i < iterations; ++i) {
+		double const t0 = secondsNow();
+		gb.saveState(0, 0, path);
+		secs += secondsNow() - t0;
+		gb.flushStateFiles();
+	}
+
+	return secs * 1e6 / iterations;
+}
+
+long sizeOfFile(std::string const &path) {
+	std::FILE *const f = std::fopen(path.c_str(), "rb");
+	if (!f)
+		return -1;
+
+	std::fseek(f, 0, SEEK_END);
+	long const size = std::ftell(f);
+	std::fclose(f);
+	return size;
+}
+
+} // anon ns
+
+int main(int const argc, char *argv[]) {
+	unsigned iterations = 1000;
+	unsigned frames = 600;
+	char const *romfile = 0;
+
+	for (int i = 1; i < argc; ++i) {
+		if (!std::strcmp(argv[i], "-n") && i + 1 < argc) {
+			iterations = std::max(std::atoi(argv[++i]), 1);
+		} else if (!std::strcmp(argv[i], "-f") && i + 1 < argc) {
+			frames = std::max(std::atoi(argv[++i]), 1);
+		} else if (argv[i][0] != '-' && !romfile) {
+			romfile = argv[i];
+		} else {
+			romfile = 0;
+			break;
+		}
+	}
+
+	if (!romfile) {
+		std::puts("Usage: statebench [-n iterations] [-f frames] romfile\n"
+		          "  Measures state save and load latency to file and memory after\n"
+		          "  running romfile for the given number of frames without input, and\n"
+		          "  checks that states restored from compressed and legacy state files\n"
+		          "  and from memory, in both the labelled and the raw format, replay\n"
+		          "  identically. Saving to file is timed both as seen by the caller,\n"
+		          "  with the file written in the background, and until written.");
+		return EXIT_FAILURE;
+	}
+
+	gambatte::GB gb;
+	if (gb.load(romfile)) {
+		std::fprintf(stderr, "Failed to load ROM image file %s\n", romfile);
+		return EXIT_FAILURE;
+	}
+
+	Emulator emu(gb);
+	emu.runFrames(frames);
+
+	std::string const statefile = tempPath("statebench.gqs");
+	std::vector<char> state;
+	gb.saveState(state);
+	std::vector<char> buf(state.size());
+	std::vector<char> rawState;
+	gb.saveStateRaw(rawState);
+
+	struct SaveFileFlush {
+		gambatte::GB &gb; std::string const &path;
+		void operator()() const { gb.saveState(0, 0, path); gb.flushStateFiles(); }
+	} const saveFileFlush = { gb, statefile };
+	struct LoadFile {
+		gambatte::GB &gb; std::string const &path;
+		void operator()() const { gb.loadState(path); }
+	} const loadFile = { gb, statefile };
+	struct SaveVector {
+		gambatte::GB &gb; std::vector<char> &data;
+		void operator()() const { gb.saveState(data); }
+	} const saveVector = { gb, state };
+	struct SaveBuffer {
+		gambatte::GB &gb; std::vector<char> &data;
+		void operator()() const { gb.saveState(&data[0], data.size()); }
+	} const saveBuffer = { gb, buf };
+	struct LoadMemory {
+		gambatte::GB &gb; std::vector<char> const &data;
+		void operator()() const { gb.loadState(&data[0], data.size()); }
+	} const loadMemory = { gb, state };
+	struct SaveRaw {
+		gambatte::GB &gb; std::vector<char> &data;
+		void operator()() const { gb.saveStateRaw(data); }
+	} const saveRaw = { gb, rawState };
+	struct LoadRaw {
+		gambatte::GB &gb; std::vector<char> const &data;
+		void operator()() const { gb.loadState(&data[0], data.size()); }
+	} const loadRaw = { gb, rawState };
+
+	std::printf("state size: %lu bytes, raw: %lu bytes\n",
+	            static_cast<unsigned long>(state.size()),
+	            static_cast<unsigned long>(rawState.size()));
+	std::printf("%-28s %10s\n", "operation", "usecs");
+	std::printf("%-28s %10.1f\n", "save to file", usecsPerSaveToFile(gb, statefile, iterations));
+	std::printf("%-28s %10.1f\n", "save to file and wait", usecsPerCall(saveFileFlush, iterations));
+	std::printf("%-28s %10.1f\n", "load from file", usecsPerCall(loadFile, iterations));
+	std::printf("%-28s %10.1f\n", "save to vector", usecsPerCall(saveVector, iterations));
+	std::printf("%-28s %10.1f\n", "save to caller buffer", usecsPerCall(saveBuffer, iterations));
+	std::printf("%-28s %10.1f\n", "load from memory", usecsPerCall(loadMemory, iterations));
+	std::printf("%-28s %10.1f\n", "save raw to vector", usecsPerCall(saveRaw, iterations));
+	std::printf("%-28s %10.1f\n", "load raw from memory", usecsPerCall(loadRaw, iterations));
+
+	std::remove(statefile.c_str());
+
+	gb.saveState(state);
+	unsigned long const expected = emu.runFrames(60);
+	bool const buffersMatch = std::memcmp(&state[0], &buf[0], state.size()) == 0;
+	gb.loadState(&state[0], state.size());
+	unsigned long const replayed = emu.runFrames(60);
+	gb.loadState(&state[0], state.size());
+	gb.saveStateRaw(rawState);
+	bool const rawLoaded = gb.loadState(&rawState[0], rawState.size());
+	unsigned long const rawReplayed = emu.runFrames(60);
+	rawState[4 + sizeof(gambatte::uint_least32_t)] ^= 1; // magic, version, fingerprint
+	bool const foreignRejected = !gb.loadState(&rawState[0], rawState.size());
+
+	gb.loadState(&state[0], state.size());
+	gb.saveState(0, 0, statefile);
+	bool const fileWritten = gb.flushStateFiles();
+	long const fileSize = sizeOfFile(statefile);
+	bool const fileLoaded = gb.loadState(statefile);
+	unsigned long const fileReplayed = emu.runFrames(60);
+	// States written by earlier versions are uncompressed.
+	bool const legacyLoaded = writeFile(statefile, &state[0], state.size()) && gb.loadState(statefile);
+	unsigned long const legacyReplayed = emu.runFrames(60);
+	std::remove(statefile.c_str());
+
+	std::printf("state file size: %ld bytes\n", fileSize);
+	std::printf("buffer and vector states identical: %s\n", buffersMatch ? "yes" : "NO");
+	std::printf("replay after load from memory matches: %s\n",
+	            replayed == expected ? "yes" : "NO");
+	std::printf("replay after raw load matches: %s\n",
+	            rawLoaded && rawReplayed == expected ? "yes" : "NO");
+	std::printf("raw state with foreign fingerprint rejected: %s\n",
+	            foreignRejected ? "yes" : "NO");
+	std::printf("replay after load from state file matches: %s\n",
+	            fileWritten && fileLoaded && fileReplayed == expected ? "yes" : "NO");
+	std::printf("replay after load from legacy state file matches: %s\n",
+	            legacyLoaded && legacyReplayed == expected ? "yes" : "NO");
+
+	return buffersMatch && replayed == expected
+	    && rawLoaded && rawReplayed == expected && foreignRejected
+	    && fileWritten && fileLoaded && fileReplayed == expected
+	    && legacyLoaded && legacyReplayed == expected
+	     ? 0
+	     : EXIT_FAILURE;
+}
@@ -0,0 +1,210 @@
+#include "batchstepper.h"
+#include "benchutil.h"
+#include "gambatte.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+unsigned buttonsFor(std::size_t instance, unsigned step) {
+	return (instance * 37 + step / 8 * 11) & 0xFF;
+}
+
+class Input : public gambatte::InputGetter {
+public:
+	Input() : buttons(0) {}
+	virtual unsigned operator()() { return buttons; }
+
+	unsigned buttons;
+};
+
+struct Observations {
+	std::vector<gambatte::uint_least32_t> video;
+	std::vector<unsigned char> ram;
+	std::vector<unsigned char> bytes;
+	unsigned long hash;
+
+	Observations() : hash(2166136261ul) {}
+
+	void addToHash() {
+		for (std::size_t i = 0; i < video.size(); ++i)
+			hash = ((hash ^ video[i]) * 16777619ul) & 0xFFFFFFFF;
+		for (std::size_t i = 0; i < ram.size(); ++i)
+			hash = ((hash ^ ram[i]) * 16777619ul) & 0xFFFFFFFF;
+		for (std::size_t i = 0; i < bytes.size(); ++i)
+			hash = ((hash ^ bytes[i]) * 16777619ul) & 0xFFFFFFFF;
+	}
+};
+
+std::vector<gambatte::StepRamRange> const ramRanges() {
+	gambatte::StepRamRange const ranges[] = { { 0xC000, 0x100 }, { 0xFF80, 0x7F } };
+	return std::vector<gambatte::StepRamRange>(ranges, ranges + sizeof ranges / sizeof ranges[0]);
+}
+
+std::vector<unsigned> const watchAddresses() {
+	unsigned const addresses[] = { 0xC000, 0xFF47 };
+	return std::vector<unsigned>(addresses, addresses + sizeof addresses / sizeof addresses[0]);
+}
+
+// What stepping instances one at a time and copying out each frame and the
+// RAM separately costs.
+double runSeparately(std::vector<char const *> const &romfiles, std::size_t numInstances,
+		unsigned steps, Observations &obs) {
+	std::vector<gambatte::GB> gbs(numInstances);
+	std::vector<Input> inputs(numInstances);
+	for (std::size_t i = 0; i < numInstances; ++i) {
+		gbs[i].setInputGetter(&inputs[i]);
+		gbs[i].load(romfiles[i % romfiles.size()], gambatte::GB::NO_SAVEDATA);
+	}
+
+	std::vector<gambatte::StepRamRange> const ranges = ramRanges();
+	std::vector<unsigned> const watch = watchAddresses();
+	std::size_t ramSize = 0;
+	for (std::size_t r = 0; r < ranges.size(); ++r)
+		ramSize += ranges[r].size;
+
+	std::vector<gambatte::uint_least32_t> videobuf(gb_width * gb_height);
+	std::vector<gambatte::uint_least32_t> audiobuf(audiobuf_size);
+	obs.video.resize(numInstances * videobuf.size());
+	obs.ram.resize(numInstances * ramSize);
+	obs.bytes.resize(numInstances * watch.size());
+	double const t0 = secondsNow();
+	for (unsigned step = 0; step < steps; ++step) {
+		for (std::size_t i = 0; i < numInstances; ++i) {
+			inputs[i].buttons = buttonsFor(i, step);
+			for (;;) {
+				std::size_t samples = samples_per_frame;
+				if (gbs[i].runFor(&videobuf[0], gb_width, &audiobuf[0], samples) >= 0)
+					break;
+			}
+
+			std::copy(videobuf.begin(), videobuf.end(), obs.video.begin() + i * videobuf.size());
+			unsigned char *ram = &obs.ram[i * ramSize];
+			for (std::size_t r = 0; r < ranges.size(); ++r) {
+				for (unsigned a = 0; a < ranges[r].size; ++a)
+					*ram++ = gbs[i].peek(ranges[r].address + a);
+			}
+
+			for (std::size_t a = 0; a < watch.size(); ++a)
+				obs.bytes[i * watch.size() + a] = gbs[i].peek(watch[a]);
+		}
+
+		obs.addToHash();
+	}
+
+	return secondsNow() - t0;
+}
+
+double runStepper(std::vector<char const *> const &romfiles, std::size_t numInstances,
+		unsigned threads, gambatte::BatchStepper::VideoMode mode, unsigned steps,
+		Observations &obs) {
+	gambatte::BatchStepper stepper(numInstances, threads);
+	for (std::size_t i = 0; i < numInstances; ++i)
+		stepper[i].load(romfiles[i % romfiles.size()], gambatte::GB::NO_SAVEDATA);
+
+	stepper.setVideoMode(mode);
+	stepper.setRamRanges(ramRanges());
+	stepper.setWatchAddresses(watchAddresses());
+	obs.video.resize(numInstances * stepper.videoStride());
+	obs.ram.resize(numInstances * stepper.ramStride());
+	obs.bytes.resize(numInstances * stepper.bytesStride());
+
+	std::vector<unsigned> buttons(numInstances);
+	double const t0 = secondsNow();
+	for (unsigned step = 0; step < steps; ++step) {
+		for (std::size_t i = 0; i < numInstances; ++i)
+			buttons[i] = buttonsFor(i, step);
+
+		stepper.step(&buttons[0], obs.video.empty() ? 0 : &obs.video[0], &obs.ram[0],
+		             &obs.bytes[0]);
+		obs.addToHash();
+	}
+
+	return secondsNow() - t0;
+}
+
+void printRow(char const *name, unsigned threads, double secs, double instanceSteps,
+		char const *same) {
+	std::printf("%-22s %7u %8.2f %12.0f %16.0f %6s\n", name, threads, secs,
+	            instanceSteps / secs, instanceSteps / secs / threads, same);
+}
+
+} // anon ns
+
+int main(int const argc, char *argv[]) {
+	unsigned numInstances = 16;
+	unsigned steps = 300;
+	unsigned maxThreads = std::max(std::thread::hardware_concurrency(), 1u);
+	std::vector<char const *> romfiles;
+
+	for (int i = 1; i < argc; ++i) {
+		if (!std::strcmp(argv[i], "-n") && i + 1 < argc) {
+			numInstances = std::max(std::atoi(argv[++i]), 1);
+		} else if (!std::strcmp(argv[i], "-s") && i + 1 < argc) {
+			steps = std::max(std::atoi(argv[++i]), 1);
+		} else if (!std::strcmp(argv[i], "-t") && i + 1 < argc) {
+			maxThreads = std::max(std::atoi(argv[++i]), 1);
+		} else if (argv[i][0] != '-') {
+			romfiles.push_back(argv[i]);
+		} else {
+			std::puts("Usage: stepbench [-n instances] [-s steps] [-t maxthreads] [romfile]...\n"
+			          "  Steps instances one frame at a time with different input each, and\n"
+			          "  reports instance steps per second, and per thread, of running them one\n"
+			          "  at a time and copying out each frame and RAM, and of BatchStepper on 1\n"
+			          "  thread, then on 2, 4 and so on up to maxthreads, which defaults to the\n"
+			          "  number of hardware threads. Checks that BatchStepper gives the same full\n"
+			          "  frames and RAM as running one at a time. Then reports downscaled frames\n"
+			          "  and no frames on maxthreads. Uses a ROM image that reads the joypad,\n"
+			          "  and the given ROM images in turn.");
+			return EXIT_FAILURE;
+		}
+	}
+
+	std::string const tmprom = tempPath("stepbench.gb");
+	if (!writeRom(tmprom, makeJoypadRom()))
+		return EXIT_FAILURE;
+
+	romfiles.insert(romfiles.begin(), tmprom.c_str());
+	double const instanceSteps = double(numInstances) * steps;
+	std::printf("%u instances, %u steps\n", numInstances, steps);
+	std::printf("%-22s %7s %8s %12s %16s %6s\n", "", "threads", "secs", "steps/s",
+	            "steps/s/thread", "same");
+
+	Observations reference;
+	printRow("one at a time", 1,
+	         runSeparately(romfiles, numInstances, steps, reference), instanceSteps, "");
+
+	bool ok = true;
+	for (unsigned threads = 1;; threads = std::min(threads * 2, maxThreads)) {
+		Observations obs;
+		double const secs = runStepper(romfiles, numInstances, threads,
+		                               gambatte::BatchStepper::video_full, steps, obs);
+		bool const same = obs.hash == reference.hash;
+		ok &= same;
+		printRow("BatchStepper full", threads, secs, instanceSteps, same ? "yes" : "NO");
+		if (threads == maxThreads)
+			break;
+	}
+
+	Observations half, none;
+	printRow("BatchStepper half", maxThreads,
+	         runStepper(romfiles, numInstances, maxThreads, gambatte::BatchStepper::video_half,
+	                    steps, half), instanceSteps, "");
+	printRow("BatchStepper no video", maxThreads,
+	         runStepper(romfiles, numInstances, maxThreads, gambatte::BatchStepper::video_none,
+	                    steps, none), instanceSteps, "");
+
+	// Different input must give different observations, or the check above is void.
+	bool diverged = false;
+	for (std::size_t i = romfiles.size(); i < numInstances; i += romfiles.size())
+		diverged |= none.bytes[i * 2] != none.bytes[0];
+
+	std::printf("input affects observations: %s\n", diverged ? "yes" : "NO");
+	std::remove(tmprom.c_str());
+	return ok && diverged ? 0 : EXIT_FAILURE;
+}
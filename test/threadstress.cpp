@@ -0,0 +1,143 @@
+#include "benchutil.h"
+#include "gambatte.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Result {
+	gambatte::uint_least64_t stateHash;
+	gambatte::uint_least64_t cloneStateHash;
+	unsigned long videoHash;
+
+	bool operator==(Result const &r) const {
+		return stateHash == r.stateHash && cloneStateHash == r.cloneStateHash
+		    && videoHash == r.videoHash;
+	}
+};
+
+// Runs an instance through everything that used to touch state shared between
+// instances: drawing without a video buffer, and saving, hashing and loading
+// labelled states. Also clones it and runs the clone.
+Result runInstance(char const *romfile, unsigned long seed, unsigned frames) {
+	gambatte::GB gb;
+	ScriptedInput input(seed);
+	gb.setInputGetter(&input);
+	Result result = Result();
+	if (gb.load(romfile, gambatte::GB::NO_SAVEDATA))
+		return result;
+
+	std::vector<gambatte::uint_least32_t> videobuf(gb_width * gb_height);
+	std::vector<gambatte::uint_least32_t> audiobuf(audiobuf_size);
+	std::vector<char> state;
+	gambatte::GB *clone = 0;
+	for (unsigned frame = 0; frame < frames; ++frame) {
+		input.setFrame(frame);
+		gambatte::uint_least32_t *const vbuf = frame % 2 ? &videobuf[0] : 0;
+		for (;;) {
+			std::size_t samples = samples_per_frame;
+			if (gb.runFor(vbuf, gb_width, &audiobuf[0], samples) >= 0)
+				break;
+		}
+
+		if (frame % 10 == 5) {
+			gb.saveState(state);
+			gb.loadState(&state[0], state.size());
+			gb.stateHash();
+		}
+
+		if (frame == frames / 2)
+			clone = gb.clone();
+	}
+
+	for (unsigned frame = frames / 2 + 1; clone && frame < frames; ++frame) {
+		for (;;) {
+			std::size_t samples = samples_per_frame;
+			if (clone->runFor(0, gb_width, &audiobuf[0], samples) >= 0)
+				break;
+		}
+	}
+
+	result.stateHash = gb.stateHash();
+	result.cloneStateHash = clone ? clone->stateHash() : 0;
+	delete clone;
+
+	result.videoHash = fnv1a(fnv1a_basis, &videobuf[0], videobuf.size());
+	return result;
+}
+
+void runInstances(std::vector<char const *> const &romfiles, unsigned first, unsigned step,
+		unsigned frames, std::vector<Result> &results) {
+	for (std::size_t i = first; i < results.size(); i += step)
+		results[i] = runInstance(romfiles[i % romfiles.size()], i, frames);
+}
+
+} // anon ns
+
+int main(int const argc, char *argv[]) {
+	unsigned numThreads = 8;
+	unsigned perThread = 2;
+	unsigned frames = 120;
+	std::vector<char const *> romfiles;
+
+	for (int i = 1; i < argc; ++i) {
+		if (!std::strcmp(argv[i], "-t") && i + 1 < argc) {
+			numThreads = std::max(std::atoi(argv[++i]), 1);
+		} else if (!std::strcmp(argv[i], "-n") && i + 1 < argc) {
+			perThread = std::max(std::atoi(argv[++i]), 1);
+		} else if (!std::strcmp(argv[i], "-f") && i + 1 < argc) {
+			frames = std::max(std::atoi(argv[++i]), 2);
+		} else if (argv[i][0] != '-') {
+			romfiles.push_back(argv[i]);
+		} else {
+			std::puts("Usage: threadstress [-t threads] [-n instances per thread] [-f frames]\n"
+			          "                    [romfile]...\n"
+			          "  Runs GB instances on several threads at once, with and without a video\n"
+			          "  buffer, saving, loading and hashing states and cloning, and checks\n"
+			          "  that each gives the same results as when run alone. Runs a ROM image\n"
+			          "  that reads the joypad, and the given ROM images in turn, with\n"
+			          "  pseudo-random input. Meant to be built, along with libgambatte, with\n"
+			          "  -fsanitize=thread, which reports any data race between instances:\n"
+			          "    make clean && make test/threadstress CXXFLAGS='-O1 -g -fsanitize=thread'");
+			return EXIT_FAILURE;
+		}
+	}
+
+	std::string const tmprom = tempPath("threadstress.gb");
+	if (!writeRom(tmprom, makeJoypadRom()))
+		return EXIT_FAILURE;
+
+	romfiles.insert(romfiles.begin(), tmprom.c_str());
+	std::size_t const numInstances = std::size_t(numThreads) * perThread;
+	std::vector<Result> alone(numInstances), parallel(numInstances);
+	double t0 = secondsNow();
+	runInstances(romfiles, 0, 1, frames, alone);
+	double const aloneSecs = secondsNow() - t0;
+
+	t0 = secondsNow();
+	std::vector<std::thread> threads;
+	for (unsigned i = 0; i < numThreads; ++i) {
+		threads.push_back(std::thread(runInstances, std::cref(romfiles), i, numThreads,
+		                              frames, std::ref(parallel)));
+	}
+
+	for (std::size_t i = 0; i < threads.size(); ++i)
+		threads[i].join();
+
+	double const parallelSecs = secondsNow() - t0;
+	unsigned mismatches = 0;
+	for (std::size_t i = 0; i < numInstances; ++i)
+		mismatches += !(parallel[i] == alone[i]);
+
+	std::remove(tmprom.c_str());
+	std::printf("%lu instances on %u threads, %u frames each: %.2f s alone, %.2f s in parallel\n",
+	            static_cast<unsigned long>(numInstances), numThreads, frames, aloneSecs,
+	            parallelSecs);
+	std::printf("mismatches: %u\n", mismatches);
+	return mismatches ? EXIT_FAILURE : 0;
+}
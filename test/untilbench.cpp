@@ -0,0 +1,225 @@
+#include "benchutil.h"
+#include "gambatte.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+unsigned long const cycles_per_frame = 70224;
+unsigned long const cycles_per_line = 456;
+unsigned long const max_cycles = 8 * cycles_per_frame;
+std::size_t const max_cycles_audiobuf_size = max_cycles / 2 + 2064;
+
+// A ROM image that halts until each vblank interrupt, and then increments the
+// byte at $C000.
+std::vector<unsigned char> makeVblankRom() {
+	unsigned char const code[] = {
+		0x3E, 0x01,       // ld a, $01
+		0xE0, 0xFF,       // ldh ($FF), a    ; enable the vblank interrupt
+		0xAF,             // xor a
+		0xE0, 0x0F,       // ldh ($0F), a
+		0xFB,             // ei
+		0x76,             // halt            ; $158
+		0x00,             // nop
+		0x21, 0x00, 0xC0, // ld hl, $C000
+		0x34,             // inc (hl)        ; $15D
+		0x18, 0xF8        // jr -8
+	};
+	std::vector<unsigned char> rom = makeRom(code, sizeof code);
+	rom[0x40] = 0xD9; // reti
+	return rom;
+}
+
+class Runner {
+public:
+	Runner() : audiobuf_(max_cycles_audiobuf_size) {}
+	gambatte::GB & gb() { return gb_; }
+
+	long runUntil(gambatte::RunCondition::Type type, unsigned address, unsigned value,
+			unsigned long cycles = cycles_per_frame) {
+		gambatte::RunCondition const condition = { type, address, value };
+		std::size_t samples;
+		return gb_.runUntil(condition, cycles, 0, gb_width, &audiobuf_[0], samples);
+	}
+
+	// Runs whole frames with runUntil, which never returns early for frames.
+	void runCycles(unsigned long cycles) {
+		while (cycles) {
+			unsigned long const n = std::min(cycles, cycles_per_frame);
+			runUntil(gambatte::RunCondition::none, 0, 0, n);
+			cycles -= n;
+		}
+	}
+
+private:
+	gambatte::GB gb_;
+	std::vector<gambatte::uint_least32_t> audiobuf_;
+};
+
+struct ConditionCase {
+	char const *name;
+	gambatte::RunCondition::Type type;
+	unsigned address;
+	unsigned value;
+};
+
+ConditionCase const conditionCases[] = {
+	{ "pc_equals $15D", gambatte::RunCondition::pc_equals, 0x15D, 0 },
+	{ "byte_equals $C000", gambatte::RunCondition::byte_equals, 0xC000, 0 },
+	{ "byte_changes $C000", gambatte::RunCondition::byte_changes, 0xC000, 0 },
+	{ "ly_equals 100", gambatte::RunCondition::ly_equals, 0, 100 },
+	{ "interrupt_taken vblank", gambatte::RunCondition::interrupt_taken, 0, 1 }
+};
+
+std::size_t const num_condition_cases = sizeof conditionCases / sizeof conditionCases[0];
+
+// Stopping where a condition is met must leave the instance where running for
+// the cycles runUntil returned leaves it, so that checking conditions does not
+// change emulation.
+bool stopsWhereRunForCyclesDoes(char const *romfile, ConditionCase const &c,
+		std::vector<char> const &state) {
+	Runner met, timed;
+	met.gb().load(romfile, gambatte::GB::NO_SAVEDATA);
+	timed.gb().load(romfile, gambatte::GB::NO_SAVEDATA);
+	met.gb().loadState(&state[0], state.size());
+	timed.gb().loadState(&state[0], state.size());
+
+	unsigned const value = c.type == gambatte::RunCondition::byte_equals
+	                     ? (met.gb().peek(c.address) + 3) & 0xFF
+	                     : c.value;
+	long const cycles = met.runUntil(c.type, c.address, value, max_cycles);
+	if (cycles < 0)
+		return false;
+
+	timed.runCycles(cycles);
+	met.gb().runFrame(0, gb_width);
+	timed.gb().runFrame(0, gb_width);
+	return met.gb().stateHash() == timed.gb().stateHash();
+}
+
+} // anon ns
+
+int main(int const argc, char *argv[]) {
+	unsigned frames = 600;
+
+	for (int i = 1; i < argc; ++i) {
+		if (!std::strcmp(argv[i], "-f") && i + 1 < argc) {
+			frames = std::max(std::atoi(argv[++i]), 1);
+		} else {
+			std::puts("Usage: untilbench [-f frames]\n"
+			          "  Checks GB::runUntil with each kind of condition on a ROM image that\n"
+			          "  increments a byte every vblank interrupt: the cycles between successive\n"
+			          "  stops, and that stopping where a condition is met leaves the same state\n"
+			          "  as running for the cycles returned. Then reports the time per frame of\n"
+			          "  runFrame, of runUntil with conditions that are never met, and of\n"
+			          "  waiting for the byte to change with runUntil and with a loop of short\n"
+			          "  runFor calls and GB::peek.");
+			return EXIT_FAILURE;
+		}
+	}
+
+	std::string const tmprom = tempPath("untilbench.gb");
+	if (!writeRom(tmprom, makeVblankRom()))
+		return EXIT_FAILURE;
+
+	char const *const romfile = tmprom.c_str();
+	bool ok = true;
+	{
+		using gambatte::RunCondition;
+		Runner r;
+		r.gb().load(romfile, gambatte::GB::NO_SAVEDATA);
+		r.runCycles(10 * cycles_per_frame);
+
+		r.runUntil(RunCondition::interrupt_taken, 0, 1);
+		ok &= check("interrupt_taken: one frame apart",
+			r.runUntil(RunCondition::interrupt_taken, 0, 1) == long(cycles_per_frame));
+		ok &= check("interrupt_taken for timer only: not met",
+			r.runUntil(RunCondition::interrupt_taken, 0, 4, 3 * cycles_per_frame) == -1);
+
+		r.runUntil(RunCondition::pc_equals, 0x15D, 0);
+		ok &= check("pc_equals: met again one frame later",
+			r.runUntil(RunCondition::pc_equals, 0x15D, 0) == long(cycles_per_frame));
+
+		r.runUntil(RunCondition::byte_changes, 0xC000, 0);
+		unsigned const counter = r.gb().peek(0xC000);
+		ok &= check("byte_changes: one frame apart, incremented",
+			r.runUntil(RunCondition::byte_changes, 0xC000, 0) == long(cycles_per_frame)
+			&& r.gb().peek(0xC000) == ((counter + 1) & 0xFF));
+		ok &= check("byte_equals: 5 increments later",
+			r.runUntil(RunCondition::byte_equals, 0xC000, (counter + 6) & 0xFF,
+			           max_cycles) == long(5 * cycles_per_frame));
+		ok &= check("byte_equals: holding at the start, not met within a frame",
+			r.runUntil(RunCondition::byte_equals, 0xC000, (counter + 6) & 0xFF,
+			           cycles_per_frame - 8) == -1);
+
+		r.runUntil(RunCondition::ly_equals, 0, 10);
+		long const ly20 = r.runUntil(RunCondition::ly_equals, 0, 20);
+		long const ly10 = r.runUntil(RunCondition::ly_equals, 0, 10);
+		ok &= check("ly_equals: 10 lines from 10 to 20, the rest of a frame back",
+			ly20 == long(10 * cycles_per_line) && ly20 + ly10 == long(cycles_per_frame));
+
+		ok &= check("none: runs for all of its cycles",
+			r.runUntil(RunCondition::none, 0, 0, 1000) == -1);
+
+		std::vector<char> state;
+		r.gb().saveState(state);
+		for (std::size_t i = 0; i < num_condition_cases; ++i) {
+			std::string const what = std::string(conditionCases[i].name)
+			                       + ": same state as running for the cycles";
+			ok &= check(what.c_str(), stopsWhereRunForCyclesDoes(romfile, conditionCases[i], state));
+		}
+	}
+
+	std::printf("\n%-36s %12s\n", "", "us/frame");
+	{
+		Runner r;
+		r.gb().load(romfile, gambatte::GB::NO_SAVEDATA);
+		double t0 = secondsNow();
+		for (unsigned f = 0; f < frames; ++f)
+			r.gb().runFrame(0, gb_width);
+
+		std::printf("%-36s %12.1f\n", "runFrame", (secondsNow() - t0) / frames * 1e6);
+
+		ConditionCase const neverMet[] = {
+			{ "runUntil none", gambatte::RunCondition::none, 0, 0 },
+			{ "runUntil pc_equals, never met", gambatte::RunCondition::pc_equals, 0x4000, 0 },
+			{ "runUntil byte_equals, never met", gambatte::RunCondition::byte_equals, 0xFF80, 0x100 },
+			{ "runUntil ly_equals, never met", gambatte::RunCondition::ly_equals, 0, 200 },
+			{ "runUntil interrupt_taken, never met", gambatte::RunCondition::interrupt_taken, 0, 8 }
+		};
+		for (std::size_t i = 0; i < sizeof neverMet / sizeof neverMet[0]; ++i) {
+			t0 = secondsNow();
+			for (unsigned f = 0; f < frames; ++f)
+				r.runUntil(neverMet[i].type, neverMet[i].address, neverMet[i].value);
+
+			std::printf("%-36s %12.1f\n", neverMet[i].name, (secondsNow() - t0) / frames * 1e6);
+		}
+
+		t0 = secondsNow();
+		for (unsigned f = 0; f < frames; ++f)
+			r.runUntil(gambatte::RunCondition::byte_changes, 0xC000, 0);
+
+		std::printf("%-36s %12.1f\n", "wait for change with runUntil",
+		            (secondsNow() - t0) / frames * 1e6);
+
+		std::vector<gambatte::uint_least32_t> audiobuf(max_cycles_audiobuf_size);
+		t0 = secondsNow();
+		for (unsigned f = 0; f < frames; ++f) {
+			unsigned const start = r.gb().peek(0xC000);
+			do {
+				std::size_t samples = 16;
+				r.gb().runFor(0, gb_width, &audiobuf[0], samples);
+			} while (r.gb().peek(0xC000) == start);
+		}
+
+		std::printf("%-36s %12.1f\n", "wait for change with runFor(16)",
+		            (secondsNow() - t0) / frames * 1e6);
+	}
+
+	std::remove(tmprom.c_str());
+	return ok ? 0 : EXIT_FAILURE;
+}